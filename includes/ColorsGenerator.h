@@ -149,6 +149,11 @@ class ColorGenerator : public Indicator
     // Interface: returns a color from a float between 0 and 1.
     virtual sf::Color get(float f) = 0;
 
+    // Returns the color of 'count' consecutive elements sharing the same
+    // float 'f', to color a run of elements at once. By default, it is
+    // 'get(f)'.
+    virtual sf::Color get_run(float f, std::size_t count);
+
     // Clone the current object and returns it as an object managed by a
     // 'shared_ptr'. The rational behind it is to have the correct object
     // when copying or copy-constructing an object havino a 'ColorGenerator'
@@ -0,0 +1,73 @@
+#ifndef GEOMETRY_STORE_H
+#define GEOMETRY_STORE_H
+
+
+#include "HeadingTrace.h"
+#include "IterationRuns.h"
+#include "VertexArrays.h"
+#include "types.h"
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace drawing
+{
+// The result of a turtle interpretation that does not depend on the painting
+// of the vertices.
+struct Geometry
+{
+    // The positions of the vertices and their branches.
+    VertexArrays vertices {};
+    // The iteration depth of each vertex. Empty if no painter needed them
+    // when the geometry was computed.
+    IterationRuns iterations {};
+    // The maximum number of iteration of the LSystem.
+    u8 max_iteration {0};
+    // The bounding box and sub-bounding boxes of the vertices.
+    sf::FloatRect bounding_box {};
+    std::vector<sf::FloatRect> sub_boxes {};
+    // The heading trace of the vertices, shared by the geometries of the same
+    // drawing with other angles, and the key of this drawing without the
+    // angles. Null if it was not recorded.
+    std::shared_ptr<const HeadingTrace> trace {};
+    std::string trace_key {};
+};
+
+// A process-wide content-addressed store of the geometries computed by the
+// views.
+//
+// A geometry is addressed by a key describing all the inputs of its
+// computation, typically the LSystem, its iteration, the InterpretationMap and
+// the angles. Views computing the same drawing share one immutable,
+// reference-counted 'Geometry' instead of each deriving and interpreting the
+// LSystem again.
+// The colors of the vertices are not part of the geometry: each view paints
+// its own array of colors.
+//
+// The store only holds weak references: a geometry is freed as soon as the
+// last view using it releases it.
+//
+// Usage: Usually defined as a static member.
+class GeometryStore
+{
+  public:
+    // Returns the geometry stored with 'key'. If it was freed, returns null.
+    std::shared_ptr<const Geometry> find(const std::string& key) const;
+
+    // Store 'geometry' with 'key', replacing any previous entry. The entries
+    // already freed are removed.
+    void insert(const std::string& key, const std::shared_ptr<const Geometry>& geometry);
+
+    // Returns the number of entries in the store, freed or not.
+    std::size_t size() const;
+
+  private:
+    std::unordered_map<std::string, std::weak_ptr<const Geometry>> entries_ {};
+};
+} // namespace drawing
+
+
+#endif // GEOMETRY_STORE_H
@@ -0,0 +1,89 @@
+#ifndef DRAWING_HEADING_TRACE_H
+#define DRAWING_HEADING_TRACE_H
+
+
+#include "TurtleProgram.h"
+#include "VertexArrays.h"
+#include "types.h"
+
+#include <SFML/Graphics.hpp>
+#include <limits>
+#include <vector>
+
+// Main explanation of drawing in Turtle.h
+namespace drawing
+{
+// The trace of a turtle interpretation independent of its angles.
+//
+// The direction of the turtle is always the starting angle plus an integer
+// number of 'delta_angle': its heading. The trace records the heading of the
+// move from its parent to each vertex. The positions for other angles are then
+// rebuilt from the trace and the branches of the vertices with a single pass
+// over the vertices and a table of the direction of each heading, without
+// deriving nor interpreting the production again.
+//
+// The trace is recorded from the 'TurtleProgram' executed by a turtle, in
+// parallel to the vertices: 'start()' records the first vertex at the origin,
+// and 'append()' the vertices of a program. The turtle must start with an
+// empty stack.
+//
+// Invariant:
+//   - The headings of the moves are in ['min_heading_', 'max_heading_'].
+class HeadingTrace
+{
+  public:
+    // The heading of a vertex at the position of its parent, or without
+    // parent.
+    static constexpr i32 no_move = std::numeric_limits<i32>::min();
+
+    HeadingTrace() = default;
+
+    // Record the first vertex, at the origin.
+    void start();
+
+    // Record the vertices computed by the execution of 'program' after the
+    // recorded ones.
+    void append(const TurtleProgram& program);
+
+    // Record the vertices of 'block', the trace of vertices computed from the
+    // current state, after the recorded ones. The first vertex of 'block' is
+    // at its origin, the current state, so it is not recorded.
+    void append(const HeadingTrace& block);
+
+    // Keep only the vertices at the indices 'kept', in increasing order: the
+    // vertices left after merging the collinear ones.
+    void keep(const std::vector<u32>& kept);
+
+    // Remove all the vertices.
+    void clear();
+
+    // Returns the number of vertices.
+    std::size_t size() const;
+
+    // Returns the heading of each vertex.
+    const std::vector<i32>& headings() const;
+
+    // Set the positions of 'vertices' to the turtle interpretation with the
+    // angles 'starting_angle' and 'delta_angle', in radian. Their branches are
+    // the same for any angle. The positions are not quantized afterwards.
+    // If the collinear vertices of 'vertices' were merged, a vertex continuing
+    // its parent moves by the difference of their ordinals.
+    //
+    // Exceptions:
+    //   - Precondition: 'vertices' has the size of the trace.
+    void rebuild(VertexArrays& vertices, double starting_angle, double delta_angle) const;
+
+  private:
+    std::vector<i32> headings_ {};
+    i32 min_heading_ {0};
+    i32 max_heading_ {0};
+
+    // The state of the recording: the current heading and the headings of
+    // the saved states.
+    i32 heading_ {0};
+    std::vector<i32> stack_ {};
+};
+} // namespace drawing
+
+
+#endif // DRAWING_HEADING_TRACE_H
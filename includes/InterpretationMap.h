@@ -6,9 +6,13 @@
 #include "RuleMap.h"
 #include "cereal/cereal.hpp"
 #include "cereal/types/unordered_map.hpp"
+#include "derivation.h"
 #include "helper_string.h"
 #include "types.h"
 
+#include <array>
+#include <optional>
+
 // Main explanation of drawing in Turtle.h
 namespace drawing
 {
@@ -32,6 +36,13 @@ void turn_left_fn(Turtle& turtle);
 void save_position_fn(Turtle& turtle);
 void load_position_fn(Turtle& turtle);
 
+// The order functions of a parametric module: 'step' is the length of the
+// move and 'angle' the angle of the turn, in radian, instead of the values of
+// 'turtle'.
+void go_forward_fn(Turtle& turtle, double step);
+void turn_right_fn(Turtle& turtle, double angle);
+void turn_left_fn(Turtle& turtle, double angle);
+
 // An 'Order' is simply an OrderID with an associated name.
 //
 // The OrderID is used in Turtle.cpp to link it to one of the order function
@@ -188,6 +199,16 @@ class InterpretationMap : public RuleMap<Order>
 };
 
 
+// The orders of an 'InterpretationMap' compiled into a dense table indexed by
+// 'derivation::index()', like the rules of a LSystem are compiled into a
+// 'derivation::RuleTable'. The symbols without an order are empty.
+// Interpreting a symbol is then a single array access instead of hashing it
+// and copying its 'Order'.
+using OrderTable = std::array<std::optional<OrderID>, derivation::table_size>;
+
+// Compile the orders of 'interpretation' into an 'OrderTable'.
+OrderTable compile_orders(const InterpretationMap& interpretation);
+
 // The default interpretation map used when creating new LSystems.
 const InterpretationMap default_interpretation_map {{'F', go_forward},
                                                     {'-', turn_left},
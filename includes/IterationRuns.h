@@ -0,0 +1,119 @@
+#ifndef ITERATION_RUNS_H
+#define ITERATION_RUNS_H
+
+
+#include "types.h"
+
+#include <gsl/gsl>
+#include <limits>
+#include <vector>
+
+// A sequence of iteration counts, run-length encoded.
+//
+// The whole successor of a symbol inherits its iteration count, and so do
+// the vertices of the symbols: the iteration counts of a production or of
+// the vertices of its interpretation are long runs of the same value. They
+// are stored as runs, which uses orders of magnitude less memory than one
+// 'u8' per element, and allows the consumers to work run by run.
+//
+// A run takes 8 bytes, so the iteration counts are only compressed if the
+// runs are longer than 8 elements on average. That is the case when the
+// iteration predecessors are a few symbols of the successors.
+//
+// Invariant:
+//   - Two consecutive runs have different iteration counts.
+//   - The runs are not empty: their ends are strictly increasing.
+//   - There are less than 2^32 elements.
+class IterationRuns
+{
+  public:
+    // The iteration count of the elements before 'end' and after the end of
+    // the previous run.
+    struct Run
+    {
+        u8 iteration;
+        u32 end;
+
+        bool operator==(const Run& other) const
+        {
+            return iteration == other.iteration && end == other.end;
+        }
+    };
+
+    IterationRuns() = default;
+    // Encode 'iterations'.
+    explicit IterationRuns(const std::vector<u8>& iterations);
+    // 'count' elements with the iteration count 'iteration'.
+    IterationRuns(std::size_t count, u8 iteration);
+
+    // Append 'count' elements with the iteration count 'iteration'. The last
+    // run is extended if it has the same iteration count.
+    //
+    // Exceptions:
+    //   - Precondition: the number of elements stays lower than 2^32.
+    void push_back(u8 iteration, std::size_t count = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        const std::size_t end = size() + count;
+        Expects(end <= std::numeric_limits<u32>::max());
+        if (!runs_.empty() && runs_.back().iteration == iteration)
+        {
+            runs_.back().end = static_cast<u32>(end);
+        }
+        else
+        {
+            runs_.push_back({iteration, static_cast<u32>(end)});
+        }
+    }
+
+    // Append the elements of 'other', whose iteration counts are increased
+    // by 'increment'.
+    void append(const IterationRuns& other, u8 increment = 0);
+
+    // Remove all the elements.
+    void clear();
+
+    // Reserve memory for 'n_runs' runs.
+    void reserve(std::size_t n_runs);
+
+    // Returns the number of elements.
+    std::size_t size() const
+    {
+        return runs_.empty() ? 0 : runs_.back().end;
+    }
+
+    bool empty() const;
+
+    // Returns the runs.
+    const std::vector<Run>& runs() const;
+
+    // Returns the index of the run containing the element at 'i'. The runs
+    // are found by binary search.
+    //
+    // Exceptions:
+    //   - Precondition: 'i' is lower than 'size()'.
+    std::size_t run_of(std::size_t i) const;
+
+    // Returns the iteration count of the element at 'i'.
+    //
+    // Exceptions:
+    //   - Precondition: 'i' is lower than 'size()'.
+    u8 at(std::size_t i) const;
+
+    // Returns the iteration count of each element.
+    std::vector<u8> decode() const;
+
+    // Returns the number of bytes of the runs.
+    std::size_t bytes() const;
+
+    bool operator==(const IterationRuns& other) const;
+    bool operator!=(const IterationRuns& other) const;
+
+  private:
+    std::vector<Run> runs_ {};
+};
+
+#endif // ITERATION_RUNS_H
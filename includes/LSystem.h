@@ -6,10 +6,17 @@
 #include "RuleMap.h"
 #include "cereal/cereal.hpp"
 #include "cereal/types/unordered_map.hpp"
+#include "cereal/types/vector.hpp"
+#include "derivation.h"
+#include "parametric.h"
 #include "types.h"
 
+#include <algorithm>
+#include <limits>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace cereal
 {
@@ -74,6 +81,80 @@ inline void load(Archive& ar, std::unordered_map<char, std::string, C, A>& map)
             "One or more LSystem's key was empty, so it was ignored.");
     }
 }
+
+template<class Archive>
+void serialize(Archive& ar, derivation::WeightedSuccessor& successor)
+{
+    ar(cereal::make_nvp("successor", successor.successor),
+       cereal::make_nvp("weight", successor.weight));
+}
+
+template<class Archive>
+void serialize(Archive& ar, derivation::ContextRule& rule)
+{
+    ar(cereal::make_nvp("left", rule.left),
+       cereal::make_nvp("successor", rule.successor),
+       cereal::make_nvp("right", rule.right));
+}
+
+template<class Archive>
+void serialize(Archive& ar, parametric::ParametricRule& rule)
+{
+    ar(cereal::make_nvp("predecessor", rule.predecessor),
+       cereal::make_nvp("condition", rule.condition),
+       cereal::make_nvp("successor", rule.successor));
+}
+
+// Saving for the stochastic and context-sensitive rules for text based
+// archives: each predecessor is associated to the list of its rules.
+template<class Archive,
+         class T,
+         class C,
+         class A,
+         traits::EnableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+inline void save(Archive& ar, std::unordered_map<char, std::vector<T>, C, A> const& map)
+{
+    for (const auto& i : map)
+        ar(cereal::make_nvp(std::string() + i.first, i.second));
+}
+
+// Loading for the stochastic and context-sensitive rules for text based
+// archives
+template<class Archive,
+         class T,
+         class C,
+         class A,
+         traits::EnableIf<traits::is_text_archive<Archive>::value> = traits::sfinae>
+inline void load(Archive& ar, std::unordered_map<char, std::vector<T>, C, A>& map)
+{
+    map.clear();
+
+    bool key_invalid = false;
+    while (true)
+    {
+        const auto namePtr = ar.getNodeName();
+        if (!namePtr)
+            break;
+
+        std::string loaded_key = namePtr;
+        std::vector<T> value;
+        ar(value);
+        if (loaded_key.size() == 1)
+        {
+            map.emplace(loaded_key.at(0), std::move(value));
+        }
+        else
+        {
+            key_invalid = true;
+        }
+    }
+
+    if (key_invalid)
+    {
+        controller::LoadMenu::add_loading_error_message(
+            "One or more LSystem's rule key was invalid, so it was ignored.");
+    }
+}
 } // namespace cereal
 
 // Simple L-system generation class. Starting from an axiom and simple
@@ -100,8 +181,17 @@ inline void load(Archive& ar, std::unordered_map<char, std::string, C, A>& map)
 //     max_iteration: 2
 //
 // This class is a simple variant of more general
-// L-systems: context-free (one generating symbol by rule) and
-// deterministic (at most one rule for each symbol).
+// L-systems: context-free (one generating symbol by rule). It is deterministic
+// (at most one rule for each symbol) unless other successors are added to the
+// rules with 'add_stochastic_successor()': at each derivation, one of the
+// successors of a stochastic symbol is chosen randomly. The random choices
+// only depend on 'seed_', the iteration and the position of the symbol, so
+// the productions are reproducible. Context-sensitive rules can also be added
+// with 'add_context_rule()': they replace a symbol only if the symbols before
+// and after it on its branch match their contexts. If parametric rules are
+// added with 'add_parametric_rule()', the LSystem is parametric: its axiom is
+// a string of modules with parameters, and it is derived with
+// 'produce_parametric()'.
 // Invariants:
 //   - If an axiom is defined at construction, 'production_cache_.at(0)'
 //   contains it at all time. And 'iteration_count_cache_.at(0)' is 0.
@@ -110,8 +200,14 @@ inline void load(Archive& ar, std::unordered_map<char, std::string, C, A>& map)
 //   rules inherited from 'RuleMap<std::string>
 //   - As a consequence, 'iteration_count_cache_' and 'production_cache_' are
 //   coherent BUT 'iteration_count_cache_' may have less elements than
-//   'production_cache_'. In any case, 'iteration_count_cache_' has always less
-//   or equal element than production_cache_'.
+//   'production_cache_' and 'packed_cache_'. In any case, each iteration in
+//   'iteration_count_cache_' is also in 'production_cache_' or in
+//   'packed_cache_'.
+//   - Each predecessor of 'stochastic_rules_' and 'context_rules_' has a
+//   rule.
+//   - After each 'produce()', the caches use at most 'cache_budget_' bytes,
+//   except for the axiom, the iteration produced and the most recently used
+//   iteration, which are never evicted.
 //
 //   The production rules are managed by the parent class
 //   RuleMap<std::string>. Its methodss are overloaded to respect the invariants
@@ -135,13 +231,29 @@ class LSystem : public RuleMap<std::string>
     // rules, etc).
     using Rules = RuleMap<Successor>::Rules;
 
+    // The other successors of the stochastic rules, with their weight
+    // relative to the weight 1 of the successor of the rule.
+    using StochasticRules = derivation::StochasticRules;
+
+    // The context-sensitive rules, by order of priority.
+    using ContextRules = derivation::ContextRules;
+
+    // The parametric rules, by order of priority.
+    using ParametricRules = parametric::ParametricRules;
+
+    // Type of the cache of the parametric productions.
+    using ParametricCache = std::unordered_map<u8, parametric::Production>;
+
     // Type of the cache of all computed iterations and the axiom.
     using ProductionCache = std::unordered_map<u8, std::string>;
 
-    // Type of the cache of all computed iteration values.
+    // Type of the cache of all computed iteration values, run-length encoded.
     // The second element in the pair is the maximum number of iteration for
     // this iteration.
-    using IterationCache = std::unordered_map<u8, std::pair<std::vector<u8>, u8>>;
+    using IterationCache = std::unordered_map<u8, std::pair<IterationRuns, u8>>;
+
+    // Type of the cache of the iterations packed to save memory.
+    using PackedCache = std::unordered_map<u8, derivation::PackedProduction>;
 
     // Constructors
     LSystem() = default;
@@ -157,6 +269,7 @@ class LSystem : public RuleMap<std::string>
     const ProductionCache& get_production_cache() const;
     const std::string& get_iteration_predecessors() const;
     const IterationCache& get_iteration_cache() const;
+    const PackedCache& get_packed_cache() const;
 
     // Set the axiom to 'axiom'
     void set_axiom(const std::string& axiom);
@@ -179,47 +292,316 @@ class LSystem : public RuleMap<std::string>
     // 'predecessors'.
     void set_iteration_predecessors(const std::string& predecessors);
 
+    // Get the other successors of the stochastic rules.
+    const StochasticRules& get_stochastic_rules() const;
+
+    // Returns true if at least one rule has other successors.
+    bool is_stochastic() const;
+
+    // Add 'successor' to the successors of the rule of 'predecessor'. It is
+    // chosen with a probability proportional to 'weight', the successor of
+    // the rule having a weight of 1.
+    //
+    // Exceptions:
+    //   - Precondition: 'predecessor' must have an associated rule.
+    //   - Precondition: 'weight' is positive.
+    void add_stochastic_successor(char predecessor, const Successor& successor, double weight);
+
+    // Remove the other successors of the rule of 'predecessor': it becomes
+    // deterministic.
+    void clear_stochastic_successors(char predecessor);
+
+    // Get and set the seed of the random choices of the successors.
+    u64 get_seed() const;
+    void set_seed(u64 seed);
+
+    // Get the context-sensitive rules.
+    const ContextRules& get_context_rules() const;
+
+    // Returns true if at least one rule is context-sensitive.
+    bool is_context_sensitive() const;
+
+    // Returns true if the expansion of each symbol only depends on the symbol
+    // and the number of iterations: the LSystem is neither stochastic nor
+    // context-sensitive.
+    bool is_expandable() const;
+
+    // Add the rule "left < predecessor > right -> successor": 'predecessor'
+    // is replaced by 'successor' if the symbol before it is 'left' and the
+    // symbol after it is 'right'. An empty context always matches. The
+    // context-sensitive rules are tried in the order they were added, before
+    // the other successors of 'predecessor'.
+    //
+    // Exceptions:
+    //   - Precondition: 'predecessor' must have an associated rule.
+    //   - Precondition: 'left' and 'right' are at most one symbol.
+    void add_context_rule(char predecessor,
+                          const std::string& left,
+                          const Successor& successor,
+                          const std::string& right);
+
+    // Remove the context-sensitive rules of 'predecessor'.
+    void clear_context_rules(char predecessor);
+
+    // Get and set the symbols skipped when looking for a context.
+    const std::string& get_context_ignored() const;
+    void set_context_ignored(const std::string& ignored);
+
+    // Get the parametric rules.
+    const ParametricRules& get_parametric_rules() const;
+
+    // Returns true if at least one rule is parametric.
+    bool is_parametric() const;
+
+    // Add the parametric rule 'rule' (see 'parametric::ParametricRule'). The
+    // parametric rules are tried in the order they were added, before the
+    // rules of 'rules_', which have no parameter.
+    //
+    // Exceptions:
+    //   - Precondition: 'rule' is valid ('parametric::compile_rules()').
+    void add_parametric_rule(const parametric::ParametricRule& rule);
+
+    // Remove all the parametric rules: the LSystem is no longer parametric.
+    void clear_parametric_rules();
+
+    // Get and set the maximum number of bytes used by the caches. The budget
+    // is enforced at the next 'produce()'. It is not a modification of the
+    // LSystem, so there is no notification.
+    std::size_t get_cache_budget() const;
+    void set_cache_budget(std::size_t budget);
+
+    // Get and set the maximum number of bytes of the expansions memoized
+    // when a production is directly expanded from the axiom
+    // ('derivation::ExpansionBlocks').
+    std::size_t get_block_budget() const;
+    void set_block_budget(std::size_t budget);
+
+    // Get and set the number of symbols from which a cold cached iteration
+    // is packed even if the caches fit in the budget. It is enforced at the
+    // next 'produce()'.
+    std::size_t get_packing_threshold() const;
+    void set_packing_threshold(std::size_t threshold);
+
+    // Returns the number of bytes used by the productions, packed or not, and
+    // the iteration counts in the caches.
+    std::size_t cache_size() const;
+
     // The result of the LSystem 'produce()' computation.
     // 'production' and 'iteration' are references to the cache to avoid
     // unecessary copies. Please be careful to the lifetime of the LSystem.
     struct LSystemProduction
     {
         const std::string& production; // The array of character derived from the axiom and rules.
-        const std::vector<u8>
-            iteration;    // The array of the iteration number for each character is 'production'.
+        const IterationRuns&
+            iteration;    // The runs of the iteration number for each character is 'production'.
         u8 max_iteration; // The maximum number of iteration in 'iteration'
     };
 
     // Return a 'LSystemProduction' containing the results of the computation of
     // the 'n'-th iteration of the derivation of the axiom, rules and
     // 'iteration_predecessors_'.
-    // 'size' is an optional argument that reserves 'size' elements in the
-    // result vectors before starting computation. If the value is equals or
-    // larger than the size of the vectors, no reallocation will take place,
-    // reducing the time this function takes.
+    // The rules are compiled into a 'derivation::RuleTable' at each call, so
+    // the derivation does not depend on the hashing of 'rules_'. The size of
+    // each iteration is computed before deriving it, so the productions are
+    // allocated exactly once. The iteration counts are derived directly as
+    // runs ('IterationRuns'): each successor adds at most one run.
+    // The derivation starts from the highest cached iteration before 'n',
+    // packed or not. If
+    // there is none and the result is bigger than
+    // 'derivation::direct_expansion_threshold', the axiom is directly expanded
+    // into the 'n'-th iteration and the intermediate iterations are not
+    // cached. The expansions of the symbols fitting in 'block_budget_' are
+    // memoized and copied as blocks.
+    // The cold iterations of at least 'packing_threshold_' symbols are
+    // packed in 'packed_cache_'. If the caches exceed 'cache_budget_', the
+    // least recently used iterations are first packed, then evicted. They are
+    // unpacked or derived again from the nearest cached iteration when
+    // needed.
+    // If 'with_iterations' is false, the iteration counts are neither
+    // computed, cached nor copied: 'iteration' is empty. Only
+    // 'max_iteration' is computed, from the symbols of each iteration.
     //
     // Exceptions:
     //   - Precondition: n positive.
     //   - Ensures coherence of 'production_rules
     //   - Throw in case of allocation problem.
     //   - Throw at '.at()' if code is badly refactored.
-    LSystemProduction produce(u8 n, unsigned long long size = 0);
+    LSystemProduction produce(u8 n, bool with_iterations = true);
+
+    // The result of the LSystem 'stream()' computation.
+    struct LSystemStream
+    {
+        derivation::SymbolStream symbols; // The symbols and their iteration number.
+        u8 max_iteration;                 // The maximum number of iteration of 'symbols'.
+    };
+
+    // Return a 'LSystemStream' yielding lazily the symbols of the 'n'-th
+    // iteration of the derivation of the axiom, with their iteration number.
+    // Contrary to 'produce()', the production is never materialized and
+    // nothing is cached: the symbols are expanded one at a time from the
+    // highest cached iteration before or at 'n'. The memory used does not
+    // depend on the size of the production, which allows interpreting
+    // productions too big to fit in memory.
+    // The stream may start from a packed iteration: it is then decoded block
+    // by block, without being unpacked. The iterations derived with
+    // context-sensitive rules start from an unpacked one, as the contexts
+    // are computed on the whole base.
+    // The stream references the rules and the caches of this LSystem: it
+    // must not be used after the LSystem is modified or destroyed.
+    // If 'with_iterations' is false, the stream may start from a production
+    // cached without its iteration counts: the iteration numbers streamed are
+    // then meaningless.
+    //
+    // Exceptions:
+    //   - Precondition: if the LSystem is not expandable, the iteration 'n'
+    //   or 'n-1' is cached, unpacked if the LSystem is context-sensitive.
+    LSystemStream stream(u8 n, bool with_iterations = true) const;
+
+    // The result of the LSystem 'expansion()' computation.
+    struct LSystemExpansion
+    {
+        derivation::RuleTable table; // The compiled rules.
+        std::string_view axiom;      // The axiom to expand.
+        u8 max_iteration;            // The maximum number of iteration of the result.
+    };
+
+    // Return what is needed to expand the axiom into the 'n'-th iteration
+    // without deriving it: the compiled rules and the axiom. Like the stream,
+    // it references the rules and the axiom of this LSystem: it must not be
+    // used after the LSystem is modified or destroyed.
+    //
+    // Exceptions:
+    //   - Precondition: the LSystem is expandable.
+    LSystemExpansion expansion(u8 n) const;
+
+    // Return the 'n'-th iteration of the derivation of the axiom as a
+    // 'derivation::ProductionDag': the symbols at any position or in any
+    // slice of the production are computed without materializing it. The
+    // expansion lengths annotating the DAG are computed from the rules
+    // matrix ('drawing::lsys_rules_matrix()').
+    // Returns 'std::nullopt' if there is no axiom, if the LSystem is not
+    // expandable or if the size of the production overflows.
+    // The DAG references the rules and the axiom of this LSystem: it must not
+    // be used after the LSystem is modified or destroyed.
+    std::optional<derivation::ProductionDag> production_dag(u8 n) const;
+
+    // Returns the 'n'-th iteration of the derivation of the axiom of a
+    // parametric LSystem, with 'parametric::derive()'. The stochastic and
+    // context-sensitive rules are not used. The rules of 'rules_' are applied
+    // to the modules without parameters, after the parametric rules. If the
+    // axiom is not a valid string of modules, the production is empty.
+    // The produced iterations are cached in 'parametric_cache_': an
+    // iteration is derived from the highest one cached before it, and the
+    // intermediate iterations are not kept.
+    //
+    // Exceptions:
+    //   - Precondition: the LSystem is parametric.
+    const parametric::Production& produce_parametric(u8 n);
 
   private:
+    // Compile the rules, the iteration predecessors, the stochastic rules and
+    // the context-sensitive rules into a 'derivation::RuleTable'.
+    derivation::RuleTable compile_rules() const;
+
+    // Returns the maximum iteration count of the 'n'-th iteration, computed
+    // from the cached iteration 'base' with 'table' without deriving it. If
+    // the iteration counts of 'base' are not cached, it is computed from the
+    // axiom.
+    u8 max_iteration(const derivation::RuleTable& table, u8 base, u8 n) const;
+
+    // Returns the expansion lengths of all the symbols of the system for 'n'
+    // iterations, computed from the rules matrix
+    // ('drawing::lsys_rules_matrix()'). Returns 'std::nullopt' if the
+    // lengths overflow.
+    std::optional<derivation::ExpansionLengths> expansion_lengths(u8 n) const;
+
+    // If the 'n'-th iteration is bigger than
+    // 'derivation::direct_expansion_threshold', expand it directly from the
+    // axiom with 'table' and cache it, with its iteration counts if
+    // 'with_iterations'. Returns true if it was expanded.
+    bool expand_directly(const derivation::RuleTable& table, u8 n, bool with_iterations);
+
     // The predecessors indicating than, at their next derivation, the iteration
     // counter will be incremented by one.
     std::string iteration_predecessors_ = {};
 
-    // The cache of all computed iterations and the axiom.  It contains all the
-    // iterations up to the highest iteration calculated. It is clearly not
-    // optimized for memory usage. However, this project emphasizes
-    // interactivity so quickly swapping between different iterations of the
-    // same L-System is a must.
+    // The other successors of the stochastic rules.
+    StochasticRules stochastic_rules_ = {};
+
+    // The seed of the random choices of the successors.
+    u64 seed_ = 0;
+
+    // The context-sensitive rules.
+    ContextRules context_rules_ = {};
+
+    // The parametric rules.
+    ParametricRules parametric_rules_ = {};
+
+    // The cached parametric productions, invalidated at each modification of
+    // the LSystem.
+    ParametricCache parametric_cache_ = {};
+
+    // The symbols skipped when looking for a context.
+    std::string context_ignored_ = {};
+
+    // Invalidate the cached iterations derived from the symbols of
+    // 'predecessors', whose rules are edited. Must be called before the edit.
+    // The iterations before and including the first one containing an edited
+    // symbol stay valid: they were never derived from these symbols. If no
+    // cached iteration contains one, nothing is invalidated.
+    void invalidate_cache(const std::string& predecessors);
+
+    // Mark the iteration 'n' as used now.
+    void touch(u8 n);
+
+    // Pack the cold iterations of at least 'packing_threshold_' symbols. Then,
+    // pack, then evict, the least recently used iterations from the caches
+    // until they fit in 'cache_budget_'. The axiom, the iteration 'n' and the
+    // most recently used iteration are never packed nor evicted.
+    void enforce_cache_budget(u8 n);
+
+    // Unpack the iteration 'n' into 'production_cache_' if it is packed.
+    void unpack(u8 n);
+
+    // Returns all the symbols that can appear in a production: the symbols
+    // of the axiom, the predecessors, and the symbols of the successors,
+    // stochastic, context-sensitive or not. The symbols are sorted and unique.
+    std::string alphabet() const;
+
+    // The cache of computed iterations and the axiom. As long as they fit in
+    // 'cache_budget_', all the iterations up to the highest iteration
+    // calculated are kept, except for the big productions directly expanded
+    // from the axiom: this project emphasizes interactivity so quickly
+    // swapping between different iterations of the same L-System is a must.
     ProductionCache production_cache_ = {};
 
     // The cache of all computed iteration values.
     IterationCache iteration_count_cache_ = {};
 
+    // The iterations evicted from 'production_cache_' but kept packed. Their
+    // iteration counts stay in 'iteration_count_cache_' until they are
+    // evicted too. They are coherent with the rules. An iteration is either
+    // in 'production_cache_' or in 'packed_cache_', never both.
+    PackedCache packed_cache_ = {};
+
+    // The maximum number of bytes used by the caches. Unlimited by default.
+    std::size_t cache_budget_ = std::numeric_limits<std::size_t>::max();
+
+    // The maximum number of bytes of the memoized expansions of a direct
+    // expansion.
+    std::size_t block_budget_ = derivation::default_block_budget;
+
+    // The number of symbols from which a cold iteration is packed even if
+    // the caches fit in 'cache_budget_'.
+    std::size_t packing_threshold_ = derivation::packing_threshold;
+
+    // The last use of each cached iteration, as a value of 'cache_clock_'.
+    // It may contain iterations no longer cached.
+    std::unordered_map<u8, unsigned long long> cache_last_use_ = {};
+
+    // Incremented at each use of a cached iteration.
+    unsigned long long cache_clock_ = 0;
+
 
     friend class cereal::access;
 
@@ -228,17 +610,90 @@ class LSystem : public RuleMap<std::string>
     {
         ar(cereal::make_nvp("axiom", production_cache_.at(0)),
            cereal::make_nvp("production_rules", rules_),
-           cereal::make_nvp("iteration_predecessors", iteration_predecessors_));
+           cereal::make_nvp("iteration_predecessors", iteration_predecessors_),
+           cereal::make_nvp("stochastic_rules", stochastic_rules_),
+           cereal::make_nvp("seed", seed_),
+           cereal::make_nvp("context_rules", context_rules_),
+           cereal::make_nvp("context_ignored", context_ignored_),
+           cereal::make_nvp("parametric_rules", parametric_rules_));
     }
 
     template<class Archive>
-    void load(Archive& ar, const u32)
+    void load(Archive& ar, const u32 version)
     {
+        packed_cache_.clear();
+        parametric_cache_.clear();
         ar(cereal::make_nvp("axiom", production_cache_[0]),
            cereal::make_nvp("production_rules", rules_),
            cereal::make_nvp("iteration_predecessors", iteration_predecessors_));
-        iteration_count_cache_[0] = {std::vector<u8>(production_cache_.at(0).size(), 0), 0};
+        // The stochastic rules were introduced in the version 1.
+        stochastic_rules_.clear();
+        seed_ = 0;
+        if (version >= 1)
+        {
+            ar(cereal::make_nvp("stochastic_rules", stochastic_rules_),
+               cereal::make_nvp("seed", seed_));
+        }
+        // The context-sensitive rules were introduced in the version 2.
+        context_rules_.clear();
+        context_ignored_.clear();
+        if (version >= 2)
+        {
+            ar(cereal::make_nvp("context_rules", context_rules_),
+               cereal::make_nvp("context_ignored", context_ignored_));
+        }
+        bool invalid_rule = false;
+        for (auto it = begin(stochastic_rules_); it != end(stochastic_rules_);)
+        {
+            const bool is_valid =
+                rules_.count(it->first) > 0
+                && std::all_of(begin(it->second), end(it->second), [](const auto& s) {
+                       return s.weight > 0;
+                   });
+            invalid_rule |= !is_valid;
+            it = is_valid ? std::next(it) : stochastic_rules_.erase(it);
+        }
+        if (invalid_rule)
+        {
+            controller::LoadMenu::add_loading_error_message(
+                "One or more LSystem's stochastic rule was invalid, so it was ignored.");
+        }
+        invalid_rule = false;
+        for (auto it = begin(context_rules_); it != end(context_rules_);)
+        {
+            const bool is_valid =
+                rules_.count(it->first) > 0
+                && std::all_of(begin(it->second), end(it->second), [](const auto& r) {
+                       return r.left.size() <= 1 && r.right.size() <= 1;
+                   });
+            invalid_rule |= !is_valid;
+            it = is_valid ? std::next(it) : context_rules_.erase(it);
+        }
+        if (invalid_rule)
+        {
+            controller::LoadMenu::add_loading_error_message(
+                "One or more LSystem's context-sensitive rule was invalid, so it was ignored.");
+        }
+        // The parametric rules were introduced in the version 3.
+        parametric_rules_.clear();
+        if (version >= 3)
+        {
+            ar(cereal::make_nvp("parametric_rules", parametric_rules_));
+        }
+        const auto invalid = std::remove_if(
+            begin(parametric_rules_), end(parametric_rules_), [](const auto& rule) {
+                return !parametric::compile_rules({rule});
+            });
+        if (invalid != end(parametric_rules_))
+        {
+            parametric_rules_.erase(invalid, end(parametric_rules_));
+            controller::LoadMenu::add_loading_error_message(
+                "One or more LSystem's parametric rule was invalid, so it was ignored.");
+        }
+        iteration_count_cache_[0] = {IterationRuns(production_cache_.at(0).size(), 0), 0};
     }
 };
 
+CEREAL_CLASS_VERSION(LSystem, 3);
+
 #endif
@@ -3,6 +3,7 @@
 
 
 #include "DrawingParameters.h"
+#include "GeometryStore.h"
 #include "InterpretationMapBuffer.h"
 #include "LSystemBuffer.h"
 #include "UniqueColor.h"
@@ -14,6 +15,8 @@
 #include "geometry.h"
 #include "size_computer.h"
 
+#include <memory>
+
 namespace procgui
 {
 // This class is the View of the LSystem, InterpretationMap, and
@@ -25,10 +28,10 @@ namespace procgui
 //     boxes.
 //
 // Invariant:
-//     - The 'turtle_' is in a coherent state with the LSystem,
-//     InterpretationMap, DrawingParameter, and VertexPainter.
-//     - The 'bounding_box_' and 'sub_boxes_' must correspond with the
-//     'vertices_'.
+//     - The 'geometry_' and 'colors_' are in a coherent state with the
+//     LSystem, InterpretationMap, DrawingParameter, and VertexPainter.
+//     - The 'max_iteration_', 'bounding_box_' and 'sub_boxes_' must
+//     correspond with the 'geometry_'.
 //     - Each instance as a unique 'id_' and 'color_id_'
 //
 // TODO: simplifies ctor by initializing some attribute here.
@@ -48,7 +51,7 @@ class LSystemView
     LSystemView(const ext::sf::Vector2d& position, double step);
     // Deep copy;
     //   - All Observers' pointers are cloned or moved
-    //   - 'parameters_' and 'turtle_' are copied
+    //   - 'parameters_' and 'colors_' are copied, 'geometry_' is shared
     //   - Id and colors are created or moved
     //   - Selection is reset
     LSystemView(const LSystemView& other);
@@ -68,7 +71,8 @@ class LSystemView
     const LSystemBuffer& get_lsystem_buffer() const;
     const InterpretationMapBuffer& get_interpretation_buffer() const;
     const colors::VertexPainterWrapper& get_vertex_painter_wrapper() const;
-    const drawing::Turtle& get_turtle() const;
+    const drawing::VertexArrays& get_vertices() const;
+    const std::vector<sf::Color>& get_colors() const;
     int get_id() const;
     sf::Color get_color() const;
 
@@ -139,6 +143,12 @@ class LSystemView
     // user confirms the computation.
     void open_size_warning_popup();
 
+    // Returns the key of the geometry of this view in 'geometry_store_'. It
+    // contains all the inputs of the turtle interpretation: the LSystem, the
+    // iteration, the InterpretationMap and the angles. Without the angles,
+    // it is the key of the heading trace of the geometry.
+    std::string geometry_key(bool with_angles = true) const;
+
     // The main system defining the L-System visible on screen
     drawing::DrawingParameters parameters_ {};
     LSystemBuffer lsystem_ {};
@@ -149,6 +159,8 @@ class LSystemView
     // LSystemView.
     static UniqueId unique_ids_;
     static colors::UniqueColor unique_colors_;
+    // The geometries shared by all the instances of LSystemView.
+    static drawing::GeometryStore geometry_store_;
     // Unique identifier for each instance. Used in procgui.
     int id_;
     // Unique color for each instance. Linked to 'id_'.
@@ -160,9 +172,16 @@ class LSystemView
     // true if the LSystem is modified from the last save
     bool is_modified_;
 
-    // The turtle containing the vertices, interations, and max_iteration.
-    // Must be coherent with the Observers.
-    drawing::Turtle turtle_;
+    // The geometry of the turtle interpretation, shared with all the views
+    // computing the same drawing. Must be coherent with the Observers.
+    std::shared_ptr<const drawing::Geometry> geometry_;
+
+    // The painted colors of the vertices of 'geometry_', owned by this view.
+    std::vector<sf::Color> colors_;
+
+    // The chunk of segments converted by 'draw()', reused at each frame. It
+    // is not part of the state of the view, so it is never copied.
+    std::vector<sf::Vertex> draw_buffer_ {};
 
     // The maximum number of iteration of the LSystem for the iteration
     // predecessors.
@@ -178,6 +197,10 @@ class LSystemView
     static constexpr int MAX_SUB_BOXES = 8;
     std::vector<sf::FloatRect> sub_boxes_;
 
+    // The positions of the drawings with at least this number of vertices
+    // are quantized to save memory.
+    static constexpr std::size_t MIN_QUANTIZED_VERTICES = 1 << 24;
+
     // True if the window is selected.
     bool is_selected_;
     // True if the bounding box must be visible
@@ -0,0 +1,74 @@
+#ifndef DRAWING_QUANTIZED_POSITIONS_H
+#define DRAWING_QUANTIZED_POSITIONS_H
+
+
+#include "types.h"
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Main explanation of drawing in Turtle.h
+namespace drawing
+{
+// Positions stored as 16-bit fixed-point offsets, for huge drawings.
+//
+// The positions are grouped by chunks of 'chunk_size' consecutive positions.
+// As each move of the turtle is a single step, the positions of a chunk are
+// close to each other. Each chunk has an origin, the corner of its bounding
+// box, and a scale mapping its bounding box to the range of 'u16' on each
+// axis. A position takes 4 bytes instead of 8 for a 'sf::Vector2f', and its
+// error is at most half the scale of its chunk: it is bounded by the size of
+// the chunk, not by the size of the whole drawing.
+//
+// Invariant:
+//   - 'chunks_' has one chunk for each 'chunk_size' offsets, the last one
+//   possibly incomplete.
+class QuantizedPositions
+{
+  public:
+    // The number of positions of a chunk.
+    static constexpr std::size_t chunk_size = 1 << 10;
+
+    QuantizedPositions() = default;
+    // Quantize 'positions'.
+    explicit QuantizedPositions(const std::vector<sf::Vector2f>& positions);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    // Returns the dequantized position at 'i'.
+    sf::Vector2f operator[](std::size_t i) const
+    {
+        const Chunk& chunk = chunks_[i / chunk_size];
+        const auto& offset = offsets_[i];
+        return {chunk.origin.x + offset.x * chunk.scale.x,
+                chunk.origin.y + offset.y * chunk.scale.y};
+    }
+
+    // Returns all the dequantized positions.
+    std::vector<sf::Vector2f> dequantize() const;
+
+    // Returns the maximum distance on an axis between a position and its
+    // dequantized value, up to the rounding of the floating-point arithmetic.
+    float max_error() const;
+
+    // Returns the number of bytes of the positions.
+    std::size_t bytes() const;
+
+    bool operator==(const QuantizedPositions& other) const;
+
+  private:
+    // A position of a chunk is 'origin + offset * scale'.
+    struct Chunk
+    {
+        sf::Vector2f origin;
+        sf::Vector2f scale;
+    };
+
+    std::vector<Chunk> chunks_ {};
+    std::vector<sf::Vector2<u16>> offsets_ {};
+};
+} // namespace drawing
+
+
+#endif // DRAWING_QUANTIZED_POSITIONS_H
@@ -11,6 +11,9 @@
 // 'char -> T'. Semantically, in this project, it links a symbol of a LSystem
 // (predecessor) with a successor that can be a string in a LSystem or an order
 // for a Turtle in InterpretationMap.
+// A symbol is a single byte: the derivation ('derivation::RuleTable') and the
+// interpretation ('drawing::OrderTable') dispatch through tables indexed by
+// it, and the longer keys of a saved file are cropped at loading.
 // The rational behind its existence is to complete the classic methods of an
 // unordered_map with the Observable behaviour. Moreover, it is useful has a
 // base class for all '*Buffer' for the GUI.
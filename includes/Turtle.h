@@ -3,10 +3,14 @@
 
 
 #include "DrawingParameters.h"
+#include "HeadingTrace.h"
 #include "InterpretationMap.h"
+#include "IterationRuns.h"
 #include "LSystem.h"
+#include "VertexArrays.h"
+#include "derivation.h"
+#include "parametric.h"
 
-#include <stack>
 #include <vector>
 
 // A Turtle is a computer graphics concept from the language logo. Imagine a pen
@@ -30,8 +34,9 @@ namespace drawing
 // 'InterpretationMap'.
 //
 // Invariant:
-//   - 'vertices_', 'iterations_' and 'transparency_' have the same number
-//   of elements. This invariant is only checked at the end of
+//   - 'iterations_' has the number of elements of 'vertices_' if
+//   'track_iterations_' is true. Otherwise
+//   'iterations_' is empty. This invariant is only checked at the end of
 //   'compute_vertices()', as these members must be manipulated by the
 //   'IntepretationMap' functions
 //   - 'iteration_index_' and 'iteration_depth_' are correctly associated.
@@ -55,18 +60,26 @@ struct Turtle
     // The value is 1 as floating-point are really precise at this scale.
     static constexpr double step_ {1};
 
-    // The current position and direction of the Turtle.
+    // The current position and direction of the Turtle, and the index of
+    // the vertex at this position: the parent of the next vertex.
     struct State
     {
         sf::Vector2<double> position;
         sf::Vector2<double> direction;
+        u32 vertex {0};
+
+        // Returns the state 'local', relative to this state, as an absolute
+        // state. A state relative to itself is '{{0, 0}, {1, 0}}'. The vertex
+        // of the result is the one of 'local'.
+        State compose(const State& local) const;
     };
     State state_ {{0, 0}, // (0, 0) as the position on-screen is set in
                           // LSystemView with transforms.
                   {0, 1}};
 
-    // The state of a turtle can be saved and loaded in a stack.
-    std::stack<State> stack_ {};
+    // The state of a turtle can be saved and loaded in a stack. It is a
+    // vector to be allocated once from the maximum bracket depth.
+    std::vector<State> stack_ {};
 
 
     // Reinit all the previous members from 'parameters'
@@ -78,25 +91,87 @@ struct Turtle
     // copies. Please be careful of the lifetime of 'Turtle'.
     struct TurtleProduction
     {
-        std::vector<sf::Vertex>& vertices;     // The vertices
-        const std::vector<u8>& iterations;     // Their iteration depth
-        const std::vector<bool>& transparency; // If their are invisible
+        VertexArrays& vertices;          // The vertices and their branches
+        const IterationRuns& iterations; // Their iteration depth
     };
-    // Compute all vertices, their iteration depth and their transparency of
+    // Compute all vertices, their iteration depth and their branches of
     // a turtle interpretation of a L-system.
     // For each symbol in 'lsystem_production', this function interpets it
-    // with the orders from 'interpretation'.
+    // with the orders from 'interpretation'. The orders are first lowered to
+    // a 'TurtleProgram', which folds consecutive moves and turns, then
+    // executed.
     // 'size' is an optional argument that reserves 'size' elements in the
     // result vectors before starting computation. If the value is equals or
     // larger than the size of the vectors, no reallocation will take place,
     // reducing the time this function takes to execute.
     TurtleProduction compute_vertices(const std::string& lsystem_production,
-                                      const std::vector<u8>& lsystem_iterations,
+                                      const IterationRuns& lsystem_iterations,
+                                      const InterpretationMap& interpretation,
+                                      unsigned long long size = 0);
+
+    // Compute all vertices, their iteration depth and their branches of
+    // a turtle interpretation of the symbols pulled from 'symbols'.
+    // Contrary to the other overload, the production does not need to be
+    // materialized: the symbols are lowered as soon as they are derived, and
+    // executed by blocks of instructions.
+    // 'size' has the same meaning as in the other overload.
+    TurtleProduction compute_vertices(derivation::SymbolStream symbols,
+                                      const InterpretationMap& interpretation,
+                                      unsigned long long size = 0);
+
+    // Compute all vertices, their iteration depth and their branches of
+    // a turtle interpretation of the parametric 'production'.
+    // The first parameter of a module overrides the value of its order: the
+    // step of 'go_forward', relative to 'step_', and the angle of 'turn_left'
+    // and 'turn_right', in degree. The parameters are read in place from the
+    // structure of arrays of 'production'.
+    // 'size' has the same meaning as in the other overloads.
+    TurtleProduction compute_vertices(const parametric::Production& production,
                                       const InterpretationMap& interpretation,
                                       unsigned long long size = 0);
 
-    // The vertices computed by 'compute_vertices()'
-    std::vector<sf::Vertex> vertices_ {};
+    // Default budget of the vertex blocks memoized by 'compute_vertices()', in
+    // bytes.
+    static constexpr std::size_t default_block_budget = 1 << 26;
+
+    // Compute all vertices, their iteration depth and their branches of
+    // a turtle interpretation of 'axiom' derived 'n' times with 'table',
+    // without deriving it.
+    // In a deterministic context-free system, the vertices of a symbol
+    // expanded 'k' times are the same wherever it occurs, up to a rigid
+    // transform: the state of the turtle before it. The vertices of each
+    // symbol and number of iterations are memoized as a block relative to
+    // this state, with the end state and the states left saved. Each other
+    // occurrence of the symbol transforms and copies the block instead of
+    // interpreting its expansion again. The blocks are built from the smaller
+    // ones.
+    // A block is only memoized if it never loads a state saved before it, if
+    // it has enough vertices to be worth copying, and if it fits in the
+    // remaining 'block_budget' bytes. The expansions of
+    // the symbols of the axiom are not memoized, as they are the whole
+    // interpretation.
+    // 'size' has the same meaning as in the other overloads.
+    //
+    // Exceptions:
+    //   - Precondition: 'table' is expandable.
+    TurtleProduction compute_vertices(const derivation::RuleTable& table,
+                                      std::string_view axiom,
+                                      u8 n,
+                                      const InterpretationMap& interpretation,
+                                      unsigned long long size = 0,
+                                      std::size_t block_budget = default_block_budget);
+
+    // The vertices computed by 'compute_vertices()'.
+    // Loading a state does not add any vertex: the next vertex starts a
+    // branch from the vertex of the loaded state.
+    VertexArrays vertices_ {};
+
+    // The index of the first vertex of 'vertices_' in the whole
+    // interpretation. It is only non-zero for a turtle interpreting a part of
+    // it, whose vertices are then appended to the others: the states and the
+    // branches always refer to vertices by their index in the whole
+    // interpretation.
+    u32 first_vertex_ {0};
 
     // The iterations associated to each vertex computed by
     // 'compute_vertices()'.
@@ -104,20 +179,41 @@ struct Turtle
     // 'lsystem_iterations'. However, a symbol can have none, one, or
     // several vertices associated, so this member links the vertices with
     // the iteration depth of the associated symbol.
-    std::vector<u8> iterations_ {};
-
-    // Defines for each vertex in 'vertices_' if it must be invisible to the
-    // user.
-    // A big optimization is to do only one draw call with a LineStrip. To
-    // do so, there are invisible vertices that link the different branches
-    // when loading or saving a state. These vertices must stay transparent,
-    // even when coloring all the other, so there is this vector of flags.
-    std::vector<bool> transparency_ {};
+    // The consecutive symbols share their depth, and so do their vertices:
+    // the depths are appended as runs.
+    IterationRuns iterations_ {};
 
     // The current depth at 'iteration_index_'
     u8 iteration_depth_ {0};
 
+    // If false, the iteration depths are neither read nor stored: 'iterations_'
+    // stays empty and 'lsystem_iterations' may be empty. Set it when no
+    // painter reads them.
+    bool track_iterations_ {true};
+
+    // The heading trace of 'vertices_', to rebuild them for other angles.
+    // Only recorded if 'track_headings_' is true, and not for a parametric
+    // production, whose modules have their own angles: it is then empty.
+    HeadingTrace trace_ {};
+    bool track_headings_ {false};
+
+    // If true, the collinear vertices are merged at the end of
+    // 'compute_vertices()': the moves forward continuing a segment with the
+    // same heading and the same iteration depth are a single segment. The
+    // vertices starting or ending a branch, or referred to by a state, are
+    // kept. Each kept vertex has its ordinal in 'vertices_', but a merged
+    // drawing is only painted as the unmerged one by the painters for which
+    // 'VertexPainter::is_merge_safe()' is true. The headings are read from
+    // 'trace_': the vertices are only merged if the trace is recorded.
+    bool merge_collinear_ {false};
+
   private:
+    // Clear the result vectors and reserve 'size' elements in them.
+    void reset(unsigned long long size);
+
+    // Merge the collinear vertices (see 'merge_collinear_').
+    void merge_collinear_vertices();
+
     // Index indicating the position in 'iterations' from 'compute_vertices()'.
     std::size_t iteration_index_ {0};
 };
@@ -0,0 +1,123 @@
+#ifndef DRAWING_TURTLE_PROGRAM_H
+#define DRAWING_TURTLE_PROGRAM_H
+
+
+#include "InterpretationMap.h"
+#include "helper_math.h"
+#include "types.h"
+
+#include <vector>
+
+// Main explanation of drawing in Turtle.h
+namespace drawing
+{
+struct Turtle;
+
+// The orders of a production lowered to a compact instruction stream, then
+// executed on a 'Turtle'.
+//
+// The orders are appended one by one, and a peephole optimization folds
+// them while appending:
+//   - Consecutive 'go_forward' of the same iteration depth are one
+//   instruction with a count.
+//   - Consecutive 'turn_left' and 'turn_right' are one rotation of the net
+//   number of turns. A rotation of zero turns is dropped.
+//   - The symbols without order are never appended.
+// The execution then dispatches once per instruction instead of once per
+// symbol. The rotations of each net number of turns are computed once per
+// execution, from the 'cos_' and 'sin_' of the turtle.
+//
+// The maximum bracket depth is also recorded, so the stack of the turtle is
+// allocated once before the execution.
+//
+// Each instruction is a rigid transform of the state of the turtle, so a
+// large program is executed in parallel (see 'execute()').
+class TurtleProgram
+{
+  public:
+    enum class OpCode : u8
+    {
+        FORWARD, // 'operand' moves forward.
+        ROTATE,  // A rotation of 'operand' left turns (negative to the right).
+        SAVE,
+        LOAD,
+    };
+
+    struct Instruction
+    {
+        OpCode op;
+        // The iteration depth of the vertices of the instruction.
+        u8 iteration;
+        i32 operand;
+
+        bool operator==(const Instruction& other) const
+        {
+            return op == other.op && iteration == other.iteration && operand == other.operand;
+        }
+    };
+
+    TurtleProgram() = default;
+
+    // Lower 'order' of a symbol of iteration depth 'iteration' and fold it
+    // with the previous instruction if possible.
+    void append(OrderID order, u8 iteration);
+
+    // Execute the instructions on 'turtle' with 'n_threads' threads.
+    //
+    // With several threads, the instructions are split in chunks:
+    //   1. Each chunk is simulated in parallel from its own origin. Its end
+    //   state and the states it leaves saved are rigid transforms relative to
+    //   its entry state or to one of the states it loads without saving them.
+    //   Its number of vertices is counted.
+    //   2. A sequential scan over the chunks composes these transforms to get
+    //   the entry state and the loaded states of each chunk.
+    //   3. Each chunk is executed in parallel from its entry state and copies
+    //   its vertices in its preallocated range of 'turtle.vertices_'.
+    // The vertices are the same as a sequential execution, up to the
+    // rounding of the composed transforms.
+    // If a chunk loads more states than saved, a load is a no-op that cannot
+    // be predicted, and the execution is sequential.
+    void execute(Turtle& turtle, unsigned n_threads = 1) const;
+
+    // Remove all the instructions.
+    void clear();
+
+    // Reserve memory for 'n' instructions.
+    void reserve(std::size_t n);
+
+    const std::vector<Instruction>& instructions() const;
+
+    // Returns the maximum number of states saved at the same time.
+    std::size_t max_depth() const;
+
+  private:
+    // The rotation of each net number of turns, indexed by 'turns -
+    // min_turns_'.
+    std::vector<ext::sf::Vector2d> rotations(const Turtle& turtle) const;
+
+    // Execute the instructions in [first, last) on 'turtle'. 'rotation_of'
+    // points to the rotation of zero turns in the result of 'rotations()'.
+    void execute(Turtle& turtle,
+                 const ext::sf::Vector2d* rotation_of,
+                 std::size_t first,
+                 std::size_t last) const;
+
+    std::vector<Instruction> instructions_ {};
+
+    // The current and maximum bracket depths.
+    std::size_t depth_ {0};
+    std::size_t max_depth_ {0};
+
+    // The range of the operands of the rotations.
+    i32 min_turns_ {0};
+    i32 max_turns_ {0};
+};
+
+// Returns the number of threads to execute a program of 'n_instructions'
+// instructions: one below a threshold where the parallel execution does not
+// pay off, else one per hardware thread.
+unsigned interpretation_thread_count(std::size_t n_instructions);
+} // namespace drawing
+
+
+#endif // DRAWING_TURTLE_PROGRAM_H
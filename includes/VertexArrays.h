@@ -0,0 +1,154 @@
+#ifndef DRAWING_VERTEX_ARRAYS_H
+#define DRAWING_VERTEX_ARRAYS_H
+
+
+#include "QuantizedPositions.h"
+#include "types.h"
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Main explanation of drawing in Turtle.h
+namespace drawing
+{
+// The vertices of a drawing, stored as separate packed arrays.
+//
+// An 'sf::Vertex' interleaves a position, a color and texture coordinates
+// never used by the drawings: 20 bytes per vertex. Here, the positions of the
+// vertices are an array, 8 bytes per vertex, and their colors a second array
+// painted by each view: 4 bytes per vertex. The positions do not depend on
+// the painting, so they are shared by all the views of the same drawing, and
+// the painters stream the positions and only write the colors.
+//
+// The vertices are the nodes of a tree: each vertex but the first one is the
+// end of a segment starting at its parent. The parent of a vertex is the
+// previous one, except for the first vertex of a branch, whose parent is the
+// vertex the branch starts from. Only these exceptions are stored, in
+// 'branches', so a drawing without branches is a plain line strip.
+// The vertices are converted to 'sf::Vertex' only to be drawn or exported,
+// chunk by chunk, as the two vertices of each segment (see 'to_sfml()').
+//
+// The positions of a huge drawing can be quantized (see 'quantize()') to
+// halve their memory. They are then only read with 'position()', which is
+// valid in both storages, and dequantized when converted to 'sf::Vertex'.
+//
+// The vertices continuing a straight segment can be merged (see
+// 'Turtle::merge_collinear_'). Each remaining vertex then keeps its index in
+// the unmerged vertices, its ordinal, for the painters depending on it.
+//
+// Invariant:
+//   - 'branches' is sorted by 'first'.
+//   - The parent of a vertex is before it.
+//   - 'positions' or 'quantized' is empty.
+//   - 'ordinals' is empty or strictly increasing with a value per vertex.
+struct VertexArrays
+{
+    // The vertex at 'first' starts a branch from the vertex at 'parent'.
+    struct Branch
+    {
+        u32 first;
+        u32 parent;
+
+        bool operator==(const Branch& other) const;
+    };
+
+    std::vector<sf::Vector2f> positions {};
+    std::vector<Branch> branches {};
+    // The positions, if they are quantized.
+    QuantizedPositions quantized {};
+    // The ordinals of the vertices, if some were merged.
+    std::vector<u32> ordinals {};
+
+    // Add a vertex at 'position' whose parent is the last vertex.
+    //
+    // Exceptions:
+    //   - Precondition: the positions are not quantized.
+    void push_back(const sf::Vector2f& position)
+    {
+        positions.push_back(position);
+    }
+
+    // Returns the position of the vertex at 'i', quantized or not.
+    sf::Vector2f position(std::size_t i) const
+    {
+        return quantized.empty() ? positions[i] : quantized[i];
+    }
+
+    // Returns the index of the vertex at 'i' before the merge of the
+    // collinear vertices.
+    std::size_t ordinal(std::size_t i) const
+    {
+        return ordinals.empty() ? i : ordinals[i];
+    }
+
+    std::size_t size() const;
+    bool empty() const;
+    bool is_quantized() const;
+
+    // Returns the number of vertices before the merge of the collinear
+    // vertices.
+    std::size_t unmerged_size() const;
+
+    // Quantize the positions: 'positions' is then empty, and the positions
+    // are in 'quantized'.
+    void quantize();
+
+    // Dequantize the positions back into 'positions'.
+    void dequantize();
+
+    // Returns the index of the parent of the vertex at 'i'.
+    //
+    // Exceptions:
+    //   - Precondition: '0 < i < size()'.
+    u32 parent(std::size_t i) const;
+
+    // Remove all the vertices.
+    void clear();
+
+    // Reserve memory for 'n' vertices.
+    void reserve(std::size_t n);
+
+    // Returns the number of bytes of the vertices.
+    std::size_t bytes() const;
+
+    bool operator==(const VertexArrays& other) const;
+};
+
+// Write in 'out' the segments ending at the vertices in [first, last) of
+// 'vertices' painted with 'colors', in the layout of SFML: the two vertices of
+// each segment, to be drawn as 'sf::Lines'. The first vertex does not end any
+// segment.
+//
+// Exceptions:
+//   - Precondition: 'colors' has the size of 'vertices'.
+//   - Precondition: 'first <= last <= vertices.size()'.
+void to_sfml(const VertexArrays& vertices,
+             const std::vector<sf::Color>& colors,
+             std::size_t first,
+             std::size_t last,
+             std::vector<sf::Vertex>& out);
+
+// Returns all the segments of 'vertices' painted with 'colors', in the layout
+// of SFML.
+//
+// Exceptions:
+//   - Precondition: 'colors' has the size of 'vertices'.
+std::vector<sf::Vertex> to_sfml(const VertexArrays& vertices,
+                                const std::vector<sf::Color>& colors);
+
+// Draw the segments of 'vertices' painted with 'colors' on 'target' with
+// 'states'. The segments are converted chunk by chunk in 'buffer', which is
+// reused from one call to the next: the drawing is never copied as a whole in
+// the layout of SFML.
+//
+// Exceptions:
+//   - Precondition: 'colors' has the size of 'vertices'.
+void draw_segments(sf::RenderTarget& target,
+                   const VertexArrays& vertices,
+                   const std::vector<sf::Color>& colors,
+                   std::vector<sf::Vertex>& buffer,
+                   const sf::RenderStates& states = sf::RenderStates::Default);
+} // namespace drawing
+
+
+#endif // DRAWING_VERTEX_ARRAYS_H
@@ -3,6 +3,8 @@
 
 
 #include "ColorsGeneratorWrapper.h"
+#include "IterationRuns.h"
+#include "VertexArrays.h"
 #include "cereal/cereal.hpp"
 #include "cereal/types/polymorphic.hpp"
 #include "types.h"
@@ -45,15 +47,30 @@ class VertexPainter : public Indicator
     // other parameters of 'paint_vertices()' could be used in the future.
     virtual void supplementary_drawing(sf::FloatRect bounding_box) const;
 
-    // Paint 'vertices' with the informations of all the other parameters
-    // according to a rule with the colors from
-    // 'ColorGeneratorWrapper::ColorGenerator'.
-    virtual void paint_vertices(std::vector<sf::Vertex>& vertices,
-                                const std::vector<u8>& iteration_of_vertices,
-                                const std::vector<bool>& transparent,
+    // Paint 'colors', the colors of 'vertices', with the informations of all
+    // the other parameters according to a rule with the colors from
+    // 'ColorGeneratorWrapper::ColorGenerator'. The positions of 'vertices'
+    // are only read.
+    //
+    // Exceptions:
+    //   - Precondition: 'colors' has the size of 'vertices'.
+    virtual void paint_vertices(std::vector<sf::Color>& colors,
+                                const drawing::VertexArrays& vertices,
+                                const IterationRuns& iteration_of_vertices,
                                 int max_recursion,
                                 sf::FloatRect bounding_box) = 0;
 
+    // Returns true if 'paint_vertices()' reads 'iteration_of_vertices'. If
+    // not, the iteration counts are not computed and 'iteration_of_vertices'
+    // may be empty.
+    virtual bool needs_iterations() const;
+
+    // Returns true if 'paint_vertices()' paints the same segments whether the
+    // collinear vertices of 'vertices' are merged or not (see
+    // 'Turtle::merge_collinear_'): the color of a merged vertex must be the
+    // one of the vertices around it. If not, the vertices are never merged.
+    virtual bool is_merge_safe() const;
+
     virtual std::string type_name() const = 0;
 
     virtual bool poll_modification() override;
@@ -54,6 +54,10 @@ namespace impl
         //  - Precondition: 'painter_.vertex_indices_pools_' must not be empty.
         sf::Color get(float f) override;
 
+        // Same as 'get()', but fills the pool with the 'count' next
+        // vertices.
+        sf::Color get_run(float f, std::size_t count) override;
+
         // Called by 'painter_' before painting, reset 'global_index_' to
         // 0.
         void reset_index();
@@ -120,12 +124,20 @@ class VertexPainterComposite : public VertexPainter
     void set_main_painter(const VertexPainterWrapper& painter_wrapper);
     void set_child_painters(const std::vector<VertexPainterWrapper>& painters);
 
-    virtual void paint_vertices(std::vector<sf::Vertex>& vertices,
-                                const std::vector<u8>& iteration_of_vertices,
-                                const std::vector<bool>& transparent,
+    virtual void paint_vertices(std::vector<sf::Color>& colors,
+                                const drawing::VertexArrays& vertices,
+                                const IterationRuns& iteration_of_vertices,
                                 int max_recursion,
                                 sf::FloatRect bounding_box) override;
 
+    // Returns true if the main painter or any child painter needs the
+    // iteration counts.
+    virtual bool needs_iterations() const override;
+
+    // Returns true if the main painter and all the child painters are merge
+    // safe.
+    virtual bool is_merge_safe() const override;
+
     // Draw all the supplementary_drawing from the main and children painters.
     virtual void supplementary_drawing(sf::FloatRect bounding_box) const override;
 
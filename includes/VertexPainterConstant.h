@@ -24,11 +24,14 @@ class VertexPainterConstant : public VertexPainter
 
     // Paint 'vertices' according to a constant real number.
     // 'bounding_box', 'iteration_of_vertices' and 'max_recursion' are not used.
-    virtual void paint_vertices(std::vector<sf::Vertex>& vertices,
-                                const std::vector<u8>& iteration_of_vertices,
-                                const std::vector<bool>& transparent,
+    virtual void paint_vertices(std::vector<sf::Color>& colors,
+                                const drawing::VertexArrays& vertices,
+                                const IterationRuns& iteration_of_vertices,
                                 int max_recursion,
                                 sf::FloatRect bounding_box) override;
+    // All the vertices have the same color.
+    virtual bool is_merge_safe() const override;
+
     // Implements the deep-copy cloning.
     virtual std::shared_ptr<VertexPainter> clone() const override;
 
@@ -23,14 +23,21 @@ class VertexPainterIteration : public VertexPainter
     VertexPainterIteration& operator=(VertexPainterIteration&& other) = delete;
 
     // Paint 'vertices' according to its iteration value: simply divide the
-    // current iteration by the max iteration.
+    // current iteration by the max iteration. The color is computed once for
+    // each run of 'vertices_iteration'.
     // 'bounding_box' is not used.
-    virtual void paint_vertices(std::vector<sf::Vertex>& vertices,
-                                const std::vector<u8>& vertices_iteration,
-                                const std::vector<bool>& transparent,
+    virtual void paint_vertices(std::vector<sf::Color>& colors,
+                                const drawing::VertexArrays& vertices,
+                                const IterationRuns& vertices_iteration,
                                 int max_iteration,
                                 sf::FloatRect bounding_box) override;
 
+    // The iteration counts are the painting rule.
+    virtual bool needs_iterations() const override;
+
+    // The collinear vertices are only merged in a run of iteration count.
+    virtual bool is_merge_safe() const override;
+
     // Implements the deep-copy cloning.
     virtual std::shared_ptr<VertexPainter> clone() const override;
 
@@ -38,9 +38,9 @@ class VertexPainterLinear : public VertexPainter
     // certain 'angle_' according to the informations of 'bounding_box'
     // according to the rule with the colors from the ColorGenerator.
     // 'iteration_of_vertices' and 'max_recursion' are not used.
-    virtual void paint_vertices(std::vector<sf::Vertex>& vertices,
-                                const std::vector<u8>& iteration_of_vertices,
-                                const std::vector<bool>& transparent,
+    virtual void paint_vertices(std::vector<sf::Color>& colors,
+                                const drawing::VertexArrays& vertices,
+                                const IterationRuns& iteration_of_vertices,
                                 int max_recursion,
                                 sf::FloatRect bounding_box) override;
 
@@ -0,0 +1,604 @@
+#ifndef DERIVATION_H
+#define DERIVATION_H
+
+
+#include "IterationRuns.h"
+#include "types.h"
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The derivation engine of the LSystem.
+//
+// 'LSystem' manages the rules with hash maps ('RuleMap'), which is convenient
+// for editing them but slow when each symbol of a big production must be
+// looked up. Before deriving, the rules are frozen into a 'RuleTable': a dense
+// dispatch table indexed directly by the symbol. The derivation loop then
+// does a single table lookup per symbol instead of hashing it: a terminal
+// symbol has an identity rule in the table, and each successor is appended
+// with one copy of its size.
+namespace derivation
+{
+// Number of entries of the dispatch tables: one for each possible 'char'.
+constexpr std::size_t table_size = 256;
+
+// Index of the symbol 'c' in the dispatch tables.
+inline std::size_t index(char c)
+{
+    return static_cast<unsigned char>(c);
+}
+
+// Storage for the identity rule: the successor of a terminal symbol 'c' is
+// the one-character string starting at 'identity_symbols[index(c)]'.
+inline constexpr std::array<char, table_size> identity_symbols = []() {
+    std::array<char, table_size> symbols {};
+    for (std::size_t i = 0; i < table_size; ++i)
+    {
+        symbols[i] = static_cast<char>(i);
+    }
+    return symbols;
+}();
+
+// A successor of a stochastic rule, chosen with a probability proportional to
+// its 'weight'.
+struct WeightedSuccessor
+{
+    std::string successor;
+    double weight;
+};
+
+// The other successors of the stochastic symbols. The rule of a stochastic
+// symbol is one of its successors, with a weight of 1.
+using StochasticRules = std::unordered_map<char, std::vector<WeightedSuccessor>>;
+
+// A context-sensitive rule: 'successor' replaces the symbol if the symbol
+// before it is 'left' and the symbol after it is 'right'. A context is at most
+// one symbol, and an empty context always matches.
+//
+// As usual for bracketed L-systems, the contexts are looked for along the
+// branches delimited by '[' and ']': the symbol before the first symbol of a
+// branch is the symbol before the branch, and the branches are skipped when
+// looking for the symbol after.
+struct ContextRule
+{
+    std::string left;
+    std::string successor;
+    std::string right;
+};
+
+// The context-sensitive rules of the symbols, by order of priority.
+using ContextRules = std::unordered_map<char, std::vector<ContextRule>>;
+
+// A set of symbols, indexed by 'index()'.
+using SymbolSet = std::bitset<table_size>;
+
+// A symbol in the context of another, or 'no_context' if there is none.
+constexpr u16 no_context = table_size;
+
+// The rules and iteration predecessors of a LSystem compiled into dense
+// tables.
+// Symbols without a rule (terminals) are compiled as the identity rule: their
+// successor is themselves.
+//
+// The successors point to the strings of the rules that were compiled, so a
+// 'RuleTable' must not outlive these rules, and must be compiled again if they
+// are modified.
+struct RuleTable
+{
+    // The first character of the successor of each symbol. For a stochastic
+    // symbol, it is the successor of its rule.
+    std::array<const char*, table_size> successors {};
+
+    // The size of the successor of each symbol.
+    std::array<std::size_t, table_size> sizes {};
+
+    // 1 if the symbol is an iteration predecessor, 0 otherwise. It is directly
+    // added to the iteration count of the successor.
+    std::array<u8, table_size> increments {};
+
+    // A successor of a stochastic symbol and the cumulative probability of
+    // choosing it or one of the previous successors.
+    struct Choice
+    {
+        std::string_view successor;
+        double threshold;
+    };
+
+    // The successors of each stochastic symbol. Empty for the deterministic
+    // symbols.
+    std::array<std::vector<Choice>, table_size> choices {};
+
+    // True if at least one symbol is stochastic.
+    bool is_stochastic {false};
+
+    // The seed of the random choices of the successors.
+    u64 seed {0};
+
+    // A context-sensitive successor of a symbol. A context equal to
+    // 'no_context' always matches.
+    struct ContextChoice
+    {
+        u16 left;
+        u16 right;
+        std::string_view successor;
+    };
+
+    // The context-sensitive successors of each symbol, by order of
+    // priority. If none matches, the symbol is derived with its other
+    // successors.
+    std::array<std::vector<ContextChoice>, table_size> contexts {};
+
+    // True if at least one symbol has a context-sensitive rule.
+    bool is_context_sensitive {false};
+
+    // The symbols skipped when looking for the context of a symbol.
+    SymbolSet context_ignored {};
+};
+
+// Returns true if the expansion of a symbol only depends on the symbol and
+// the number of iterations: 'table' is deterministic and context-free.
+inline bool is_expandable(const RuleTable& table)
+{
+    return !table.is_stochastic && !table.is_context_sensitive;
+}
+
+// Returns true if the symbol at 'c' in 'table' is a terminal: it has no rule
+// and is replaced by itself at each iteration.
+inline bool is_terminal(const RuleTable& table, std::size_t c)
+{
+    return table.successors[c] == &identity_symbols[c];
+}
+
+// Compile 'rules', 'iteration_predecessors', the other successors of the
+// 'stochastic_rules' and the 'context_rules' into a 'RuleTable'. The
+// successors of the stochastic symbols are chosen randomly from 'seed'. The
+// symbols of 'context_ignored' are skipped when looking for a context.
+//
+// Exceptions:
+//   - Precondition: each symbol of 'stochastic_rules' has a rule in 'rules'.
+//   - Precondition: the weights of 'stochastic_rules' are positive.
+//   - Precondition: the contexts of 'context_rules' are at most one symbol.
+RuleTable compile_rules(const std::unordered_map<char, std::string>& rules,
+                        const std::string& iteration_predecessors,
+                        const StochasticRules& stochastic_rules = {},
+                        u64 seed = 0,
+                        const ContextRules& context_rules = {},
+                        const std::string& context_ignored = {});
+
+// The contexts of each symbol of a production: 'left[i]' and 'right[i]' are
+// the indexes of the symbols before and after the symbol at 'i', or
+// 'no_context'.
+struct ContextTable
+{
+    std::vector<u16> left;
+    std::vector<u16> right;
+};
+
+// Returns the contexts of each symbol of 'production', skipping the symbols
+// ignored by 'table'.
+// The branches are matched with a stack in one pass in each direction, so
+// the contexts are computed in linear time and each context check of the
+// derivation is a single lookup, whatever the nesting of the branches.
+ContextTable compute_contexts(const RuleTable& table, std::string_view production);
+
+// The counter-based random number generator Philox4x32-10 from "Parallel
+// Random Numbers: As Easy as 1, 2, 3" (Salmon et al., 2011). Returns the
+// random numbers associated to 'counter' in the stream of 'key'.
+//
+// Contrary to a sequential generator, any random number is computed
+// independently of the others, so a derivation can be split among threads and
+// still give exactly the same result.
+std::array<u32, 4> philox(std::array<u32, 4> counter, std::array<u32, 2> key);
+
+// Returns the successor of the symbol at 'c' when it is derived at 'position'
+// in the base of the iteration 'iteration_number'. If the base has
+// 'contexts', the first context-sensitive rule matching them is chosen. For a
+// stochastic symbol, the successor is chosen with the random numbers of
+// 'philox()' keyed by the seed of 'table', so the same symbol at the same
+// place always has the same successor.
+std::string_view choose_successor(const RuleTable& table,
+                                  std::size_t c,
+                                  u8 iteration_number,
+                                  std::size_t position,
+                                  const ContextTable* contexts = nullptr);
+
+// Returns the exact size of the derivation of 'base' with 'table'.
+// If 'table' is not expandable, 'position' is the position of 'base' in the
+// production it is part of, 'iteration_number' the number of the iteration
+// derived, and 'contexts' the contexts of the production if 'table' is
+// context-sensitive.
+std::size_t derived_size(const RuleTable& table,
+                         std::string_view base,
+                         std::size_t position = 0,
+                         u8 iteration_number = 0,
+                         const ContextTable* contexts = nullptr);
+
+// Derive once 'base' with 'table'.
+// The successors are written in 'production', which must point to a buffer of
+// at least 'derived_size(table, base, position, iteration_number)' elements,
+// and the runs of their iteration counts are appended to 'iteration'. If
+// 'production' is null, only the iteration count is computed. If 'iteration'
+// is null, the iteration count is not computed and 'base_iteration' is not
+// read.
+// 'base_iteration' is the iteration count of each symbol of the production
+// 'base' is part of: the iteration count of 'base[i]' is at 'position + i'. A
+// successor inherits the iteration count of its symbol, so it is appended as
+// a single run.
+// 'position', 'iteration_number' and 'contexts' have the same meaning as in
+// 'derived_size()'.
+//
+// Returns true if an iteration predecessor was derived.
+bool derive(const RuleTable& table,
+            std::string_view base,
+            const IterationRuns* base_iteration,
+            char* production,
+            IterationRuns* iteration,
+            std::size_t position = 0,
+            u8 iteration_number = 0,
+            const ContextTable* contexts = nullptr);
+
+// Number of symbols from which a derivation is split among several threads.
+// Below it, starting the threads costs more than deriving.
+constexpr std::size_t parallel_threshold = 1 << 20;
+
+// Returns the number of threads to use to derive a production of 'size'
+// symbols: 1 below 'parallel_threshold', all the hardware threads otherwise.
+unsigned derivation_thread_count(std::size_t size);
+
+// Derive once 'base' with 'table' into 'production', which is resized to the
+// exact size of the derivation, and 'iteration'. If 'production' is null,
+// only the iteration count is computed. If 'iteration' is null, the iteration
+// count is not computed and 'base_iteration' is not read: it may be empty.
+// For a stochastic 'table', 'iteration_number' is the number of the iteration
+// derived. For a context-sensitive 'table', the contexts of 'base' are
+// computed once before splitting it.
+//
+// The work is split among 'n_threads' threads: 'base' is cut into one chunk
+// per thread, and the size of the derivation of each chunk is computed
+// concurrently. An exclusive prefix sum of these sizes then gives the offset
+// at which each thread writes its successors, directly in their final place in
+// the result. Each thread encodes the runs of the iteration counts of its
+// chunk, which are then concatenated.
+//
+// Returns true if an iteration predecessor was derived.
+bool derive_iteration(const RuleTable& table,
+                      std::string_view base,
+                      const IterationRuns& base_iteration,
+                      std::string* production,
+                      IterationRuns* iteration,
+                      unsigned n_threads = 1,
+                      u8 iteration_number = 0);
+
+// Returns the sets of symbols present in each of the 'n' first iterations
+// derived from 'axiom' with 'table'. The element 'i' is the set of symbols of
+// the iteration 'i'.
+//
+// These sets are computed without deriving any production, as the symbols of
+// the iteration 'i+1' are exactly the symbols of the successors of the
+// symbols of the iteration 'i'. For a stochastic or context-sensitive
+// 'table', all the successors are included: the sets contain the symbols that
+// may be in each iteration.
+std::vector<SymbolSet> symbols_per_iteration(const RuleTable& table, std::string_view axiom, u8 n);
+
+// The expansion lengths of the symbols: 'lengths[k][index(c)]' is the size of
+// the production derived from the single symbol 'c' after 'k' iterations.
+using ExpansionLengths = std::vector<std::array<std::size_t, table_size>>;
+
+// Number of symbols from which a production is directly expanded from the
+// axiom instead of derived iteration by iteration. Below it, keeping all the
+// intermediate iterations is cheap and makes swapping between iterations
+// instantaneous.
+constexpr std::size_t direct_expansion_threshold = 1 << 22;
+
+// The memoized expansions of the symbols of a system.
+//
+// In a deterministic context-free system, the expansion of a symbol after 'k'
+// iterations is the same wherever it occurs. When expanding, each of these
+// blocks is copied at once instead of being rewritten symbol by symbol.
+class ExpansionBlocks
+{
+  public:
+    // The expansion of a symbol. The iteration counts are relative to the
+    // iteration count of the expanded symbol.
+    struct Block
+    {
+        std::string production;
+        IterationRuns iteration;
+    };
+
+    ExpansionBlocks() = default;
+    // Memoize the expansions of the symbols with a rule in 'table' from 1 up
+    // to 'n' iterations, computed from the shorter ones. A block is not
+    // memoized if it would exceed the 'budget' in bytes, nor if the blocks it
+    // is made of are not.
+    //
+    // Exceptions:
+    //   - Precondition: 'lengths' contains the expansion lengths for at least
+    //   'n' iterations.
+    //   - Precondition: 'table' is expandable.
+    ExpansionBlocks(const RuleTable& table,
+                    const ExpansionLengths& lengths,
+                    u8 n,
+                    std::size_t budget);
+
+    // Returns the expansion of the symbol at 'c' after 'k' iterations, or
+    // null if it is not memoized.
+    const Block* find(std::size_t c, u8 k) const
+    {
+        return k < blocks_.size() ? blocks_[k][c].get() : nullptr;
+    }
+
+    // Returns the number of bytes of the memoized blocks.
+    std::size_t size() const;
+
+  private:
+    // 'blocks_[k][c]' is the expansion of the symbol at 'c' after 'k'
+    // iterations.
+    std::vector<std::array<std::unique_ptr<const Block>, table_size>> blocks_ {};
+    std::size_t size_ {0};
+};
+
+// Default budget of the 'ExpansionBlocks' of a system, in bytes.
+constexpr std::size_t default_block_budget = 1 << 22;
+
+// Expand 'n' times 'axiom' with 'table' directly into 'production', which is
+// resized to the exact size of the result, and 'iteration'. If 'iteration' is
+// null, the iteration count is not computed.
+// Contrary to deriving 'n' times with 'derive_iteration()', no intermediate
+// iteration is ever created: each symbol of the axiom is expanded depth-first,
+// so the peak memory usage is the size of the result.
+//
+// 'lengths' must contain the expansion lengths of all the symbols for at
+// least 'n' iterations. With them, each subtree of the expansion is placed
+// exactly in the result, which allows splitting the expansion among
+// 'n_threads' threads. Each thread encodes the runs of the iteration counts of
+// its subtrees, which are then concatenated.
+// The subtrees memoized in 'blocks' are copied at once.
+//
+// Exceptions:
+//   - Precondition: 'lengths' contains the expansion lengths for at least
+//   'n' iterations.
+//   - Precondition: 'table' is expandable.
+void expand(const RuleTable& table,
+            const ExpansionLengths& lengths,
+            const ExpansionBlocks& blocks,
+            std::string_view axiom,
+            u8 n,
+            std::string& production,
+            IterationRuns* iteration,
+            unsigned n_threads = 1);
+
+class PackedProduction;
+
+// A lazy stream of the symbols of an iteration.
+//
+// Instead of materializing the whole production, the symbols are derived one
+// at a time on demand by walking depth-first an explicit expansion stack. The
+// stack contains at most one range of symbols per iteration, so the memory
+// used is proportional to the number of iterations, whatever the size of the
+// production.
+//
+// Usage:
+//     char symbol;
+//     u8 iteration;
+//     while (stream.next(symbol, iteration)) { ... }
+//
+// A 'SymbolStream' references the successors of the rules and its base
+// production: they must outlive it and must not be modified while it is
+// used.
+//
+// The random choices of a stochastic system and the contexts of a
+// context-sensitive system depend on the position of each symbol in its
+// iteration, which is only known for the symbols of the base: such a base is
+// derived at most once.
+//
+// A packed base is decoded block by block: a stream of a packed base is
+// movable but not copyable, as its stack references its decoded block.
+class SymbolStream
+{
+  public:
+    SymbolStream() = default;
+    SymbolStream(const SymbolStream&) = delete;
+    SymbolStream& operator=(const SymbolStream&) = delete;
+    SymbolStream(SymbolStream&&) = default;
+    SymbolStream& operator=(SymbolStream&&) = default;
+    // Stream the symbols of 'base' derived 'n' times with 'table'.
+    // 'base_iteration' contains the iteration count of each symbol of
+    // 'base'. If it is null, the iteration counts of 'base' are 0.
+    // 'base_number' is the number of the iteration 'base'.
+    //
+    // Exceptions:
+    //   - Precondition: 'n' is at most 1 if 'table' is not expandable.
+    SymbolStream(const RuleTable& table,
+                 std::string_view base,
+                 const IterationRuns* base_iteration,
+                 u8 n,
+                 u8 base_number = 0);
+
+    // Stream the symbols of the packed 'base' derived 'n' times with 'table',
+    // without unpacking it: only one block of 'base' is decoded at a time.
+    //
+    // Exceptions:
+    //   - Precondition: 'n' is at most 1 if 'table' is not expandable.
+    //   - Precondition: 'n' is 0 if 'table' is context-sensitive.
+    SymbolStream(const RuleTable& table,
+                 const PackedProduction& base,
+                 const IterationRuns* base_iteration,
+                 u8 n,
+                 u8 base_number = 0);
+
+    // Get the next 'symbol' and its 'iteration' count.
+    // Returns false if there is no more symbols: 'symbol' and 'iteration' are
+    // then not modified.
+    bool next(char& symbol, u8& iteration);
+
+  private:
+    friend class ProductionDag;
+
+    // A range of symbols to expand 'level' times.
+    struct Frame
+    {
+        const char* first;
+        const char* last;
+        u8 level;
+        // The iteration count of all the symbols of the range, if
+        // 'run' is null.
+        u8 iteration;
+        // The run of the iteration count of the next symbol of the base.
+        const IterationRuns::Run* run;
+    };
+
+    // Decode the next block of 'packed_' into 'block_', and make 'frame', the
+    // base, its range. Returns false if there is no packed base or if it is
+    // entirely decoded.
+    bool decode_next_block(Frame& frame);
+
+    RuleTable table_ {};
+    std::vector<Frame> stack_ {};
+    // The first symbol of the base, its iteration number and its contexts,
+    // to choose the successors of the base if 'table_' is not expandable.
+    const char* base_ {nullptr};
+    u8 base_number_ {0};
+    ContextTable contexts_ {};
+    // The packed base, its block currently decoded, and the position of this
+    // block in the base. 'base_' is then the first symbol of the block.
+    const PackedProduction* packed_ {nullptr};
+    std::vector<char> block_ {};
+    std::size_t block_position_ {0};
+};
+
+// Number of symbols from which a cold cached production is packed even when
+// it fits in the cache budget. Below it, the memory saved is not worth
+// unpacking it again.
+constexpr std::size_t packing_threshold = 1 << 16;
+
+// A production packed with fewer bits per symbol.
+//
+// Most systems use less than 16 symbols, so storing a production as one
+// 'char' per symbol wastes most of the bits. The symbols are encoded as their
+// index in the alphabet of the system: on 2 bits for at most 4 symbols, on 4
+// bits for at most 16 symbols and on 8 bits otherwise. They are decoded with
+// table lookups.
+class PackedProduction
+{
+  public:
+    PackedProduction() = default;
+    // Pack 'production', whose symbols are all in 'alphabet'.
+    //
+    // Exceptions:
+    //   - Precondition: each symbol of 'production' is in 'alphabet'.
+    //   - Precondition: 'alphabet' contains unique symbols.
+    PackedProduction(std::string_view production, std::string_view alphabet);
+
+    // Returns the number of bits used for each symbol.
+    static unsigned bits_per_symbol(std::size_t alphabet_size);
+
+    // Returns the number of symbols of the production.
+    std::size_t size() const;
+
+    // Returns the number of bytes of the packed symbols.
+    std::size_t bytes() const;
+
+    // Returns the symbol at 'position'.
+    //
+    // Exceptions:
+    //   - Precondition: 'position' is lower than 'size()'.
+    char symbol_at(std::size_t position) const;
+
+    // Returns the unpacked production.
+    std::string unpack() const;
+
+    // Unpack the 'count' symbols from 'position' into 'out'.
+    //
+    // Exceptions:
+    //   - Precondition: 'position + count' is at most 'size()'.
+    void unpack(std::size_t position, std::size_t count, char* out) const;
+
+  private:
+    // The symbol of each code.
+    std::string alphabet_ {};
+    unsigned bits_ {8};
+    std::size_t size_ {0};
+    std::vector<u8> data_ {};
+};
+
+// A production represented without materializing it, as the DAG of the
+// successors of its symbols.
+//
+// The 'n'-th iteration of an axiom is the concatenation of the expansions of
+// its symbols, and the expansion of a symbol after 'k' iterations is the
+// concatenation of the expansions of its successors after 'k-1' iterations.
+// Each node of the DAG is annotated with the prefix sums of the expansion
+// lengths of its successors, so a position in the production is found by a
+// binary search at each iteration. The memory used is proportional to the
+// size of the rules times the number of iterations.
+//
+// A 'ProductionDag' references the successors of the rules and the axiom:
+// they must outlive it and must not be modified while it is used.
+class ProductionDag
+{
+  public:
+    // The DAG of the 'n'-th iteration of 'axiom' derived with 'table'.
+    //
+    // Exceptions:
+    //   - Precondition: 'lengths' contains the expansion lengths for at least
+    //   'n' iterations.
+    //   - Precondition: 'table' is expandable.
+    ProductionDag(const RuleTable& table,
+                  const ExpansionLengths& lengths,
+                  std::string_view axiom,
+                  u8 n);
+
+    // Returns the number of symbols of the production.
+    std::size_t size() const;
+
+    // Returns the symbol at 'position' in the production and its iteration
+    // count.
+    //
+    // Exceptions:
+    //   - Precondition: 'position' is lower than 'size()'.
+    std::pair<char, u8> symbol_at(std::size_t position) const;
+
+    // Returns a stream of the symbols of the production starting at
+    // 'position'.
+    //
+    // Exceptions:
+    //   - Precondition: 'position' is lower than or equal to 'size()'.
+    SymbolStream stream_from(std::size_t position) const;
+
+    // Write the symbols of the production in ['first', 'last') in
+    // 'production' and their iteration count in 'iteration'.
+    //
+    // Exceptions:
+    //   - Precondition: 'first' <= 'last' <= 'size()'.
+    void slice(std::size_t first,
+               std::size_t last,
+               std::string& production,
+               IterationRuns& iteration) const;
+
+  private:
+    // The position of a symbol in a range of symbols: the index of the
+    // symbol containing 'position' in 'offsets', and 'position' relative to
+    // the start of its expansion.
+    static std::size_t locate(const std::vector<std::size_t>& offsets, std::size_t& position);
+
+    RuleTable table_;
+    std::string_view axiom_;
+    u8 n_;
+    // The prefix sums of the expansion lengths of the symbols of the axiom
+    // after 'n_' iterations.
+    std::vector<std::size_t> axiom_offsets_;
+    // 'offsets_[k][c]' is the prefix sums of the expansion lengths of the
+    // successors of the symbol at 'c' after 'k-1' iterations. Empty for the
+    // terminals.
+    std::vector<std::array<std::vector<std::size_t>, table_size>> offsets_;
+};
+} // namespace derivation
+
+
+#endif // DERIVATION_H
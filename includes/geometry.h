@@ -34,9 +34,9 @@ sf::Vector2f project(sf::Vector2f A, sf::Vector2f B, sf::Vector2f p);
 // or B if the projected point is not in the segment [AB].
 sf::Vector2f project_and_clamp(sf::Vector2f A, sf::Vector2f B, sf::Vector2f p);
 
-// Compute the bounding box of a set of vertices.
+// Compute the bounding box of a set of vertices, from their positions.
 // Complexity in time is in O(n), n being the number of vertices.
-sf::FloatRect bounding_box(const std::vector<sf::Vertex>& vertices);
+sf::FloatRect bounding_box(const std::vector<sf::Vector2f>& positions);
 
 // Divide the vertices into 'max_boxes_'-1 equal part (with a remainder) and
 // compute the bounding boxes of each part. It is used to have a more
@@ -48,7 +48,7 @@ sf::FloatRect bounding_box(const std::vector<sf::Vertex>& vertices);
 // Note: The algorithm breaks for low count of vertices: it returns a
 // correct set of bounding boxes but 'max_boxes' is not respected. See the
 // implementation code for more informations.
-std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vertex>& vertices, int max_boxes);
+std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vector2f>& positions, int max_boxes);
 
 // Expand 'boxes' by 'expension' in all directions.
 void expand_boxes(std::vector<sf::FloatRect>& boxes, float expansion = 5.f);
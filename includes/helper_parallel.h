@@ -0,0 +1,52 @@
+#ifndef HELPER_PARALLEL_H
+#define HELPER_PARALLEL_H
+
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Number of threads to use for the parallel algorithms: one per hardware
+// thread.
+inline unsigned hardware_thread_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Split [0, size) into 'n_chunks' contiguous chunks of nearly equal size.
+// Returns the 'n_chunks' + 1 boundaries of the chunks: the chunk 'i' is
+// [boundaries[i], boundaries[i+1]).
+inline std::vector<std::size_t> split_in_chunks(std::size_t size, std::size_t n_chunks)
+{
+    std::vector<std::size_t> boundaries(n_chunks + 1);
+    for (std::size_t i = 0; i <= n_chunks; ++i)
+    {
+        boundaries[i] = size / n_chunks * i + std::min(i, size % n_chunks);
+    }
+    return boundaries;
+}
+
+// Call 'f(i)' for each 'i' in [0, n_tasks), each call in its own thread. The
+// calling thread executes 'f(0)' and waits for all other tasks to finish.
+// 'f' must not throw.
+template<typename Function>
+void parallel_for(std::size_t n_tasks, Function f)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(n_tasks);
+    for (std::size_t i = 1; i < n_tasks; ++i)
+    {
+        threads.emplace_back(f, i);
+    }
+    if (n_tasks > 0)
+    {
+        f(std::size_t {0});
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+
+#endif // HELPER_PARALLEL_H
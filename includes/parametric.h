@@ -0,0 +1,193 @@
+#ifndef PARAMETRIC_H
+#define PARAMETRIC_H
+
+
+#include "derivation.h"
+#include "types.h"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The derivation engine of the parametric L-systems.
+//
+// In a parametric L-system, each symbol of a production is a module carrying
+// real parameters, like "F(2.5)". The rules have formal parameters, an
+// optional condition and successors whose arguments are arithmetic
+// expressions of the formal parameters:
+//
+//   F(l, w) : l > 1 -> F(l / 2, w)[+(30) F(l / 2, w * 0.7)]
+//
+// The expressions are parsed once, when the rules are compiled, into a small
+// register bytecode ('Program'). The derivation loop then only evaluates them:
+// nothing is parsed nor allocated for each module. The parameters of a
+// production are stored in a structure of arrays next to its symbols
+// ('Production'), so the turtle reads the step or the angle of each symbol
+// without parsing the production.
+namespace parametric
+{
+// The operations of the bytecode.
+enum class OpCode : u8
+{
+    CONSTANT,  // result = constants[left]
+    PARAMETER, // result = parameters[left]
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    POWER,
+    NEGATE, // result = -left
+    NOT,    // result = !left
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL,
+    AND,
+    OR,
+};
+
+// An instruction of the bytecode: 'result', 'left' and 'right' are registers,
+// except for the operand of 'CONSTANT' and 'PARAMETER' which is an index.
+// The booleans are 1 for true and 0 for false.
+struct Instruction
+{
+    OpCode op;
+    u8 result;
+    u8 left;
+    u8 right;
+};
+
+// Maximum number of registers used by a 'Program'. The registers are
+// allocated like a stack, so it is the maximum nesting of an expression.
+constexpr std::size_t max_registers = 16;
+
+// An arithmetic expression compiled into bytecode. Its value is in the
+// register 0 after the execution of 'code'.
+struct Program
+{
+    std::vector<Instruction> code;
+    std::vector<double> constants;
+};
+
+// Compile the expression 'expression' whose variables are 'names': the
+// variable 'names[i]' is the parameter 'i' at the evaluation. The constant
+// subexpressions are folded.
+//
+// The expressions support the numbers, the variables, the parentheses, the
+// arithmetic operators '+', '-', '*', '/' and '^' (power), the comparisons
+// '<', '<=', '>', '>=', '==' and '!=', and the logical operators '&&', '||'
+// and '!'.
+// Returns 'std::nullopt' if 'expression' is invalid, uses an unknown
+// variable or is too deeply nested.
+std::optional<Program> compile_expression(std::string_view expression,
+                                          const std::vector<std::string>& names = {});
+
+// Returns the value of 'program' with the parameters 'parameters'.
+double evaluate(const Program& program, const double* parameters);
+
+// A parametric rule, written with the usual notation:
+//   - 'predecessor' is a symbol and its formal parameters, like "F(l, w)".
+//   - 'condition' is an expression of the formal parameters. The rule is
+//   applied only if it is not 0. An empty condition is always true.
+//   - 'successor' is a string of modules, whose arguments are expressions
+//   of the formal parameters, like "F(l / 2)+(30)F(l / 2)". A symbol without
+//   parentheses has no parameter.
+struct ParametricRule
+{
+    std::string predecessor;
+    std::string condition;
+    std::string successor;
+};
+
+// The parametric rules, by order of priority.
+using ParametricRules = std::vector<ParametricRule>;
+
+// A production of a parametric L-system, stored as a structure of arrays.
+// The parameters of the module 'i' are
+// 'parameters[offsets[i]]' to 'parameters[offsets[i+1]]' (excluded).
+//
+// Invariants:
+//   - 'symbols' and 'iterations' have the same size.
+//   - 'offsets' has one more element than 'symbols', starts with 0 and ends
+//   with the size of 'parameters'.
+struct Production
+{
+    std::string symbols {};
+    std::vector<u8> iterations {};
+    std::vector<u32> offsets {0};
+    std::vector<double> parameters {};
+
+    // The maximum iteration count of 'iterations'.
+    u8 max_iteration {0};
+
+    // The number of parameters of the module at 'i'.
+    std::size_t arity(std::size_t i) const
+    {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    // The first parameter of the module at 'i'.
+    const double* parameters_of(std::size_t i) const
+    {
+        return parameters.data() + offsets[i];
+    }
+};
+
+// Parse the string of modules 'axiom'. Its arguments must be constant
+// expressions. Its iteration counts are 0.
+// Returns 'std::nullopt' if 'axiom' is invalid.
+std::optional<Production> parse_production(std::string_view axiom);
+
+// The parametric rules and iteration predecessors compiled into a dense table
+// indexed by 'derivation::index()', like a 'derivation::RuleTable'. A symbol
+// without a rule matching the number of its parameters and whose condition is
+// true is replaced by itself.
+struct ParametricTable
+{
+    // A compiled rule. The successor is stored like a 'Production': the
+    // arguments of the module 'i' are the programs 'offsets[i]' to
+    // 'offsets[i+1]' (excluded).
+    struct Rule
+    {
+        u8 arity;
+        std::optional<Program> condition;
+        std::string symbols;
+        std::vector<u32> offsets;
+        std::vector<Program> arguments;
+    };
+
+    // The rules of each symbol, by order of priority.
+    std::array<std::vector<Rule>, derivation::table_size> rules {};
+
+    // 1 if the symbol is an iteration predecessor, 0 otherwise.
+    std::array<u8, derivation::table_size> increments {};
+};
+
+// Compile 'rules' and 'iteration_predecessors' into a 'ParametricTable'.
+// Returns 'std::nullopt' if a rule is invalid: a malformed predecessor, a
+// formal parameter repeated, or an invalid expression.
+std::optional<ParametricTable> compile_rules(const ParametricRules& rules,
+                                             const std::string& iteration_predecessors = {});
+
+// Derive once 'base' with 'table' into 'production'.
+// The rule of each module is chosen and the size of the result computed in a
+// first pass, then the successors are written in a second pass: the result
+// is allocated exactly once. Both passes are split among 'n_threads' threads
+// by chunks of 'base', like 'derivation::derive_iteration()'.
+//
+// Returns true if an iteration predecessor was derived.
+bool derive(const ParametricTable& table,
+            const Production& base,
+            Production& production,
+            unsigned n_threads = 1);
+
+// Returns the 'n'-th iteration of the derivation of 'axiom' with 'table'.
+// The big iterations are derived by several threads.
+Production produce(const ParametricTable& table, const Production& axiom, u8 n);
+} // namespace parametric
+
+#endif // PARAMETRIC_H
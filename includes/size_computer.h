@@ -14,12 +14,10 @@ class LSystem;
 namespace drawing
 {
 constexpr OrderID goforward = drawing::OrderID::GO_FORWARD;
-constexpr OrderID loadposition = drawing::OrderID::LOAD_POSITION;
 constexpr int vx_per_goforward = 1;
-constexpr int vx_per_loadposition = 3;
 constexpr int bytes_per_predecessor = sizeof(char);
-constexpr float bytes_per_vertex = sizeof(sf::Vertex) + sizeof(u8)
-                                   + 1 / 8.; // Vertex + Iteration + transparent
+constexpr float bytes_per_vertex =
+    sizeof(sf::Vector2f) + sizeof(sf::Color) + sizeof(u8); // Position + color + Iteration
 
 // Struct containing the number of element of a complete system and a overflow flag;
 struct system_size
@@ -17,6 +17,11 @@ ConstantColor::ConstantColor(const sf::Color& color)
 {
 }
 
+sf::Color ColorGenerator::get_run(float f, std::size_t /*count*/)
+{
+    return get(f);
+}
+
 sf::Color ConstantColor::get(float /*f*/)
 {
     return color_;
@@ -0,0 +1,28 @@
+#include "GeometryStore.h"
+
+namespace drawing
+{
+std::shared_ptr<const Geometry> GeometryStore::find(const std::string& key) const
+{
+    auto it = entries_.find(key);
+    if (it == end(entries_))
+    {
+        return nullptr;
+    }
+    return it->second.lock();
+}
+
+void GeometryStore::insert(const std::string& key, const std::shared_ptr<const Geometry>& geometry)
+{
+    for (auto it = begin(entries_); it != end(entries_);)
+    {
+        it = it->second.expired() ? entries_.erase(it) : std::next(it);
+    }
+    entries_[key] = geometry;
+}
+
+std::size_t GeometryStore::size() const
+{
+    return entries_.size();
+}
+} // namespace drawing
@@ -0,0 +1,154 @@
+#include "HeadingTrace.h"
+
+#include "Turtle.h"
+#include "helper_math.h"
+
+#include <algorithm>
+
+namespace drawing
+{
+void HeadingTrace::start()
+{
+    clear();
+    headings_.push_back(no_move);
+}
+
+void HeadingTrace::append(const TurtleProgram& program)
+{
+    Expects(!headings_.empty());
+    using OpCode = TurtleProgram::OpCode;
+
+    for (const auto& [op, iteration, operand] : program.instructions())
+    {
+        switch (op)
+        {
+        case OpCode::FORWARD:
+            headings_.insert(end(headings_), operand, heading_);
+            min_heading_ = std::min(min_heading_, heading_);
+            max_heading_ = std::max(max_heading_, heading_);
+            break;
+        case OpCode::ROTATE:
+            heading_ += operand;
+            break;
+        case OpCode::SAVE:
+            stack_.push_back(heading_);
+            break;
+        case OpCode::LOAD:
+            if (!stack_.empty())
+            {
+                heading_ = stack_.back();
+                stack_.pop_back();
+            }
+            break;
+        }
+    }
+}
+
+void HeadingTrace::append(const HeadingTrace& block)
+{
+    Expects(!headings_.empty() && !block.headings_.empty());
+
+    // The headings of the block are relative to the current heading.
+    for (auto heading = begin(block.headings_) + 1; heading != end(block.headings_); ++heading)
+    {
+        headings_.push_back(*heading == no_move ? no_move : *heading + heading_);
+    }
+    for (i32 heading : block.stack_)
+    {
+        stack_.push_back(heading + heading_);
+    }
+    min_heading_ = std::min(min_heading_, block.min_heading_ + heading_);
+    max_heading_ = std::max(max_heading_, block.max_heading_ + heading_);
+    heading_ += block.heading_;
+}
+
+void HeadingTrace::keep(const std::vector<u32>& kept)
+{
+    Expects(kept.empty() || kept.back() < headings_.size());
+
+    // The kept vertices are never after their index.
+    for (std::size_t i = 0; i < kept.size(); ++i)
+    {
+        headings_[i] = headings_[kept[i]];
+    }
+    headings_.resize(kept.size());
+}
+
+void HeadingTrace::clear()
+{
+    headings_.clear();
+    min_heading_ = 0;
+    max_heading_ = 0;
+    heading_ = 0;
+    stack_.clear();
+}
+
+std::size_t HeadingTrace::size() const
+{
+    return headings_.size();
+}
+
+const std::vector<i32>& HeadingTrace::headings() const
+{
+    return headings_;
+}
+
+void HeadingTrace::rebuild(VertexArrays& vertices, double starting_angle, double delta_angle) const
+{
+    Expects(vertices.size() == headings_.size());
+
+    // The move of each heading, flipped vertically like 'go_forward_fn()'.
+    std::vector<ext::sf::Vector2d> moves(max_heading_ - min_heading_ + 1);
+    for (i32 heading = min_heading_; heading <= max_heading_; ++heading)
+    {
+        const double angle = starting_angle + heading * delta_angle;
+        moves[heading - min_heading_] = {Turtle::step_ * std::cos(angle),
+                                         Turtle::step_ * -std::sin(angle)};
+    }
+
+    // The positions are accumulated in double precision, like the turtle: the
+    // positions of the parents of the branches are kept until their branches.
+    const auto& branches = vertices.branches;
+    std::vector<u32> parents;
+    parents.reserve(branches.size());
+    for (const auto& branch : branches)
+    {
+        parents.push_back(branch.parent);
+    }
+    std::sort(begin(parents), end(parents));
+    parents.erase(std::unique(begin(parents), end(parents)), end(parents));
+    std::vector<ext::sf::Vector2d> parent_positions(parents.size());
+
+    // The quantized positions are replaced, not dequantized.
+    vertices.quantized = QuantizedPositions();
+    auto& positions = vertices.positions;
+    positions.resize(headings_.size());
+    ext::sf::Vector2d position {0, 0};
+    const auto& ordinals = vertices.ordinals;
+    auto branch = begin(branches);
+    auto parent = begin(parents);
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        // The first vertex of a branch is never merged: it is a single move.
+        double n_moves = ordinals.empty() || i == 0 ? 1 : ordinals[i] - ordinals[i - 1];
+        if (branch != end(branches) && branch->first == i)
+        {
+            n_moves = 1;
+            const auto rank = std::lower_bound(begin(parents), end(parents), branch->parent)
+                              - begin(parents);
+            position = parent_positions[rank];
+            ++branch;
+        }
+        if (headings_[i] != no_move)
+        {
+            position += n_moves * moves[headings_[i] - min_heading_];
+        }
+        positions[i] = sf::Vector2f(position);
+        if (parent != end(parents) && *parent == i)
+        {
+            parent_positions[parent - begin(parents)] = position;
+            ++parent;
+        }
+    }
+}
+} // namespace drawing
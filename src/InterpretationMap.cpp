@@ -4,15 +4,34 @@
 
 namespace drawing
 {
+namespace
+{
+// Add a vertex at the position of 'turtle', child of the vertex of its state.
+void add_vertex(Turtle& turtle)
+{
+    auto& vertices = turtle.vertices_;
+    const auto index = static_cast<u32>(turtle.first_vertex_ + vertices.size());
+    // The first vertex has no parent.
+    if (index > 0 && turtle.state_.vertex + 1 != index)
+    {
+        vertices.branches.push_back({index, turtle.state_.vertex});
+    }
+    vertices.push_back(sf::Vector2f(turtle.state_.position));
+    turtle.state_.vertex = index;
+    if (turtle.track_iterations_)
+    {
+        turtle.iterations_.push_back(turtle.iteration_depth_);
+    }
+}
+} // namespace
+
 void go_forward_fn(Turtle& turtle)
 {
     // Go forward following the direction vector.
     double dx = drawing::Turtle::step_ * turtle.state_.direction.x;
     double dy = drawing::Turtle::step_ * -turtle.state_.direction.y;
     turtle.state_.position += {dx, dy};
-    turtle.vertices_.emplace_back(sf::Vector2f(turtle.state_.position));
-    turtle.iterations_.push_back(turtle.iteration_depth_);
-    turtle.transparency_.push_back(false);
+    add_vertex(turtle);
 }
 
 void turn_left_fn(Turtle& turtle)
@@ -33,33 +52,44 @@ void turn_right_fn(Turtle& turtle)
     turtle.state_.direction = v;
 }
 
+void go_forward_fn(Turtle& turtle, double step)
+{
+    double dx = step * turtle.state_.direction.x;
+    double dy = step * -turtle.state_.direction.y;
+    turtle.state_.position += {dx, dy};
+    add_vertex(turtle);
+}
+
+void turn_left_fn(Turtle& turtle, double angle)
+{
+    const double cos = std::cos(angle);
+    const double sin = std::sin(angle);
+    ext::sf::Vector2d v {turtle.state_.direction.x * cos - turtle.state_.direction.y * sin,
+                         turtle.state_.direction.x * sin + turtle.state_.direction.y * cos};
+    turtle.state_.direction = v;
+}
+
+void turn_right_fn(Turtle& turtle, double angle)
+{
+    turn_left_fn(turtle, -angle);
+}
+
 void save_position_fn(Turtle& turtle)
 {
-    turtle.stack_.push(turtle.state_);
+    turtle.stack_.push_back(turtle.state_);
 }
 
 void load_position_fn(Turtle& turtle)
 {
-    if (turtle.stack_.empty() || turtle.vertices_.empty())
+    if (turtle.stack_.empty())
     {
         // Do nothing
     }
     else
     {
-        turtle.vertices_.emplace_back(turtle.vertices_.back().position, sf::Color::Transparent);
-        turtle.state_ = turtle.stack_.top();
-        turtle.vertices_.emplace_back(sf::Vector2f(turtle.state_.position), sf::Color::Transparent);
-        turtle.vertices_.emplace_back(sf::Vector2f(turtle.state_.position));
-
-        turtle.iterations_.push_back(turtle.iteration_depth_);
-        turtle.iterations_.push_back(turtle.iteration_depth_);
-        turtle.iterations_.push_back(turtle.iteration_depth_);
-
-        turtle.transparency_.push_back(true);
-        turtle.transparency_.push_back(true);
-        turtle.transparency_.push_back(false);
-
-        turtle.stack_.pop();
+        // The next vertex starts a branch from the vertex of the loaded state.
+        turtle.state_ = turtle.stack_.back();
+        turtle.stack_.pop_back();
     }
 }
 
@@ -71,4 +101,14 @@ InterpretationMap::InterpretationMap(std::initializer_list<typename Rules::value
     : RuleMap<Order>(init)
 {
 }
+
+OrderTable compile_orders(const InterpretationMap& interpretation)
+{
+    OrderTable table {};
+    for (const auto& [symbol, order] : interpretation.get_rules())
+    {
+        table[derivation::index(symbol)] = order.id;
+    }
+    return table;
+}
 } // namespace drawing
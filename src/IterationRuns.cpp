@@ -0,0 +1,89 @@
+#include "IterationRuns.h"
+
+#include "gsl/gsl"
+
+#include <algorithm>
+
+IterationRuns::IterationRuns(const std::vector<u8>& iterations)
+{
+    for (u8 iteration : iterations)
+    {
+        push_back(iteration);
+    }
+}
+
+IterationRuns::IterationRuns(std::size_t count, u8 iteration)
+{
+    push_back(iteration, count);
+}
+
+void IterationRuns::append(const IterationRuns& other, u8 increment)
+{
+    std::size_t begin = 0;
+    for (const auto& [iteration, end] : other.runs_)
+    {
+        push_back(iteration + increment, end - begin);
+        begin = end;
+    }
+}
+
+void IterationRuns::clear()
+{
+    runs_.clear();
+}
+
+void IterationRuns::reserve(std::size_t n_runs)
+{
+    runs_.reserve(n_runs);
+}
+
+bool IterationRuns::empty() const
+{
+    return runs_.empty();
+}
+
+const std::vector<IterationRuns::Run>& IterationRuns::runs() const
+{
+    return runs_;
+}
+
+std::size_t IterationRuns::run_of(std::size_t i) const
+{
+    Expects(i < size());
+    return std::upper_bound(begin(runs_),
+                            end(runs_),
+                            i,
+                            [](std::size_t i, const Run& run) { return i < run.end; })
+           - begin(runs_);
+}
+
+u8 IterationRuns::at(std::size_t i) const
+{
+    return runs_[run_of(i)].iteration;
+}
+
+std::vector<u8> IterationRuns::decode() const
+{
+    std::vector<u8> iterations;
+    iterations.reserve(size());
+    for (const auto& [iteration, end] : runs_)
+    {
+        iterations.resize(end, iteration);
+    }
+    return iterations;
+}
+
+std::size_t IterationRuns::bytes() const
+{
+    return runs_.size() * sizeof(Run);
+}
+
+bool IterationRuns::operator==(const IterationRuns& other) const
+{
+    return runs_ == other.runs_;
+}
+
+bool IterationRuns::operator!=(const IterationRuns& other) const
+{
+    return !(*this == other);
+}
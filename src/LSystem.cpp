@@ -1,19 +1,23 @@
 #include "LSystem.h"
 
+#include "derivation.h"
 #include "gsl/gsl"
+#include "size_computer.h"
 
+#include <algorithm>
 #include <utility>
 
 
 // Some functions returns references to axiom or production that could be empty.
 // In these cases, it returns this string.
 const static std::string empty_string;
+const static IterationRuns empty_iterations;
 
 LSystem::LSystem(const std::string& axiom, const Rules& prod, std::string preds)
     : RuleMap<std::string>(prod)
     , iteration_predecessors_ {std::move(preds)}
     , production_cache_ {{0, axiom}}
-    , iteration_count_cache_ {{0, {std::vector<u8>(axiom.size(), 0), 0}}}
+    , iteration_count_cache_ {{0, {IterationRuns(axiom.size(), 0), 0}}}
 {
 }
 
@@ -45,54 +49,591 @@ const LSystem::IterationCache& LSystem::get_iteration_cache() const
     return iteration_count_cache_;
 }
 
+const LSystem::PackedCache& LSystem::get_packed_cache() const
+{
+    return packed_cache_;
+}
+
 void LSystem::set_axiom(const std::string& axiom)
 {
     production_cache_ = {{0, axiom}};
-    iteration_count_cache_ = {{0, {std::vector<u8>(axiom.size(), 0), 0}}};
+    iteration_count_cache_ = {{0, {IterationRuns(axiom.size(), 0), 0}}};
+    packed_cache_.clear();
+    parametric_cache_.clear();
     indicate_modification();
 }
 
 void LSystem::add_rule(char predecessor, const Successor& successor)
 {
-    production_cache_ = {{0, get_axiom()}};
-    iteration_count_cache_ = {{0, {std::vector<u8>(get_axiom().size(), 0), 0}}};
+    auto it = rules_.find(predecessor);
+    if (it == end(rules_) || it->second != successor)
+    {
+        invalidate_cache(std::string(1, predecessor));
+    }
     RuleMap::add_rule(predecessor, successor);
 }
 
 void LSystem::remove_rule(char predecessor)
 {
-    production_cache_ = {{0, get_axiom()}};
-    iteration_count_cache_ = {{0, {std::vector<u8>(get_axiom().size(), 0), 0}}};
+    invalidate_cache(std::string(1, predecessor));
+    stochastic_rules_.erase(predecessor);
+    context_rules_.erase(predecessor);
     RuleMap::remove_rule(predecessor);
 }
 
 void LSystem::clear_rules()
 {
-    production_cache_ = {{0, get_axiom()}};
-    iteration_count_cache_ = {{0, {{std::vector<u8>(get_axiom().size(), 0)}, 0}}};
+    std::string predecessors;
+    for (const auto& [predecessor, _] : rules_)
+    {
+        predecessors += predecessor;
+    }
+    invalidate_cache(predecessors);
+    stochastic_rules_.clear();
+    context_rules_.clear();
     RuleMap::clear_rules();
 }
 
 void LSystem::replace_rules(const Rules& new_rules)
 {
-    production_cache_ = {{0, get_axiom()}};
-    iteration_count_cache_ = {{0, {{std::vector<u8>(get_axiom().size(), 0)}, 0}}};
+    // Only the rules added, removed or whose successor changed are edited.
+    std::string predecessors;
+    for (const auto& [predecessor, successor] : rules_)
+    {
+        auto it = new_rules.find(predecessor);
+        if (it == end(new_rules) || it->second != successor)
+        {
+            predecessors += predecessor;
+        }
+    }
+    for (const auto& [predecessor, _] : new_rules)
+    {
+        if (rules_.count(predecessor) == 0)
+        {
+            predecessors += predecessor;
+        }
+    }
+    invalidate_cache(predecessors);
+    for (auto it = begin(stochastic_rules_); it != end(stochastic_rules_);)
+    {
+        it = new_rules.count(it->first) == 0 ? stochastic_rules_.erase(it) : std::next(it);
+    }
+    for (auto it = begin(context_rules_); it != end(context_rules_);)
+    {
+        it = new_rules.count(it->first) == 0 ? context_rules_.erase(it) : std::next(it);
+    }
     RuleMap::replace_rules(new_rules);
 }
 
+void LSystem::invalidate_cache(const std::string& predecessors)
+{
+    if (production_cache_.count(0) == 0)
+    {
+        production_cache_ = {{0, get_axiom()}};
+        iteration_count_cache_ = {{0, {IterationRuns(get_axiom().size(), 0), 0}}};
+        packed_cache_.clear();
+        parametric_cache_.clear();
+        return;
+    }
+    if (predecessors.empty())
+    {
+        return;
+    }
+
+    // A parametric production is not analysed: it is derived again.
+    parametric_cache_.clear();
+
+    derivation::SymbolSet edited;
+    for (char c : predecessors)
+    {
+        edited.set(derivation::index(c));
+    }
+
+    // The packed iterations may be above all the unpacked ones.
+    u8 highest = 0;
+    for (const auto& [i, _] : production_cache_)
+    {
+        highest = std::max(highest, i);
+    }
+    for (const auto& [i, _] : iteration_count_cache_)
+    {
+        highest = std::max(highest, i);
+    }
+    for (const auto& [i, _] : packed_cache_)
+    {
+        highest = std::max(highest, i);
+    }
+
+    // The iteration 'k+1' is the first one derived from an edited symbol.
+    const auto table = compile_rules();
+    const auto symbols = derivation::symbols_per_iteration(table, get_axiom(), highest);
+    for (u8 k = 0; k < symbols.size(); ++k)
+    {
+        if ((symbols.at(k) & edited).none())
+        {
+            continue;
+        }
+
+        for (auto it = begin(production_cache_); it != end(production_cache_);)
+        {
+            it = it->first > k ? production_cache_.erase(it) : std::next(it);
+        }
+        for (auto it = begin(iteration_count_cache_); it != end(iteration_count_cache_);)
+        {
+            it = it->first > k ? iteration_count_cache_.erase(it) : std::next(it);
+        }
+        for (auto it = begin(packed_cache_); it != end(packed_cache_);)
+        {
+            it = it->first > k ? packed_cache_.erase(it) : std::next(it);
+        }
+        return;
+    }
+}
+
 void LSystem::set_iteration_predecessors(const std::string& predecessors)
 {
-    iteration_count_cache_ = {{0, {std::vector<u8>(get_axiom().size(), 0), 0}}};
+    iteration_count_cache_ = {{0, {IterationRuns(get_axiom().size(), 0), 0}}};
+    parametric_cache_.clear();
     iteration_predecessors_ = predecessors;
     indicate_modification();
 }
 
+const LSystem::StochasticRules& LSystem::get_stochastic_rules() const
+{
+    return stochastic_rules_;
+}
+
+bool LSystem::is_stochastic() const
+{
+    return !stochastic_rules_.empty();
+}
+
+void LSystem::add_stochastic_successor(char predecessor, const Successor& successor, double weight)
+{
+    Expects(has_predecessor(predecessor));
+    Expects(weight > 0);
+
+    invalidate_cache(std::string(1, predecessor));
+    stochastic_rules_[predecessor].push_back({successor, weight});
+    indicate_modification();
+}
+
+void LSystem::clear_stochastic_successors(char predecessor)
+{
+    if (stochastic_rules_.count(predecessor) == 0)
+    {
+        return;
+    }
+
+    invalidate_cache(std::string(1, predecessor));
+    stochastic_rules_.erase(predecessor);
+    indicate_modification();
+}
+
+u64 LSystem::get_seed() const
+{
+    return seed_;
+}
+
+void LSystem::set_seed(u64 seed)
+{
+    if (seed == seed_)
+    {
+        return;
+    }
+
+    // Only the iterations derived from the stochastic symbols change.
+    std::string predecessors;
+    for (const auto& [predecessor, _] : stochastic_rules_)
+    {
+        predecessors += predecessor;
+    }
+    invalidate_cache(predecessors);
+    seed_ = seed;
+    indicate_modification();
+}
+
+const LSystem::ContextRules& LSystem::get_context_rules() const
+{
+    return context_rules_;
+}
+
+bool LSystem::is_context_sensitive() const
+{
+    return !context_rules_.empty();
+}
+
+bool LSystem::is_expandable() const
+{
+    return !is_stochastic() && !is_context_sensitive();
+}
+
+void LSystem::add_context_rule(char predecessor,
+                               const std::string& left,
+                               const Successor& successor,
+                               const std::string& right)
+{
+    Expects(has_predecessor(predecessor));
+    Expects(left.size() <= 1 && right.size() <= 1);
+
+    invalidate_cache(std::string(1, predecessor));
+    context_rules_[predecessor].push_back({left, successor, right});
+    indicate_modification();
+}
+
+void LSystem::clear_context_rules(char predecessor)
+{
+    if (context_rules_.count(predecessor) == 0)
+    {
+        return;
+    }
+
+    invalidate_cache(std::string(1, predecessor));
+    context_rules_.erase(predecessor);
+    indicate_modification();
+}
+
+const std::string& LSystem::get_context_ignored() const
+{
+    return context_ignored_;
+}
+
+void LSystem::set_context_ignored(const std::string& ignored)
+{
+    if (ignored == context_ignored_)
+    {
+        return;
+    }
+
+    // Only the iterations derived from the context-sensitive symbols change.
+    std::string predecessors;
+    for (const auto& [predecessor, _] : context_rules_)
+    {
+        predecessors += predecessor;
+    }
+    invalidate_cache(predecessors);
+    context_ignored_ = ignored;
+    indicate_modification();
+}
+
+const LSystem::ParametricRules& LSystem::get_parametric_rules() const
+{
+    return parametric_rules_;
+}
+
+bool LSystem::is_parametric() const
+{
+    return !parametric_rules_.empty();
+}
+
+void LSystem::add_parametric_rule(const parametric::ParametricRule& rule)
+{
+    Expects(parametric::compile_rules({rule}));
+
+    parametric_cache_.clear();
+    parametric_rules_.push_back(rule);
+    indicate_modification();
+}
+
+void LSystem::clear_parametric_rules()
+{
+    if (parametric_rules_.empty())
+    {
+        return;
+    }
+
+    parametric_cache_.clear();
+    parametric_rules_.clear();
+    indicate_modification();
+}
+
+std::size_t LSystem::get_cache_budget() const
+{
+    return cache_budget_;
+}
+
+void LSystem::set_cache_budget(std::size_t budget)
+{
+    cache_budget_ = budget;
+}
+
+std::size_t LSystem::get_block_budget() const
+{
+    return block_budget_;
+}
+
+void LSystem::set_block_budget(std::size_t budget)
+{
+    block_budget_ = budget;
+}
+
+std::size_t LSystem::get_packing_threshold() const
+{
+    return packing_threshold_;
+}
+
+void LSystem::set_packing_threshold(std::size_t threshold)
+{
+    packing_threshold_ = threshold;
+}
+
+std::size_t LSystem::cache_size() const
+{
+    std::size_t size = 0;
+    for (const auto& [_, production] : production_cache_)
+    {
+        size += production.size();
+    }
+    for (const auto& [_, iteration] : iteration_count_cache_)
+    {
+        size += iteration.first.bytes();
+    }
+    for (const auto& [_, packed] : packed_cache_)
+    {
+        size += packed.bytes();
+    }
+    return size;
+}
+
+void LSystem::touch(u8 n)
+{
+    cache_last_use_[n] = ++cache_clock_;
+}
+
+void LSystem::enforce_cache_budget(u8 n)
+{
+    // Without any big production, nothing is packed within the budget.
+    std::size_t size = cache_size();
+    if (size <= cache_budget_ && size < packing_threshold_)
+    {
+        return;
+    }
+
+    auto least_recently_used = [this](u8 lhs, u8 rhs) {
+        return cache_last_use_[lhs] < cache_last_use_[rhs];
+    };
+
+    // The evictable iterations, from the least to the most recently used.
+    std::vector<u8> candidates;
+    for (const auto& [i, _] : production_cache_)
+    {
+        if (i != 0 && i != n)
+        {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(begin(candidates), end(candidates), least_recently_used);
+    // The most recently used iteration is kept.
+    if (!candidates.empty())
+    {
+        candidates.pop_back();
+    }
+
+    // First, pack the big iterations, then the others until the caches fit
+    // in the budget. Their iteration counts are kept. Packing is useless if
+    // the alphabet is too big: the iterations are then evicted.
+    const auto symbols = alphabet();
+    const bool is_packable = derivation::PackedProduction::bits_per_symbol(symbols.size()) < 8;
+    for (u8 i : candidates)
+    {
+        const auto production_size = production_cache_.at(i).size();
+        if (size <= cache_budget_ && !(is_packable && production_size >= packing_threshold_))
+        {
+            continue;
+        }
+        size -= production_size;
+        if (is_packable)
+        {
+            const auto& [it, _] =
+                packed_cache_.try_emplace(i, production_cache_.at(i), symbols);
+            size += it->second.bytes();
+        }
+        else if (iteration_count_cache_.count(i) > 0)
+        {
+            size -= iteration_count_cache_.at(i).first.bytes();
+            iteration_count_cache_.erase(i);
+        }
+        production_cache_.erase(i);
+    }
+
+    // Then, evict the packed iterations and their iteration counts.
+    candidates.clear();
+    for (const auto& [i, _] : packed_cache_)
+    {
+        candidates.push_back(i);
+    }
+    std::sort(begin(candidates), end(candidates), least_recently_used);
+    for (u8 i : candidates)
+    {
+        if (size <= cache_budget_)
+        {
+            return;
+        }
+        size -= packed_cache_.at(i).bytes();
+        packed_cache_.erase(i);
+        if (iteration_count_cache_.count(i) > 0)
+        {
+            size -= iteration_count_cache_.at(i).first.bytes();
+            iteration_count_cache_.erase(i);
+        }
+    }
+}
+
+void LSystem::unpack(u8 n)
+{
+    if (packed_cache_.count(n) > 0)
+    {
+        production_cache_.try_emplace(n, packed_cache_.at(n).unpack());
+        packed_cache_.erase(n);
+    }
+}
+
+std::string LSystem::alphabet() const
+{
+    std::string symbols = get_axiom();
+    for (const auto& [predecessor, successor] : rules_)
+    {
+        symbols += predecessor;
+        symbols += successor;
+    }
+    for (const auto& [_, successors] : stochastic_rules_)
+    {
+        for (const auto& [successor, weight] : successors)
+        {
+            symbols += successor;
+        }
+    }
+    for (const auto& [_, rules] : context_rules_)
+    {
+        for (const auto& rule : rules)
+        {
+            symbols += rule.successor;
+        }
+    }
+    std::sort(begin(symbols), end(symbols));
+    symbols.erase(std::unique(begin(symbols), end(symbols)), end(symbols));
+    return symbols;
+}
+
+std::optional<derivation::ExpansionLengths> LSystem::expansion_lengths(u8 n) const
+{
+    const auto symbols = alphabet();
+
+    // By default, a symbol not in 'symbols' is never expanded.
+    std::array<std::size_t, derivation::table_size> ones;
+    ones.fill(1);
+    derivation::ExpansionLengths lengths(n + 1, ones);
+    if (symbols.empty())
+    {
+        return lengths;
+    }
+
+    // The lengths after 'k' iterations are the product of the rules matrix
+    // and the lengths after 'k-1' iterations, starting from a column of ones.
+    const auto rules_matrix = drawing::lsys_rules_matrix(*this, symbols);
+    using column = std::vector<std::vector<drawing::Matrix::number>>;
+    drawing::Matrix expansion(column(symbols.size(), {1}));
+    for (u8 k = 1; k <= n; ++k)
+    {
+        expansion = rules_matrix * expansion;
+        if (expansion.has_overflowed())
+        {
+            return std::nullopt;
+        }
+        for (std::size_t i = 0; i < symbols.size(); ++i)
+        {
+            lengths.at(k).at(derivation::index(symbols.at(i))) = expansion.get_data().at(i).at(0);
+        }
+    }
+    return lengths;
+}
+
+derivation::RuleTable LSystem::compile_rules() const
+{
+    return derivation::compile_rules(rules_,
+                                     iteration_predecessors_,
+                                     stochastic_rules_,
+                                     seed_,
+                                     context_rules_,
+                                     context_ignored_);
+}
+
+u8 LSystem::max_iteration(const derivation::RuleTable& table, u8 base, u8 n) const
+{
+    Expects(base <= n);
+
+    // The maximum iteration count is incremented at each iteration containing
+    // an iteration predecessor.
+    derivation::SymbolSet iteration_predecessors;
+    for (char c : iteration_predecessors_)
+    {
+        iteration_predecessors.set(derivation::index(c));
+    }
+
+    // A production derived without its iteration counts has no known
+    // maximum, and the symbols of a packed production are not read: count
+    // from the axiom.
+    if (iteration_count_cache_.count(base) == 0 || production_cache_.count(base) == 0)
+    {
+        base = 0;
+    }
+    u8 count = iteration_count_cache_.at(base).second;
+    for (const auto& symbols :
+         derivation::symbols_per_iteration(table, production_cache_.at(base), n - base))
+    {
+        if ((symbols & iteration_predecessors).any())
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool LSystem::expand_directly(const derivation::RuleTable& table, u8 n, bool with_iterations)
+{
+    auto lengths = expansion_lengths(n);
+    if (!lengths)
+    {
+        return false;
+    }
+
+    const auto& axiom = production_cache_.at(0);
+    std::size_t size = 0;
+    for (char c : axiom)
+    {
+        size += lengths->at(n).at(derivation::index(c));
+    }
+    if (size < derivation::direct_expansion_threshold)
+    {
+        return false;
+    }
+
+    // The small subtrees are memoized and copied as blocks.
+    const derivation::ExpansionBlocks blocks(table, *lengths, n, block_budget_);
+
+    std::string production;
+    IterationRuns iteration;
+    derivation::expand(table,
+                       *lengths,
+                       blocks,
+                       axiom,
+                       n,
+                       production,
+                       with_iterations ? &iteration : nullptr,
+                       derivation::derivation_thread_count(size));
+    production_cache_.try_emplace(n, std::move(production));
+    if (with_iterations)
+    {
+        iteration_count_cache_.try_emplace(n, std::move(iteration), max_iteration(table, 0, n));
+    }
+    return true;
+}
 
 // Edge Cases:
 //   - If 'production_cache_' is empty so does not contains the axiom, simply
 //   returns an empty string.
 //   - If the axiom is an empty string, early-out.
-LSystem::LSystemProduction LSystem::produce(u8 n, unsigned long long size)
+LSystem::LSystemProduction LSystem::produce(u8 n, bool with_iterations)
 {
     Expects(n >= 0);
 
@@ -100,119 +641,138 @@ LSystem::LSystemProduction LSystem::produce(u8 n, unsigned long long size)
     {
         // We do not have any axiom so nothing to produce.
         Expects(production_cache_.count(0) == production_cache_.count(0));
-        return {empty_string, {}, 0};
+        return {empty_string, empty_iterations, 0};
     }
 
+    // A packed production is unpacked rather than derived again.
+    unpack(n);
+
     if (production_cache_.count(n) > 0 && iteration_count_cache_.count(n) > 0)
     {
-        // A solution was already computed.
+        // A solution was already computed. It may have been unpacked.
+        touch(n);
+        enforce_cache_budget(n);
+        if (!with_iterations)
+        {
+            return {production_cache_.at(n), empty_iterations, iteration_count_cache_.at(n).second};
+        }
         return {production_cache_.at(n),
                 iteration_count_cache_.at(n).first,
                 iteration_count_cache_.at(n).second};
     }
 
-    // The caches saves all the iteration from the start. So we get
-    // the highest-iteration result for each cache.
-    auto highest_production = std::max_element(
-        production_cache_.begin(),
-        production_cache_.end(),
-        [](const auto& pair1, const auto& pair2) { return pair1.first < pair2.first; });
-    auto highest_iteration = std::max_element(
-        iteration_count_cache_.begin(),
-        iteration_count_cache_.end(),
-        [](const auto& pair1, const auto& pair2) { return pair1.first < pair2.first; });
-
-    // Invariant check: the production cache element count must be equal or
-    // greater than the iteration one.
-    Expects(highest_production->first >= highest_iteration->first);
-
-    // 'iteration_predecessors_' is conveniently a std::string. But checking if
-    // a predecessor is inside this string is done every time in the loop. To
-    // have a little bit more performance, a map is created to have O(1) acess
-    // to this information.
-    std::unordered_map<char, bool> is_iteration_pred;
-    for (char c : iteration_predecessors_)
+    // The rules are frozen into a dense dispatch table: the derivation loop
+    // does not hash each symbol.
+    const auto table = compile_rules();
+
+    if (!with_iterations && production_cache_.count(n) > 0)
     {
-        is_iteration_pred[c] = true;
+        touch(n);
+        enforce_cache_budget(n);
+        return {production_cache_.at(n), empty_iterations, max_iteration(table, n, n)};
     }
 
-    int max_iteration = highest_iteration->second.second;
-    u8 n_iter = n - highest_iteration->first;
-    for (u8 i = 0; i < n_iter; ++i)
+    // The caches may not contain all the iterations. So we start from the
+    // highest iteration computed before 'n', packed or not. Without the
+    // iteration counts, any cached production is a valid start.
+    u8 base = 0;
+    auto is_base = [&](u8 i) {
+        return i < n && i > base && (!with_iterations || iteration_count_cache_.count(i) > 0);
+    };
+    for (const auto& [i, _] : production_cache_)
+    {
+        base = is_base(i) ? i : base;
+    }
+    for (const auto& [i, _] : packed_cache_)
     {
-        // We start iterating from the iteration's highest iteration.
-        const std::string& base_production = production_cache_.at(highest_iteration->first + i);
-        const auto& [base_iteration, _] = iteration_count_cache_.at(highest_iteration->first + i);
+        base = is_base(i) ? i : base;
+    }
+    unpack(base);
 
-        // We use temporary results: we can't iterate "in place".
-        std::string tmp_production;
-        std::vector<u8> tmp_iteration;
-        tmp_production.reserve(size);
-        tmp_iteration.reserve(size);
+    // Invariant check: an iteration count is always computed from its
+    // production.
+    Expects(production_cache_.count(base) > 0);
 
-        // If 'true', computes only the iteration vector and not the resulting
-        // production string.
-        bool only_iteration = highest_iteration->first + i + 1 < highest_production->first;
+    // A fresh deterministic system with a big production is expanded
+    // directly from the axiom: the intermediate iterations are never created.
+    if (base == 0 && n > 1 && production_cache_.count(n) == 0 && packed_cache_.count(n) == 0
+        && derivation::is_expandable(table) && expand_directly(table, n, with_iterations))
+    {
+        touch(n);
+        enforce_cache_budget(n);
+        if (!with_iterations)
+        {
+            return {production_cache_.at(n), empty_iterations, max_iteration(table, n, n)};
+        }
+        return {production_cache_.at(n),
+                iteration_count_cache_.at(n).first,
+                iteration_count_cache_.at(n).second};
+    }
 
-        // If during the derivation a rule with a 'iteration_predecessors_' is used,
-        // new iteration is set to true
-        bool is_new_iteration = false;
+    const IterationRuns no_iteration {};
+    int max_iteration = with_iterations ? iteration_count_cache_.at(base).second : 0;
+    for (u8 i = base; i < n; ++i)
+    {
+        // If the production of the next iteration was not kept, derive it
+        // again from the current one.
+        const std::string& base_production = production_cache_.at(i);
+        const auto& base_iteration =
+            with_iterations ? iteration_count_cache_.at(i).first : no_iteration;
 
+        // A packed production is unpacked rather than derived again.
+        unpack(i + 1);
 
-        for (auto j = 0u; j < base_iteration.size(); ++j)
+        // If 'true', computes only the iteration vector and not the resulting
+        // production string, as it is already cached.
+        bool only_iteration = production_cache_.count(i + 1) > 0;
+        if (only_iteration && (!with_iterations || iteration_count_cache_.count(i + 1) > 0))
         {
-            char c = base_production.at(j);
-            int successor_count = 0;
-
-            if (rules_.count(c) > 0)
-            {
-                // Add n element to the iteration vector, n corresponding to the
-                // successor size.
-                successor_count = rules_.at(c).size();
-
-                if (!only_iteration)
-                {
-                    std::string derivation = rules_.at(c);
-
-                    // Replace the symbol according to its rule.
-                    tmp_production.insert(tmp_production.end(),
-                                          derivation.begin(),
-                                          derivation.end());
-                }
-            }
-            else // The identity rule
+            if (with_iterations)
             {
-                // Add only one element.
-                successor_count = 1;
-
-                if (!only_iteration)
-                {
-                    // The symbol is a terminal: replace it by itself.
-                    tmp_production.push_back(c);
-                }
+                max_iteration = iteration_count_cache_.at(i + 1).second;
             }
-
-            // If the current predecessor must be counted, add 1 to each element
-            // of the successor.
-            u8 order = base_iteration.at(j);
-            if (is_iteration_pred[c])
-            {
-                order += 1;
-                is_new_iteration = true;
-            }
-            tmp_iteration.insert(end(tmp_iteration), successor_count, order);
+            touch(i + 1);
+            enforce_cache_budget(i + 1);
+            continue;
         }
 
+        // We use temporary results: we can't iterate "in place". As the size
+        // of the derivation is known, the buffers are allocated exactly once.
+        // Big productions are derived by several threads.
+        std::string tmp_production;
+        IterationRuns tmp_iteration;
+
+        const auto n_threads = derivation::derivation_thread_count(base_production.size());
+
+        // If during the derivation a rule with a 'iteration_predecessors_' is used,
+        // new iteration is set to true
+        bool is_new_iteration =
+            derivation::derive_iteration(table,
+                                         base_production,
+                                         base_iteration,
+                                         only_iteration ? nullptr : &tmp_production,
+                                         with_iterations ? &tmp_iteration : nullptr,
+                                         n_threads,
+                                         i + 1);
+
         if (!only_iteration)
         {
-            production_cache_.try_emplace(highest_iteration->first + i + 1,
-                                          std::move(tmp_production));
+            production_cache_.try_emplace(i + 1, std::move(tmp_production));
         }
 
-        iteration_count_cache_.try_emplace(highest_iteration->first + i + 1,
-                                           std::move(tmp_iteration),
-                                           is_new_iteration ? max_iteration + 1 : max_iteration);
-        max_iteration = iteration_count_cache_.at(highest_iteration->first + i + 1).second;
+        if (with_iterations)
+        {
+            iteration_count_cache_.try_emplace(i + 1,
+                                               std::move(tmp_iteration),
+                                               is_new_iteration ? max_iteration + 1
+                                                                : max_iteration);
+            max_iteration = iteration_count_cache_.at(i + 1).second;
+        }
+
+        // The iteration 'i' is not needed anymore: it can be evicted to
+        // derive the next one.
+        touch(i + 1);
+        enforce_cache_budget(i + 1);
     }
 
     // No 'indicate_modification()' call: this function is generally called each
@@ -221,10 +781,140 @@ LSystem::LSystemProduction LSystem::produce(u8 n, unsigned long long size)
     // 'drawing::compute_vertices()' function.
 
     // Ensures invariant.
-    Ensures(production_cache_.size() >= iteration_count_cache_.size());
+    Ensures(production_cache_.size() + packed_cache_.size() >= iteration_count_cache_.size());
+
+    if (!with_iterations)
+    {
+        return {production_cache_.at(n), empty_iterations, this->max_iteration(table, n, n)};
+    }
 
     LSystemProduction production {production_cache_.at(n),
                                   iteration_count_cache_.at(n).first,
                                   iteration_count_cache_.at(n).second};
     return production;
 }
+
+LSystem::LSystemStream LSystem::stream(u8 n, bool with_iterations) const
+{
+    if (production_cache_.count(0) == 0)
+    {
+        // We do not have any axiom so nothing to stream.
+        return {{}, 0};
+    }
+
+    const auto table = compile_rules();
+
+    // Start from the highest iteration cached before or at 'n', packed or
+    // not: fewer iterations are expanded for each symbol. The contexts are
+    // computed on a whole unpacked base.
+    u8 base = 0;
+    auto is_base = [&](u8 i) {
+        return i <= n && i > base && (!with_iterations || iteration_count_cache_.count(i) > 0);
+    };
+    for (const auto& [i, _] : production_cache_)
+    {
+        base = is_base(i) ? i : base;
+    }
+    for (const auto& [i, _] : packed_cache_)
+    {
+        base = is_base(i) && (!table.is_context_sensitive || i == n) ? i : base;
+    }
+
+    // The random choices and the contexts of the successors are only known
+    // for the symbols of the base.
+    Expects(derivation::is_expandable(table) || base + 1 >= n);
+
+    const IterationRuns* base_iteration =
+        with_iterations ? &iteration_count_cache_.at(base).first : nullptr;
+    if (packed_cache_.count(base) > 0)
+    {
+        return {derivation::SymbolStream(
+                    table, packed_cache_.at(base), base_iteration, n - base, base),
+                max_iteration(table, base, n)};
+    }
+    return {derivation::SymbolStream(
+                table, production_cache_.at(base), base_iteration, n - base, base),
+            max_iteration(table, base, n)};
+}
+
+LSystem::LSystemExpansion LSystem::expansion(u8 n) const
+{
+    Expects(is_expandable());
+
+    if (production_cache_.count(0) == 0)
+    {
+        // We do not have any axiom so nothing to expand.
+        return {{}, {}, 0};
+    }
+
+    auto table = compile_rules();
+    const u8 max_iteration = this->max_iteration(table, 0, n);
+    return {std::move(table), production_cache_.at(0), max_iteration};
+}
+
+std::optional<derivation::ProductionDag> LSystem::production_dag(u8 n) const
+{
+    if (production_cache_.count(0) == 0 || !is_expandable())
+    {
+        return std::nullopt;
+    }
+
+    const auto lengths = expansion_lengths(n);
+    if (!lengths)
+    {
+        return std::nullopt;
+    }
+
+    const auto table = compile_rules();
+    return derivation::ProductionDag(table, *lengths, production_cache_.at(0), n);
+}
+
+const parametric::Production& LSystem::produce_parametric(u8 n)
+{
+    Expects(is_parametric());
+
+    if (parametric_cache_.count(0) == 0)
+    {
+        auto axiom = parametric::parse_production(get_axiom());
+        parametric_cache_.try_emplace(0, axiom ? std::move(*axiom) : parametric::Production {});
+    }
+    if (parametric_cache_.count(n) > 0)
+    {
+        return parametric_cache_.at(n);
+    }
+
+    // The rules without parameters are tried after the parametric rules. A
+    // successor which is not a valid string of modules is ignored.
+    auto rules = parametric_rules_;
+    for (const auto& [predecessor, successor] : rules_)
+    {
+        parametric::ParametricRule rule {std::string(1, predecessor), "", successor};
+        if (parametric::compile_rules({rule}))
+        {
+            rules.push_back(std::move(rule));
+        }
+    }
+    const auto table = parametric::compile_rules(rules, iteration_predecessors_);
+    Expects(table);
+
+    // Start from the highest iteration cached before 'n'.
+    u8 base = 0;
+    for (const auto& [i, _] : parametric_cache_)
+    {
+        base = i < n && i > base ? i : base;
+    }
+
+    const parametric::Production* current = &parametric_cache_.at(base);
+    parametric::Production production;
+    parametric::Production next;
+    for (u8 i = base; i < n; ++i)
+    {
+        parametric::derive(*table,
+                           *current,
+                           next,
+                           derivation::derivation_thread_count(current->symbols.size()));
+        std::swap(production, next);
+        current = &production;
+    }
+    return parametric_cache_.try_emplace(n, std::move(production)).first->second;
+}
@@ -9,6 +9,8 @@
 #include "helper_math.h"
 #include "procgui.h"
 
+#include <map>
+#include <sstream>
 #include <utility>
 
 namespace procgui
@@ -20,6 +22,7 @@ using namespace procgui;
 // int LSystemView::id_count_ = 0;
 UniqueId LSystemView::unique_ids_ {};
 UniqueColor LSystemView::unique_colors_ {};
+drawing::GeometryStore LSystemView::geometry_store_ {};
 
 LSystemView::LSystemView(std::string name,
                          const LSystem& lsys,
@@ -34,7 +37,8 @@ LSystemView::LSystemView(std::string name,
     , color_id_ {unique_colors_.get_color(id_)}
     , name_ {std::move(name)}
     , is_modified_ {false}
-    , turtle_ {parameters_}
+    , geometry_ {std::make_shared<const drawing::Geometry>()}
+    , colors_ {}
     , max_iteration_ {0}
     , is_selected_ {false}
     , bounding_box_is_visible_ {true}
@@ -60,7 +64,8 @@ LSystemView::LSystemView(const LSystemView& other)
     , color_id_ {unique_colors_.get_color(id_)}
     , name_ {other.name_}
     , is_modified_ {other.is_modified_}
-    , turtle_ {other.turtle_}
+    , geometry_ {other.geometry_}
+    , colors_ {other.colors_}
     , max_iteration_ {other.max_iteration_}
     , bounding_box_ {other.bounding_box_}
     , sub_boxes_ {other.sub_boxes_}
@@ -81,7 +86,8 @@ LSystemView::LSystemView(LSystemView&& other) noexcept
     , color_id_ {other.color_id_}
     , name_ {std::move(other.name_)}
     , is_modified_ {other.is_modified_}
-    , turtle_ {other.turtle_}
+    , geometry_ {std::move(other.geometry_)}
+    , colors_ {std::move(other.colors_)}
     , max_iteration_ {other.max_iteration_}
     , bounding_box_ {other.bounding_box_}
     , sub_boxes_ {std::move(other.sub_boxes_)}
@@ -115,7 +121,8 @@ LSystemView& LSystemView::operator=(const LSystemView& other)
         color_id_ = unique_colors_.get_color(id_);
         name_ = other.name_;
         is_modified_ = other.is_modified_;
-        turtle_ = other.turtle_;
+        geometry_ = other.geometry_;
+        colors_ = other.colors_;
         max_iteration_ = other.max_iteration_;
         bounding_box_ = other.bounding_box_;
         sub_boxes_ = other.sub_boxes_;
@@ -142,7 +149,8 @@ LSystemView& LSystemView::operator=(LSystemView&& other) noexcept
         color_id_ = other.color_id_;
         name_ = std::move(other.name_);
         is_modified_ = other.is_modified_;
-        turtle_ = other.turtle_;
+        geometry_ = std::move(other.geometry_);
+        colors_ = std::move(other.colors_);
         max_iteration_ = other.max_iteration_;
         bounding_box_ = other.bounding_box_;
         sub_boxes_ = std::move(other.sub_boxes_);
@@ -217,9 +225,13 @@ const VertexPainterWrapper& LSystemView::get_vertex_painter_wrapper() const
 {
     return painter_;
 }
-const drawing::Turtle& LSystemView::get_turtle() const
+const drawing::VertexArrays& LSystemView::get_vertices() const
 {
-    return turtle_;
+    return geometry_->vertices;
+}
+const std::vector<sf::Color>& LSystemView::get_colors() const
+{
+    return colors_;
 }
 int LSystemView::get_id() const
 {
@@ -351,20 +363,197 @@ void LSystemView::open_size_warning_popup()
     popups_ids_.push_back(procgui::push_popup(size_warning_popup));
 }
 
+std::string LSystemView::geometry_key(bool with_angles) const
+{
+    // Each string is prefixed by its size, so the key is not ambiguous.
+    std::ostringstream key;
+    auto append = [&key](const std::string& str) { key << str.size() << ':' << str; };
+
+    const auto& lsystem = lsystem_.get_rule_map();
+    append(lsystem.get_axiom());
+    append(lsystem.get_iteration_predecessors());
+    const std::map<char, std::string> rules(begin(lsystem.get_rules()),
+                                            end(lsystem.get_rules()));
+    for (const auto& [predecessor, successor] : rules)
+    {
+        key << predecessor;
+        append(successor);
+    }
+    const std::map<char, std::vector<derivation::WeightedSuccessor>> stochastic_rules(
+        begin(lsystem.get_stochastic_rules()),
+        end(lsystem.get_stochastic_rules()));
+    for (const auto& [predecessor, successors] : stochastic_rules)
+    {
+        key << predecessor;
+        for (const auto& [successor, weight] : successors)
+        {
+            append(successor);
+            key << std::hexfloat << weight << ' ';
+        }
+    }
+    key << '#' << lsystem.get_seed();
+    const std::map<char, std::vector<derivation::ContextRule>> context_rules(
+        begin(lsystem.get_context_rules()),
+        end(lsystem.get_context_rules()));
+    for (const auto& [predecessor, rules] : context_rules)
+    {
+        key << predecessor;
+        for (const auto& [left, successor, right] : rules)
+        {
+            append(left);
+            append(successor);
+            append(right);
+        }
+    }
+    append(lsystem.get_context_ignored());
+    for (const auto& [predecessor, condition, successor] : lsystem.get_parametric_rules())
+    {
+        append(predecessor);
+        append(condition);
+        append(successor);
+    }
+
+    key << '|';
+    const std::map<char, drawing::Order> orders(begin(map_.get_rule_map().get_rules()),
+                                                end(map_.get_rule_map().get_rules()));
+    for (const auto& [predecessor, order] : orders)
+    {
+        key << predecessor << static_cast<int>(order.id);
+    }
+
+    // The step and the starting position only change the transform.
+    key << '|' << static_cast<int>(parameters_.get_n_iter());
+    if (with_angles)
+    {
+        key << std::hexfloat << ' ' << parameters_.get_starting_angle() << ' '
+            << parameters_.get_delta_angle();
+    }
+    return key.str();
+}
+
 void LSystemView::compute_vertices()
 {
     // Invariant respected: cohesion between the vertices and the bounding
     // boxes.
 
-    const auto& [str, iterations, max_iteration] = lsystem_.ref_rule_map().produce(
-        parameters_.get_n_iter(),
-        system_size_.lsystem_size);
-    max_iteration_ = max_iteration;
-    turtle_.init_from_parameters(parameters_);
-    turtle_.compute_vertices(str, iterations, map_.get_rule_map(), system_size_.vertices_size);
-    bounding_box_ = geometry::bounding_box(turtle_.vertices_);
-    sub_boxes_ = geometry::sub_boxes(turtle_.vertices_, MAX_SUB_BOXES);
-    geometry::expand_boxes(sub_boxes_); // Add some margin
+    // The iteration depths are only computed if the painter reads them, and
+    // the collinear vertices are only merged if the painter allows it.
+    const bool needs_iterations = painter_.unwrap()->needs_iterations();
+    const bool is_merge_safe = painter_.unwrap()->is_merge_safe();
+
+    // If another view already computed the same drawing, its geometry is
+    // shared: there is nothing to derive nor interpret. A geometry computed
+    // without the iteration depths is only shared if they are not needed, and
+    // a geometry with merged vertices only if the painter allows it.
+    auto is_paintable = [&](const drawing::Geometry& geometry) {
+        return (!needs_iterations || geometry.iterations.size() == geometry.vertices.size())
+               && (is_merge_safe || geometry.vertices.ordinals.empty());
+    };
+    const auto key = geometry_key();
+    const auto stored = geometry_store_.find(key);
+    if (stored && is_paintable(*stored))
+    {
+        geometry_ = stored;
+    }
+    else if (geometry_->trace && geometry_->trace_key == geometry_key(false)
+             && is_paintable(*geometry_))
+    {
+        // Only the angles changed: the positions are rebuilt from the
+        // heading trace, without deriving nor interpreting the LSystem.
+        auto geometry = std::make_shared<drawing::Geometry>(*geometry_);
+        geometry->trace->rebuild(geometry->vertices,
+                                 parameters_.get_starting_angle(),
+                                 parameters_.get_delta_angle());
+        const auto& positions = geometry->vertices.positions;
+        geometry->bounding_box = geometry::bounding_box(positions);
+        geometry->sub_boxes = geometry::sub_boxes(positions, MAX_SUB_BOXES);
+        geometry::expand_boxes(geometry->sub_boxes); // Add some margin
+        if (geometry->vertices.size() >= MIN_QUANTIZED_VERTICES)
+        {
+            geometry->vertices.quantize();
+        }
+        geometry_ = std::move(geometry);
+    }
+    else
+    {
+        // If the expansion of a symbol only depends on the symbol and the
+        // number of iterations, the axiom is expanded and interpreted
+        // without deriving any iteration: the vertices of the expansions of a
+        // symbol are computed once, then copied and transformed at each of
+        // its occurrences.
+        // Otherwise, the last derivation step is fused with the
+        // interpretation: only the iteration before the viewed one is
+        // produced and cached, and the symbols of the viewed iteration are
+        // streamed directly to the turtle. The random choices of a stochastic
+        // system and the contexts of a context-sensitive one are only
+        // streamed from the previous iteration.
+        // A parametric system is derived and cached up to the viewed
+        // iteration: the turtle reads the parameters of its modules.
+        const auto n_iter = parameters_.get_n_iter();
+        drawing::Turtle turtle {parameters_};
+        turtle.track_iterations_ = needs_iterations;
+        turtle.track_headings_ = true;
+        turtle.merge_collinear_ = is_merge_safe;
+        u8 max_iteration = 0;
+        if (lsystem_.get_rule_map().is_parametric())
+        {
+            // The size computed for the safeguard ignores the parameters: it
+            // is not a size to reserve.
+            const auto& production = lsystem_.ref_rule_map().produce_parametric(n_iter);
+            max_iteration = production.max_iteration;
+            turtle.compute_vertices(production, map_.get_rule_map());
+        }
+        else if (lsystem_.get_rule_map().is_expandable())
+        {
+            const auto expansion = lsystem_.get_rule_map().expansion(n_iter);
+            max_iteration = expansion.max_iteration;
+            turtle.compute_vertices(expansion.table,
+                                    expansion.axiom,
+                                    n_iter,
+                                    map_.get_rule_map(),
+                                    system_size_.vertices_size);
+        }
+        else
+        {
+            if (n_iter > 0)
+            {
+                // The intermediate iterations are kept within the global size
+                // limit.
+                lsystem_.ref_rule_map().set_cache_budget(
+                    std::max(max_mem_size_, config::sys_max_size));
+                lsystem_.ref_rule_map().produce(n_iter - 1, needs_iterations);
+            }
+
+            auto stream = lsystem_.get_rule_map().stream(n_iter, needs_iterations);
+            max_iteration = stream.max_iteration;
+            turtle.compute_vertices(std::move(stream.symbols),
+                                    map_.get_rule_map(),
+                                    system_size_.vertices_size);
+        }
+
+        auto geometry = std::make_shared<drawing::Geometry>();
+        geometry->iterations = std::move(turtle.iterations_);
+        geometry->max_iteration = max_iteration;
+        geometry->bounding_box = geometry::bounding_box(turtle.vertices_.positions);
+        geometry->sub_boxes = geometry::sub_boxes(turtle.vertices_.positions, MAX_SUB_BOXES);
+        geometry::expand_boxes(geometry->sub_boxes); // Add some margin
+        if (turtle.trace_.size() == turtle.vertices_.size())
+        {
+            geometry->trace = std::make_shared<drawing::HeadingTrace>(std::move(turtle.trace_));
+            geometry->trace_key = geometry_key(false);
+        }
+        geometry->vertices = std::move(turtle.vertices_);
+        if (geometry->vertices.size() >= MIN_QUANTIZED_VERTICES)
+        {
+            geometry->vertices.quantize();
+        }
+        geometry_ = std::move(geometry);
+    }
+    geometry_store_.insert(key, geometry_);
+
+    max_iteration_ = geometry_->max_iteration;
+    bounding_box_ = geometry_->bounding_box;
+    sub_boxes_ = geometry_->sub_boxes;
 
     paint_vertices();
 }
@@ -372,9 +561,10 @@ void LSystemView::compute_vertices()
 void LSystemView::paint_vertices()
 {
     // un-transformed vertices and bounding box
-    painter_.unwrap()->paint_vertices(turtle_.vertices_,
-                                      turtle_.iterations_,
-                                      turtle_.transparency_,
+    colors_.assign(geometry_->vertices.size(), sf::Color::White);
+    painter_.unwrap()->paint_vertices(colors_,
+                                      geometry_->vertices,
+                                      geometry_->iterations,
                                       max_iteration_,
                                       bounding_box_);
     is_modified_ = true;
@@ -433,7 +623,19 @@ void LSystemView::update()
     }
     else if (painter_.poll_modification())
     {
-        paint_vertices();
+        // The geometry was computed without the iteration depths the new
+        // painter reads, or with merged vertices it does not allow.
+        const auto& painter = *painter_.unwrap();
+        if ((painter.needs_iterations()
+             && geometry_->iterations.size() != geometry_->vertices.size())
+            || (!painter.is_merge_safe() && !geometry_->vertices.ordinals.empty()))
+        {
+            compute_vertices();
+        }
+        else
+        {
+            paint_vertices();
+        }
     }
 }
 
@@ -446,7 +648,7 @@ void LSystemView::draw(sf::RenderTarget& target)
 
     // Draw a placeholder if the LSystem does not have enough vertices or
     // does not have any size.
-    if (turtle_.vertices_.size() < 2
+    if (geometry_->vertices.size() < 2
         || (bounding_box_.width < std::numeric_limits<float>::epsilon()
             && bounding_box_.height < std::numeric_limits<float>::epsilon()))
     {
@@ -455,10 +657,7 @@ void LSystemView::draw(sf::RenderTarget& target)
     }
     else // Draw the vertices.
     {
-        target.draw(turtle_.vertices_.data(),
-                    turtle_.vertices_.size(),
-                    sf::LineStrip,
-                    get_transform());
+        drawing::draw_segments(target, geometry_->vertices, colors_, draw_buffer_, get_transform());
         painter_.unwrap()->supplementary_drawing(visible_bounding_box);
     }
 
@@ -541,7 +740,7 @@ bool LSystemView::is_inside(const sf::Vector2f& click) const
 {
     //  If no placeholder is necessary, checks if 'click' is inside one of
     //  the sub-boxes.
-    if (turtle_.vertices_.size() >= 2
+    if (geometry_->vertices.size() >= 2
         && (bounding_box_.width >= std::numeric_limits<float>::epsilon()
             || bounding_box_.height >= std::numeric_limits<float>::epsilon()))
     {
@@ -0,0 +1,97 @@
+#include "QuantizedPositions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace drawing
+{
+namespace
+{
+constexpr float max_offset = std::numeric_limits<u16>::max();
+
+// Returns the offset of 'value' from 'origin' with 'scale'.
+u16 quantize(float value, float origin, float scale)
+{
+    if (scale == 0)
+    {
+        return 0;
+    }
+    return static_cast<u16>(std::clamp(std::round((value - origin) / scale), 0.f, max_offset));
+}
+} // namespace
+
+QuantizedPositions::QuantizedPositions(const std::vector<sf::Vector2f>& positions)
+{
+    chunks_.reserve((positions.size() + chunk_size - 1) / chunk_size);
+    offsets_.reserve(positions.size());
+    for (std::size_t first = 0; first < positions.size(); first += chunk_size)
+    {
+        const auto chunk_begin = begin(positions) + first;
+        const auto chunk_end = begin(positions) + std::min(first + chunk_size, positions.size());
+        const auto [min_x, max_x] = std::minmax_element(
+            chunk_begin, chunk_end, [](const auto& a, const auto& b) { return a.x < b.x; });
+        const auto [min_y, max_y] = std::minmax_element(
+            chunk_begin, chunk_end, [](const auto& a, const auto& b) { return a.y < b.y; });
+
+        const sf::Vector2f origin {min_x->x, min_y->y};
+        const sf::Vector2f extent {max_x->x - origin.x, max_y->y - origin.y};
+        const Chunk chunk {origin, extent / max_offset};
+        chunks_.push_back(chunk);
+        for (auto position = chunk_begin; position != chunk_end; ++position)
+        {
+            offsets_.push_back({quantize(position->x, chunk.origin.x, chunk.scale.x),
+                                quantize(position->y, chunk.origin.y, chunk.scale.y)});
+        }
+    }
+}
+
+std::size_t QuantizedPositions::size() const
+{
+    return offsets_.size();
+}
+
+bool QuantizedPositions::empty() const
+{
+    return offsets_.empty();
+}
+
+std::vector<sf::Vector2f> QuantizedPositions::dequantize() const
+{
+    std::vector<sf::Vector2f> positions;
+    positions.reserve(offsets_.size());
+    for (std::size_t i = 0; i < offsets_.size(); ++i)
+    {
+        positions.push_back((*this)[i]);
+    }
+    return positions;
+}
+
+float QuantizedPositions::max_error() const
+{
+    float error = 0;
+    for (const auto& chunk : chunks_)
+    {
+        error = std::max({error, chunk.scale.x / 2, chunk.scale.y / 2});
+    }
+    return error;
+}
+
+std::size_t QuantizedPositions::bytes() const
+{
+    return chunks_.size() * sizeof(Chunk) + offsets_.size() * sizeof(sf::Vector2<u16>);
+}
+
+bool QuantizedPositions::operator==(const QuantizedPositions& other) const
+{
+    auto chunk_equal = [](const Chunk& a, const Chunk& b) {
+        return a.origin == b.origin && a.scale == b.scale;
+    };
+    return offsets_ == other.offsets_
+           && std::equal(begin(chunks_),
+                         end(chunks_),
+                         begin(other.chunks_),
+                         end(other.chunks_),
+                         chunk_equal);
+}
+} // namespace drawing
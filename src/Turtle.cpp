@@ -1,7 +1,325 @@
 #include "Turtle.h"
 
+#include "TurtleProgram.h"
+#include "helper_math.h"
+
+#include <algorithm>
+#include <memory>
+
 namespace drawing
 {
+// The number of instructions lowered from a stream of symbols before
+// executing them.
+constexpr std::size_t stream_block_size = 4096;
+
+namespace
+{
+using derivation::table_size;
+
+// The origin of a block: the state of the turtle before it, relative to
+// itself.
+const Turtle::State block_origin {{0, 0}, {1, 0}};
+
+// The bound of the bracket statistics of the expansions, far beyond any
+// stack depth, so the statistics of deep expansions do not overflow.
+constexpr i64 saturation = i64 {1} << 40;
+
+// Below this number of vertices, copying a block costs more than
+// interpreting it.
+constexpr u64 min_block_vertices = 64;
+
+i64 saturated_add(i64 a, i64 b)
+{
+    return std::clamp(a + b, -saturation, saturation);
+}
+
+// The interpretation of a symbol expanded 'k' times, from 'block_origin'.
+struct VertexBlock
+{
+    // The vertices, the first one being the origin.
+    VertexArrays vertices;
+    // Relative to the iteration count of the symbol.
+    IterationRuns iterations;
+    // Relative to the heading of the turtle before the symbol.
+    HeadingTrace trace;
+    Turtle::State end;
+    // The states still saved at the end, from bottom to top.
+    std::vector<Turtle::State> saved;
+
+    std::size_t bytes() const
+    {
+        return vertices.bytes() + iterations.bytes() + trace.size() * sizeof(i32)
+               + saved.size() * sizeof(Turtle::State);
+    }
+};
+
+// The interpretation of the expansions of the symbols of a system, with their
+// memoized blocks.
+class Instancer
+{
+  public:
+    // Memoize the blocks of the expansions of up to 'n' iterations with
+    // 'table' and 'orders', within 'budget' bytes.
+    Instancer(const derivation::RuleTable& table, const OrderTable& orders, u8 n, std::size_t budget)
+        : table_ {table}
+        , orders_ {orders}
+        , lowest_(n + 1)
+        , net_(n + 1)
+        , n_vertices_(n + 1)
+        , n_symbols_(n + 1)
+        , blocks_(n + 1)
+        , too_big_(n + 1)
+        , budget_ {budget}
+    {
+        // The stack depth and the vertices of each order.
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            const auto& order = orders_[c];
+            net_[0][c] = order == OrderID::SAVE_POSITION   ? 1
+                         : order == OrderID::LOAD_POSITION ? -1
+                                                           : 0;
+            lowest_[0][c] = std::min<i64>(net_[0][c], 0);
+            n_vertices_[0][c] = order == OrderID::GO_FORWARD ? 1 : 0;
+            n_symbols_[0][c] = 1;
+        }
+        // The statistics of an expansion are folded from the ones of the
+        // successor.
+        for (u8 k = 1; k <= n; ++k)
+        {
+            for (std::size_t c = 0; c < table_size; ++c)
+            {
+                i64 net = 0;
+                i64 lowest = 0;
+                u64 n_vertices = 0;
+                u64 n_symbols = 0;
+                const char* successor = table_.successors[c];
+                for (std::size_t i = 0; i < table_.sizes[c]; ++i)
+                {
+                    const std::size_t s = derivation::index(successor[i]);
+                    lowest = std::min(lowest, saturated_add(net, lowest_[k - 1][s]));
+                    net = saturated_add(net, net_[k - 1][s]);
+                    n_vertices = std::min<u64>(n_vertices + n_vertices_[k - 1][s], saturation);
+                    n_symbols = std::min<u64>(n_symbols + n_symbols_[k - 1][s], saturation);
+                }
+                net_[k][c] = net;
+                lowest_[k][c] = lowest;
+                n_vertices_[k][c] = n_vertices;
+                n_symbols_[k][c] = n_symbols;
+            }
+        }
+    }
+
+    // Returns the iteration count of the first symbol of the expansion of
+    // the symbol at 'c' expanded 'k' times, with the iteration count
+    // 'iteration'. The empty expansions are skipped with 'n_symbols_'.
+    //
+    // Exceptions:
+    //   - Precondition: the expansion is not empty.
+    u8 first_iteration(std::size_t c, u8 k, u8 iteration) const
+    {
+        Expects(n_symbols_[k][c] > 0);
+        while (k > 0 && !derivation::is_terminal(table_, c))
+        {
+            const char* successor = table_.successors[c];
+            std::size_t i = 0;
+            while (n_symbols_[k - 1][derivation::index(successor[i])] == 0)
+            {
+                ++i;
+            }
+            iteration = static_cast<u8>(iteration + table_.increments[c]);
+            c = derivation::index(successor[i]);
+            --k;
+        }
+        return static_cast<u8>(iteration + k * table_.increments[c]);
+    }
+
+    // Returns the number of symbols of the expansion of the symbol at 'c'
+    // expanded 'k' times, saturated.
+    u64 n_symbols(std::size_t c, u8 k) const
+    {
+        return n_symbols_[k][c];
+    }
+
+    // Interpret on 'turtle' the symbol at 'c' expanded 'k' times, with the
+    // iteration count 'iteration'. The orders are lowered into 'program',
+    // which is executed before copying a block. If 'memoize' is false, the
+    // expansion of the symbol itself is not memoized.
+    void interpret(Turtle& turtle,
+                   TurtleProgram& program,
+                   std::size_t c,
+                   u8 k,
+                   u8 iteration,
+                   bool memoize = true)
+    {
+        if (derivation::is_terminal(table_, c))
+        {
+            // A terminal is itself after any number of iterations.
+            iteration = static_cast<u8>(iteration + k * table_.increments[c]);
+            k = 0;
+        }
+
+        if (k == 0)
+        {
+            if (const auto& order = orders_[c])
+            {
+                program.append(*order, turtle.track_iterations_ ? iteration : 0);
+            }
+            return;
+        }
+
+        if (const VertexBlock* block = memoize ? find_or_build(turtle, c, k) : nullptr)
+        {
+            flush(turtle, program);
+            instantiate(turtle, *block, iteration);
+            return;
+        }
+
+        const char* successor = table_.successors[c];
+        const auto successor_iteration = static_cast<u8>(iteration + table_.increments[c]);
+        for (std::size_t i = 0; i < table_.sizes[c]; ++i)
+        {
+            interpret(turtle, program, derivation::index(successor[i]), k - 1, successor_iteration);
+        }
+    }
+
+    // Execute the instructions of 'program' on 'turtle' and clear it.
+    static void flush(Turtle& turtle, TurtleProgram& program)
+    {
+        if (program.instructions().empty())
+        {
+            return;
+        }
+        program.execute(turtle);
+        if (turtle.track_headings_)
+        {
+            turtle.trace_.append(program);
+        }
+        program.clear();
+    }
+
+  private:
+    // Returns the block of the symbol at 'c' expanded 'k' times, built from
+    // the parameters of 'turtle' if it is not yet. Returns null if the block
+    // cannot be memoized.
+    const VertexBlock* find_or_build(const Turtle& turtle, std::size_t c, u8 k)
+    {
+        // A block loading a state saved before it depends on this state.
+        if (lowest_[k][c] < 0 || n_vertices_[k][c] < min_block_vertices || too_big_[k][c])
+        {
+            return nullptr;
+        }
+        auto& block = blocks_[k][c];
+        if (block)
+        {
+            return block.get();
+        }
+        if (n_vertices_[k][c] * (sizeof(sf::Vector2f) + sizeof(i32)) > budget_)
+        {
+            too_big_[k][c] = true;
+            return nullptr;
+        }
+
+        Turtle local;
+        local.cos_ = turtle.cos_;
+        local.sin_ = turtle.sin_;
+        local.track_iterations_ = turtle.track_iterations_;
+        local.track_headings_ = turtle.track_headings_;
+        local.state_ = block_origin;
+        local.vertices_.push_back(sf::Vector2f(0, 0));
+        if (local.track_headings_)
+        {
+            local.trace_.start();
+        }
+
+        TurtleProgram program;
+        const char* successor = table_.successors[c];
+        for (std::size_t i = 0; i < table_.sizes[c]; ++i)
+        {
+            interpret(local,
+                      program,
+                      derivation::index(successor[i]),
+                      k - 1,
+                      table_.increments[c]);
+        }
+        flush(local, program);
+
+        auto built = std::make_unique<VertexBlock>();
+        built->vertices = std::move(local.vertices_);
+        built->iterations = std::move(local.iterations_);
+        built->trace = std::move(local.trace_);
+        built->end = local.state_;
+        built->saved = std::move(local.stack_);
+        budget_ -= std::min(budget_, built->bytes());
+        block = std::move(built);
+        return block.get();
+    }
+
+    // Transform and copy 'block' on 'turtle', for a symbol of iteration count
+    // 'iteration'.
+    static void instantiate(Turtle& turtle, const VertexBlock& block, u8 iteration)
+    {
+        // The origin of the block is the vertex of the entry state, and its
+        // other vertices are copied after the ones of 'turtle'.
+        const Turtle::State entry = turtle.state_;
+        const auto offset = static_cast<u32>(turtle.first_vertex_ + turtle.vertices_.size());
+        auto vertex_of = [&](u32 local) { return local == 0 ? entry.vertex : offset + local - 1; };
+
+        // The positions are transformed like 'Turtle::State::compose()'.
+        const double cos = entry.direction.x;
+        const double sin = entry.direction.y;
+        const auto& positions = block.vertices.positions;
+        for (auto position = begin(positions) + 1; position != end(positions); ++position)
+        {
+            const double x = position->x;
+            const double y = position->y;
+            turtle.vertices_.positions.emplace_back(entry.position.x + x * cos + y * sin,
+                                                    entry.position.y - x * sin + y * cos);
+        }
+        auto& branches = turtle.vertices_.branches;
+        if (positions.size() > 1 && entry.vertex + 1 != offset)
+        {
+            branches.push_back({offset, entry.vertex});
+        }
+        for (const auto& [first, parent] : block.vertices.branches)
+        {
+            branches.push_back({vertex_of(first), vertex_of(parent)});
+        }
+        if (turtle.track_iterations_)
+        {
+            turtle.iterations_.append(block.iterations, iteration);
+        }
+        if (turtle.track_headings_)
+        {
+            turtle.trace_.append(block.trace);
+        }
+        for (const auto& saved : block.saved)
+        {
+            turtle.stack_.push_back(entry.compose(saved));
+            turtle.stack_.back().vertex = vertex_of(saved.vertex);
+        }
+        turtle.state_ = entry.compose(block.end);
+        turtle.state_.vertex = vertex_of(block.end.vertex);
+    }
+
+    const derivation::RuleTable& table_;
+    const OrderTable& orders_;
+    // The bracket statistics of the expansions of the symbols: for the
+    // symbol at 'c' expanded 'k' times, 'lowest_[k][c]' is the lowest depth
+    // of the stack reached, relative to the depth before the symbol,
+    // 'net_[k][c]' the depth after the symbol, 'n_vertices_[k][c]' its
+    // number of vertices and 'n_symbols_[k][c]' its number of symbols.
+    std::vector<std::array<i64, table_size>> lowest_;
+    std::vector<std::array<i64, table_size>> net_;
+    std::vector<std::array<u64, table_size>> n_vertices_;
+    std::vector<std::array<u64, table_size>> n_symbols_;
+    // 'blocks_[k][c]' is the block of the symbol at 'c' expanded 'k' times.
+    std::vector<std::array<std::unique_ptr<const VertexBlock>, table_size>> blocks_;
+    // The blocks which do not fit in the budget.
+    std::vector<derivation::SymbolSet> too_big_;
+    std::size_t budget_;
+};
+} // namespace
+
 // Switch case to apply the order function associated to 'order' to
 // 'turtle'.
 void execute_order(const OrderID& order, Turtle& turtle)
@@ -30,6 +348,19 @@ void execute_order(const OrderID& order, Turtle& turtle)
 }
 
 
+Turtle::State Turtle::State::compose(const State& local) const
+{
+    // The moves are flipped vertically (see 'go_forward_fn()'), so the
+    // positions are rotated by the conjugate of the direction.
+    const double cos = direction.x;
+    const double sin = direction.y;
+    return {{position.x + local.position.x * cos + local.position.y * sin,
+             position.y - local.position.x * sin + local.position.y * cos},
+            {local.direction.x * cos - local.direction.y * sin,
+             local.direction.x * sin + local.direction.y * cos},
+            local.vertex};
+}
+
 void Turtle::init_from_parameters(const DrawingParameters& parameters)
 {
     cos_ = std::cos(parameters.get_delta_angle());
@@ -44,56 +375,344 @@ Turtle::Turtle(const DrawingParameters& parameters)
     init_from_parameters(parameters);
 }
 
-Turtle::TurtleProduction Turtle::compute_vertices(const std::string& lsystem_production,
-                                                  const std::vector<u8>& lsystem_iterations,
-                                                  const InterpretationMap& interpretation,
-                                                  unsigned long long size)
+void Turtle::reset(unsigned long long size)
 {
     // Reset the members
     vertices_.clear();
     iterations_.clear();
-    transparency_.clear();
+    trace_.clear();
     iteration_index_ = 0;
     iteration_depth_ = 0;
+    // The first vertex will be at the position of the turtle.
+    state_.vertex = 0;
 
     // Reserve memory
     vertices_.reserve(size);
-    iterations_.reserve(size);
-    transparency_.reserve(size);
+}
+
+void Turtle::merge_collinear_vertices()
+{
+    const std::size_t n = vertices_.size();
+    if (!merge_collinear_ || trace_.size() != n || n < 3)
+    {
+        return;
+    }
+
+    // The first and last vertices, the vertices starting or ending a branch
+    // and the vertices of the states are kept.
+    std::vector<bool> pinned(n, false);
+    pinned.front() = true;
+    pinned.back() = true;
+    for (const auto& branch : vertices_.branches)
+    {
+        pinned[branch.first] = true;
+        pinned[branch.parent] = true;
+    }
+    auto pin = [&](u32 vertex) {
+        if (vertex < n)
+        {
+            pinned[vertex] = true;
+        }
+    };
+    pin(state_.vertex);
+    for (const auto& state : stack_)
+    {
+        pin(state.vertex);
+    }
+
+    // A vertex is merged if its segment continues the segment of its parent
+    // with the same heading and iteration depth. As it is not pinned, its
+    // parent is the previous vertex, and the next vertex is its child if it
+    // does not start a branch.
+    const auto& headings = trace_.headings();
+    const auto& branches = vertices_.branches;
+    const auto& runs = iterations_.runs();
+    auto branch = begin(branches);
+    std::size_t run = 0;
+    std::size_t run_begin = 0;
+    auto& positions = vertices_.positions;
+    IterationRuns iterations;
+    std::vector<u32> kept;
+    kept.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        while (branch != end(branches) && branch->first <= i)
+        {
+            ++branch;
+        }
+        if (track_iterations_)
+        {
+            while (runs[run].end <= i)
+            {
+                run_begin = runs[run].end;
+                ++run;
+            }
+        }
+        const bool merged = !pinned[i] && (branch == end(branches) || branch->first != i + 1)
+                            && headings[i] != HeadingTrace::no_move
+                            && headings[i] == headings[i + 1]
+                            && (!track_iterations_ || (run_begin < i && i + 1 < runs[run].end));
+        if (merged)
+        {
+            continue;
+        }
+        positions[kept.size()] = positions[i];
+        if (track_iterations_)
+        {
+            iterations.push_back(runs[run].iteration);
+        }
+        kept.push_back(static_cast<u32>(i));
+    }
+    if (kept.size() == n)
+    {
+        return;
+    }
+
+    // The branches and the states refer to kept vertices, by their new index.
+    positions.resize(kept.size());
+    auto index_of = [&](u32 vertex) {
+        return static_cast<u32>(std::lower_bound(begin(kept), end(kept), vertex) - begin(kept));
+    };
+    for (auto& kept_branch : vertices_.branches)
+    {
+        kept_branch.first = index_of(kept_branch.first);
+        kept_branch.parent = index_of(kept_branch.parent);
+    }
+    state_.vertex = index_of(state_.vertex);
+    for (auto& state : stack_)
+    {
+        state.vertex = index_of(state.vertex);
+    }
+    if (track_iterations_)
+    {
+        iterations_ = std::move(iterations);
+    }
+    trace_.keep(kept);
+    vertices_.ordinals = std::move(kept);
+}
+
+Turtle::TurtleProduction Turtle::compute_vertices(const std::string& lsystem_production,
+                                                  const IterationRuns& lsystem_iterations,
+                                                  const InterpretationMap& interpretation,
+                                                  unsigned long long size)
+{
+    Expects(!track_iterations_ || lsystem_iterations.size() == lsystem_production.size());
+    reset(size);
+    const auto orders = compile_orders(interpretation);
 
     // If there is at least one vertex, create manually the first one at the
     // origin.
     if (!lsystem_production.empty())
     {
-        vertices_.emplace_back(sf::Vector2f(state_.position));
-        iterations_.push_back(lsystem_iterations.at(0));
-        transparency_.push_back(false);
-        iteration_depth_ = iterations_.at(0);
+        vertices_.push_back(sf::Vector2f(state_.position));
+        if (track_iterations_)
+        {
+            iterations_.push_back(lsystem_iterations.runs().front().iteration);
+        }
+        if (track_headings_)
+        {
+            trace_.start();
+        }
     }
 
-    for (auto c : lsystem_production)
+    // Lower the production to instructions, run by run of iteration depth.
+    // Without tracking, the whole production is a single run.
+    TurtleProgram program;
+    auto lower = [&](u8 iteration, std::size_t last) {
+        for (; iteration_index_ < last; ++iteration_index_)
+        {
+            if (const auto& order = orders[derivation::index(lsystem_production[iteration_index_])])
+            {
+                program.append(*order, iteration);
+            }
+            else
+            {
+                // Do nothing: if the symbol does not have an associated
+                // order, it has no effects.
+            }
+        }
+    };
+    if (track_iterations_)
     {
-        // Update the iteration depth for the vertices of the next symbol.
-        // Operation that apply the invariant
-        iteration_depth_ = lsystem_iterations.at(iteration_index_++);
+        for (const auto& [iteration, end] : lsystem_iterations.runs())
+        {
+            lower(iteration, end);
+        }
+    }
+    else
+    {
+        lower(0, lsystem_production.size());
+    }
+    program.execute(*this, interpretation_thread_count(program.instructions().size()));
+    if (track_headings_ && !vertices_.empty())
+    {
+        trace_.append(program);
+    }
 
-        if (interpretation.has_predecessor(c))
+    merge_collinear_vertices();
+
+    // Ensures the invariant
+    Ensures(vertices_.size() == iterations_.size() || (!track_iterations_ && iterations_.empty()));
+    TurtleProduction production {vertices_, iterations_};
+    return production;
+}
+
+Turtle::TurtleProduction Turtle::compute_vertices(derivation::SymbolStream symbols,
+                                                  const InterpretationMap& interpretation,
+                                                  unsigned long long size)
+{
+    reset(size);
+    const auto orders = compile_orders(interpretation);
+
+    char c;
+    u8 iteration;
+    // If there is at least one vertex, create manually the first one at the
+    // origin.
+    if (symbols.next(c, iteration))
+    {
+        vertices_.push_back(sf::Vector2f(state_.position));
+        if (track_iterations_)
         {
-            // If an interpretation of the character 'c' is found,
-            // applies it to the current turtle.
-            execute_order(interpretation.get_rule(c).second.id, *this);
+            iterations_.push_back(iteration);
         }
-        else
+        if (track_headings_)
         {
-            // Do nothing: if 'c' does not have an associated
-            // order, it has no effects.
+            trace_.start();
         }
+
+        // The symbols are lowered and executed by blocks, so the
+        // instructions stay small.
+        TurtleProgram program;
+        program.reserve(stream_block_size);
+        auto execute_block = [this](const TurtleProgram& block) {
+            block.execute(*this);
+            if (track_headings_)
+            {
+                trace_.append(block);
+            }
+        };
+        do
+        {
+            if (const auto& order = orders[derivation::index(c)])
+            {
+                program.append(*order, track_iterations_ ? iteration : 0);
+                if (program.instructions().size() >= stream_block_size)
+                {
+                    execute_block(program);
+                    program.clear();
+                }
+            }
+        } while (symbols.next(c, iteration));
+        execute_block(program);
+    }
+
+    merge_collinear_vertices();
+
+    // Ensures the invariant
+    Ensures(vertices_.size() == iterations_.size() || (!track_iterations_ && iterations_.empty()));
+    TurtleProduction production {vertices_, iterations_};
+    return production;
+}
+
+Turtle::TurtleProduction Turtle::compute_vertices(const derivation::RuleTable& table,
+                                                  std::string_view axiom,
+                                                  u8 n,
+                                                  const InterpretationMap& interpretation,
+                                                  unsigned long long size,
+                                                  std::size_t block_budget)
+{
+    Expects(derivation::is_expandable(table));
+    reset(size);
+    const auto orders = compile_orders(interpretation);
+
+    Instancer instancer(table, orders, n, block_budget);
+    auto first = std::find_if(begin(axiom), end(axiom), [&](char c) {
+        return instancer.n_symbols(derivation::index(c), n) > 0;
+    });
+    // If the production is not empty, create manually the first vertex at the
+    // origin, with the iteration count of the first symbol.
+    if (first != end(axiom))
+    {
+        vertices_.push_back(sf::Vector2f(state_.position));
+        if (track_iterations_)
+        {
+            iterations_.push_back(instancer.first_iteration(derivation::index(*first), n, 0));
+        }
+        if (track_headings_)
+        {
+            trace_.start();
+        }
+
+        TurtleProgram program;
+        for (char c : axiom)
+        {
+            instancer.interpret(*this, program, derivation::index(c), n, 0, false);
+        }
+        Instancer::flush(*this, program);
     }
 
+    merge_collinear_vertices();
+
     // Ensures the invariant
-    Ensures(vertices_.size() == iterations_.size());
-    Ensures(vertices_.size() == transparency_.size());
-    TurtleProduction production {vertices_, iterations_, transparency_};
+    Ensures(vertices_.size() == iterations_.size() || (!track_iterations_ && iterations_.empty()));
+    TurtleProduction production {vertices_, iterations_};
     return production;
 }
+
+Turtle::TurtleProduction Turtle::compute_vertices(const parametric::Production& production,
+                                                  const InterpretationMap& interpretation,
+                                                  unsigned long long size)
+{
+    reset(size);
+    const auto orders = compile_orders(interpretation);
+
+    // If there is at least one vertex, create manually the first one at the
+    // origin.
+    if (!production.symbols.empty())
+    {
+        vertices_.push_back(sf::Vector2f(state_.position));
+        if (track_iterations_)
+        {
+            iterations_.push_back(production.iterations.at(0));
+        }
+    }
+
+    for (std::size_t i = 0; i < production.symbols.size(); ++i)
+    {
+        iteration_depth_ = production.iterations[i];
+
+        const auto& order = orders[derivation::index(production.symbols[i])];
+        if (!order)
+        {
+            continue;
+        }
+
+        // The first parameter of a move or a turn overrides its value.
+        const double* parameters = production.parameters_of(i);
+        const bool has_parameter = production.arity(i) > 0;
+        if (has_parameter && *order == OrderID::GO_FORWARD)
+        {
+            go_forward_fn(*this, step_ * parameters[0]);
+        }
+        else if (has_parameter && *order == OrderID::TURN_LEFT)
+        {
+            turn_left_fn(*this, math::degree_to_rad(parameters[0]));
+        }
+        else if (has_parameter && *order == OrderID::TURN_RIGHT)
+        {
+            turn_right_fn(*this, math::degree_to_rad(parameters[0]));
+        }
+        else
+        {
+            execute_order(*order, *this);
+        }
+    }
+
+    merge_collinear_vertices();
+
+    // Ensures the invariant
+    Ensures(vertices_.size() == iterations_.size() || (!track_iterations_ && iterations_.empty()));
+    TurtleProduction result {vertices_, iterations_};
+    return result;
+}
 } // namespace drawing
@@ -0,0 +1,309 @@
+#include "TurtleProgram.h"
+
+#include "Turtle.h"
+#include "helper_parallel.h"
+
+#include <algorithm>
+
+namespace drawing
+{
+namespace
+{
+// Below this number of instructions, the interpretation is sequential.
+constexpr std::size_t parallel_threshold = 1 << 16;
+
+using State = Turtle::State;
+
+// The state at the origin of a chunk: the turtle is relative to its entry
+// state. The vertex of a relative state is 0 for the vertex of its base state,
+// else the number of vertices of the chunk up to its vertex.
+const State origin {{0, 0}, {1, 0}};
+
+// Rotate 'v' by the rotation of cosine 'r.x' and sine 'r.y'.
+ext::sf::Vector2d rotate(const ext::sf::Vector2d& v, const ext::sf::Vector2d& r)
+{
+    return {v.x * r.x - v.y * r.y, v.x * r.y + v.y * r.x};
+}
+
+// A state relative to the entry state of a chunk if 'base' is 0, else to the
+// 'base'-th state loaded by the chunk without being saved in it.
+struct RelativeState
+{
+    State state;
+    std::size_t base;
+};
+
+// The effect of a chunk of instructions, simulated from 'origin'.
+struct ChunkSummary
+{
+    RelativeState end {origin, 0};
+    // The states still saved at the end of the chunk, from bottom to top.
+    std::vector<RelativeState> saved {};
+    // The number of states loaded without being saved in the chunk.
+    std::size_t n_loads {0};
+    std::size_t n_vertices {0};
+};
+} // namespace
+
+void TurtleProgram::append(OrderID order, u8 iteration)
+{
+    Instruction* last = instructions_.empty() ? nullptr : &instructions_.back();
+
+    switch (order)
+    {
+    case OrderID::GO_FORWARD:
+        if (last && last->op == OpCode::FORWARD && last->iteration == iteration)
+        {
+            ++last->operand;
+        }
+        else
+        {
+            instructions_.push_back({OpCode::FORWARD, iteration, 1});
+        }
+        break;
+    case OrderID::TURN_LEFT:
+    case OrderID::TURN_RIGHT:
+    {
+        const i32 turn = order == OrderID::TURN_LEFT ? 1 : -1;
+        if (last && last->op == OpCode::ROTATE)
+        {
+            last->operand += turn;
+            if (last->operand == 0)
+            {
+                // The turns cancel each other.
+                instructions_.pop_back();
+                break;
+            }
+        }
+        else
+        {
+            instructions_.push_back({OpCode::ROTATE, iteration, turn});
+            last = &instructions_.back();
+        }
+        min_turns_ = std::min(min_turns_, last->operand);
+        max_turns_ = std::max(max_turns_, last->operand);
+        break;
+    }
+    case OrderID::SAVE_POSITION:
+        instructions_.push_back({OpCode::SAVE, iteration, 0});
+        max_depth_ = std::max(max_depth_, ++depth_);
+        break;
+    case OrderID::LOAD_POSITION:
+        instructions_.push_back({OpCode::LOAD, iteration, 0});
+        depth_ = depth_ > 0 ? depth_ - 1 : 0;
+        break;
+    default:
+        Expects(false);
+        break;
+    }
+}
+
+std::vector<ext::sf::Vector2d> TurtleProgram::rotations(const Turtle& turtle) const
+{
+    std::vector<ext::sf::Vector2d> rotations(max_turns_ - min_turns_ + 1);
+    rotations[-min_turns_] = {1, 0};
+    for (i32 turns = 1; turns <= max_turns_; ++turns)
+    {
+        rotations[turns - min_turns_] =
+            rotate(rotations[turns - 1 - min_turns_], {turtle.cos_, turtle.sin_});
+    }
+    for (i32 turns = -1; turns >= min_turns_; --turns)
+    {
+        rotations[turns - min_turns_] =
+            rotate(rotations[turns + 1 - min_turns_], {turtle.cos_, -turtle.sin_});
+    }
+    return rotations;
+}
+
+void TurtleProgram::execute(Turtle& turtle,
+                            const ext::sf::Vector2d* rotation_of,
+                            std::size_t first,
+                            std::size_t last) const
+{
+    for (std::size_t i = first; i < last; ++i)
+    {
+        const auto& [op, iteration, operand] = instructions_[i];
+        switch (op)
+        {
+        case OpCode::FORWARD:
+            turtle.iteration_depth_ = iteration;
+            for (i32 n = 0; n < operand; ++n)
+            {
+                go_forward_fn(turtle);
+            }
+            break;
+        case OpCode::ROTATE:
+            turtle.state_.direction = rotate(turtle.state_.direction, rotation_of[operand]);
+            break;
+        case OpCode::SAVE:
+            save_position_fn(turtle);
+            break;
+        case OpCode::LOAD:
+            load_position_fn(turtle);
+            break;
+        default:
+            Expects(false);
+            break;
+        }
+    }
+}
+
+void TurtleProgram::execute(Turtle& turtle, unsigned n_threads) const
+{
+    const auto rotation_table = rotations(turtle);
+    // Indexed by the number of turns.
+    const ext::sf::Vector2d* rotation_of = rotation_table.data() - min_turns_;
+    turtle.stack_.reserve(turtle.stack_.size() + max_depth_);
+
+    const std::size_t n_chunks =
+        std::max<std::size_t>(1, std::min<std::size_t>(n_threads, instructions_.size()));
+    if (n_chunks == 1)
+    {
+        execute(turtle, rotation_of, 0, instructions_.size());
+        return;
+    }
+    const auto boundaries = split_in_chunks(instructions_.size(), n_chunks);
+
+    // 1. Simulate each chunk from the origin.
+    std::vector<ChunkSummary> summaries(n_chunks);
+    parallel_for(n_chunks, [&](std::size_t c) {
+        ChunkSummary& summary = summaries[c];
+        RelativeState& current = summary.end;
+        for (std::size_t i = boundaries[c]; i < boundaries[c + 1]; ++i)
+        {
+            const auto& [op, iteration, operand] = instructions_[i];
+            State& state = current.state;
+            switch (op)
+            {
+            case OpCode::FORWARD:
+                state.position += ext::sf::Vector2d {operand * Turtle::step_ * state.direction.x,
+                                                     operand * Turtle::step_ * -state.direction.y};
+                summary.n_vertices += operand;
+                state.vertex = static_cast<u32>(summary.n_vertices);
+                break;
+            case OpCode::ROTATE:
+                state.direction = rotate(state.direction, rotation_of[operand]);
+                break;
+            case OpCode::SAVE:
+                summary.saved.push_back(current);
+                break;
+            case OpCode::LOAD:
+                if (!summary.saved.empty())
+                {
+                    current = summary.saved.back();
+                    summary.saved.pop_back();
+                }
+                else
+                {
+                    current = {origin, ++summary.n_loads};
+                }
+                break;
+            }
+        }
+    });
+
+    // The vertices of each chunk are after the ones of the previous chunks.
+    std::vector<std::size_t> offsets(n_chunks + 1, turtle.vertices_.size());
+    for (std::size_t c = 0; c < n_chunks; ++c)
+    {
+        offsets[c + 1] = offsets[c] + summaries[c].n_vertices;
+    }
+
+    // 2. Scan the chunks to get their entry and loaded states. As a state is
+    // loaded only while the stack of the chunk is empty, the states still
+    // saved in a chunk are pushed after its loads.
+    std::vector<State> entries(n_chunks);
+    std::vector<std::vector<State>> loaded(n_chunks);
+    std::vector<State> stack = turtle.stack_;
+    State entry = turtle.state_;
+    for (std::size_t c = 0; c < n_chunks; ++c)
+    {
+        const ChunkSummary& summary = summaries[c];
+        if (summary.n_loads > stack.size())
+        {
+            execute(turtle, rotation_of, 0, instructions_.size());
+            return;
+        }
+        entries[c] = entry;
+        loaded[c].assign(end(stack) - summary.n_loads, end(stack));
+        stack.resize(stack.size() - summary.n_loads);
+
+        auto absolute = [&](const RelativeState& relative) {
+            const State& base = relative.base == 0
+                                    ? entries[c]
+                                    : loaded[c][summary.n_loads - relative.base];
+            State state = base.compose(relative.state);
+            state.vertex = relative.state.vertex == 0
+                               ? base.vertex
+                               : static_cast<u32>(turtle.first_vertex_ + offsets[c]
+                                                  + relative.state.vertex - 1);
+            return state;
+        };
+        for (const auto& saved : summary.saved)
+        {
+            stack.push_back(absolute(saved));
+        }
+        entry = absolute(summary.end);
+    }
+
+    // 3. Execute each chunk from its entry state into its range of vertices.
+    turtle.vertices_.positions.resize(offsets[n_chunks]);
+
+    std::vector<Turtle> turtles(n_chunks);
+    parallel_for(n_chunks, [&](std::size_t c) {
+        Turtle& chunk_turtle = turtles[c];
+        chunk_turtle.cos_ = turtle.cos_;
+        chunk_turtle.sin_ = turtle.sin_;
+        chunk_turtle.track_iterations_ = turtle.track_iterations_;
+        chunk_turtle.state_ = entries[c];
+        chunk_turtle.stack_ = std::move(loaded[c]);
+        chunk_turtle.first_vertex_ = static_cast<u32>(turtle.first_vertex_ + offsets[c]);
+        chunk_turtle.vertices_.reserve(summaries[c].n_vertices);
+
+        execute(chunk_turtle, rotation_of, boundaries[c], boundaries[c + 1]);
+        const auto& positions = chunk_turtle.vertices_.positions;
+        std::copy(begin(positions), end(positions), begin(turtle.vertices_.positions) + offsets[c]);
+    });
+
+    // The branches and the runs are appended, so they are gathered
+    // sequentially.
+    auto& branches = turtle.vertices_.branches;
+    for (const auto& chunk_turtle : turtles)
+    {
+        const auto& chunk_branches = chunk_turtle.vertices_.branches;
+        branches.insert(end(branches), begin(chunk_branches), end(chunk_branches));
+        turtle.iterations_.append(chunk_turtle.iterations_);
+    }
+    turtle.state_ = entry;
+    turtle.stack_ = std::move(stack);
+    turtle.iteration_depth_ = turtles.back().iteration_depth_;
+}
+
+void TurtleProgram::clear()
+{
+    instructions_.clear();
+    depth_ = 0;
+    max_depth_ = 0;
+    min_turns_ = 0;
+    max_turns_ = 0;
+}
+
+void TurtleProgram::reserve(std::size_t n)
+{
+    instructions_.reserve(n);
+}
+
+const std::vector<TurtleProgram::Instruction>& TurtleProgram::instructions() const
+{
+    return instructions_;
+}
+
+std::size_t TurtleProgram::max_depth() const
+{
+    return max_depth_;
+}
+unsigned interpretation_thread_count(std::size_t n_instructions)
+{
+    return n_instructions < parallel_threshold ? 1 : hardware_thread_count();
+}
+} // namespace drawing
@@ -0,0 +1,156 @@
+#include "VertexArrays.h"
+
+#include <algorithm>
+#include <gsl/gsl>
+
+namespace drawing
+{
+namespace
+{
+// The number of segments converted and drawn at once by
+// 'draw_segments()'.
+constexpr std::size_t draw_chunk_size = 1 << 14;
+} // namespace
+
+bool VertexArrays::Branch::operator==(const Branch& other) const
+{
+    return first == other.first && parent == other.parent;
+}
+
+std::size_t VertexArrays::size() const
+{
+    return quantized.empty() ? positions.size() : quantized.size();
+}
+
+bool VertexArrays::empty() const
+{
+    return positions.empty() && quantized.empty();
+}
+
+std::size_t VertexArrays::unmerged_size() const
+{
+    // The last vertex is never merged.
+    return ordinals.empty() ? size() : ordinals.back() + std::size_t {1};
+}
+
+bool VertexArrays::is_quantized() const
+{
+    return !quantized.empty();
+}
+
+void VertexArrays::quantize()
+{
+    if (is_quantized())
+    {
+        return;
+    }
+    quantized = QuantizedPositions(positions);
+    // The memory of the positions is released.
+    std::vector<sf::Vector2f>().swap(positions);
+}
+
+void VertexArrays::dequantize()
+{
+    if (!is_quantized())
+    {
+        return;
+    }
+    positions = quantized.dequantize();
+    quantized = QuantizedPositions();
+}
+
+u32 VertexArrays::parent(std::size_t i) const
+{
+    Expects(0 < i && i < size());
+
+    auto branch = std::lower_bound(
+        begin(branches), end(branches), i, [](const Branch& b, std::size_t i) {
+            return b.first < i;
+        });
+    return branch != end(branches) && branch->first == i ? branch->parent
+                                                          : static_cast<u32>(i - 1);
+}
+
+void VertexArrays::clear()
+{
+    positions.clear();
+    branches.clear();
+    quantized = QuantizedPositions();
+    ordinals.clear();
+}
+
+void VertexArrays::reserve(std::size_t n)
+{
+    positions.reserve(n);
+}
+
+std::size_t VertexArrays::bytes() const
+{
+    return positions.size() * sizeof(sf::Vector2f) + branches.size() * sizeof(Branch)
+           + quantized.bytes() + ordinals.size() * sizeof(u32);
+}
+
+bool VertexArrays::operator==(const VertexArrays& other) const
+{
+    return positions == other.positions && branches == other.branches
+           && quantized == other.quantized && ordinals == other.ordinals;
+}
+
+void to_sfml(const VertexArrays& vertices,
+             const std::vector<sf::Color>& colors,
+             std::size_t first,
+             std::size_t last,
+             std::vector<sf::Vertex>& out)
+{
+    Expects(colors.size() == vertices.size());
+    Expects(first <= last && last <= vertices.size());
+
+    out.clear();
+    first = std::max<std::size_t>(first, 1);
+    if (first >= last)
+    {
+        return;
+    }
+    const auto& branches = vertices.branches;
+    auto branch = std::lower_bound(
+        begin(branches), end(branches), first, [](const auto& b, std::size_t i) {
+            return b.first < i;
+        });
+    for (std::size_t i = first; i < last; ++i)
+    {
+        std::size_t parent = i - 1;
+        if (branch != end(branches) && branch->first == i)
+        {
+            parent = branch->parent;
+            ++branch;
+        }
+        out.emplace_back(vertices.position(parent), colors[parent]);
+        out.emplace_back(vertices.position(i), colors[i]);
+    }
+}
+
+std::vector<sf::Vertex> to_sfml(const VertexArrays& vertices, const std::vector<sf::Color>& colors)
+{
+    std::vector<sf::Vertex> out;
+    out.reserve(vertices.empty() ? 0 : 2 * (vertices.size() - 1));
+    to_sfml(vertices, colors, 0, vertices.size(), out);
+    return out;
+}
+
+void draw_segments(sf::RenderTarget& target,
+                   const VertexArrays& vertices,
+                   const std::vector<sf::Color>& colors,
+                   std::vector<sf::Vertex>& buffer,
+                   const sf::RenderStates& states)
+{
+    Expects(colors.size() == vertices.size());
+
+    buffer.reserve(2 * draw_chunk_size);
+    for (std::size_t first = 0; first < vertices.size(); first += draw_chunk_size)
+    {
+        const std::size_t last = std::min(first + draw_chunk_size, vertices.size());
+        to_sfml(vertices, colors, first, last, buffer);
+        target.draw(buffer.data(), buffer.size(), sf::Lines, states);
+    }
+}
+} // namespace drawing
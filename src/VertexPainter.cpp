@@ -27,6 +27,16 @@ void VertexPainter::supplementary_drawing(sf::FloatRect /*unused*/) const
 {
 }
 
+bool VertexPainter::needs_iterations() const
+{
+    return false;
+}
+
+bool VertexPainter::is_merge_safe() const
+{
+    return false;
+}
+
 bool VertexPainter::poll_modification()
 {
     return Indicator::poll_modification() || generator_.poll_modification();
@@ -3,6 +3,7 @@
 #include "VertexPainterLinear.h"
 #include "VertexPainterSerializer.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace colors
@@ -23,6 +24,11 @@ namespace impl
     }
 
     sf::Color ColorGeneratorComposite::get(float f)
+    {
+        return get_run(f, 1);
+    }
+
+    sf::Color ColorGeneratorComposite::get_run(float f, std::size_t count)
     {
         // OPTIMIZATION TODO
         // // Should never happen.
@@ -39,7 +45,11 @@ namespace impl
 
         // OPTIMIZATION
         // painter_->vertex_indices_pools_.at(which_painter).push_back(global_index_++);
-        painter_->vertex_indices_pools_[which_painter].push_back(global_index_++);
+        auto& pool = painter_->vertex_indices_pools_[which_painter];
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            pool.push_back(global_index_++);
+        }
         // END
 
         // Dummy color (BUT NOT TRANSPARENT (Transparent is a special value
@@ -148,9 +158,9 @@ void VertexPainterComposite::set_child_painters(const std::vector<VertexPainterW
     indicate_modification();
 }
 
-void VertexPainterComposite::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                            const std::vector<u8>& iteration_of_vertices,
-                                            const std::vector<bool>& transparent,
+void VertexPainterComposite::paint_vertices(std::vector<sf::Color>& colors,
+                                            const drawing::VertexArrays& vertices,
+                                            const IterationRuns& iteration_of_vertices,
                                             int max_recursion,
                                             sf::FloatRect bounding_box)
 
@@ -168,9 +178,9 @@ void VertexPainterComposite::paint_vertices(std::vector<sf::Vertex>& vertices,
     }
 
     // Fill the pools by making paint the main painter through 'color_distributor_'.
-    main_painter_.unwrap()->paint_vertices(vertices,
+    main_painter_.unwrap()->paint_vertices(colors,
+                                           vertices,
                                            iteration_of_vertices,
-                                           transparent,
                                            max_recursion,
                                            bounding_box);
 
@@ -178,63 +188,87 @@ void VertexPainterComposite::paint_vertices(std::vector<sf::Vertex>& vertices,
     for (auto i = 0ull; i < child_painters_.size(); ++i)
     {
         // For each indices pools...
-        std::vector<sf::Vertex> vertices_part;
-        std::vector<u8> iteration_of_vertices_part;
-        std::vector<bool> transparent_part;
+        drawing::VertexArrays vertices_part;
+        std::vector<sf::Color> colors_part;
+        IterationRuns iteration_of_vertices_part;
+        // The iteration counts are only copied for the painters reading them.
+        const bool with_iterations = child_painters_.at(i).unwrap()->needs_iterations();
         const auto pool_size = vertex_indices_pools_.at(i).size();
         vertices_part.reserve(pool_size);
-        iteration_of_vertices_part.reserve(pool_size);
-        transparent_part.reserve(pool_size);
+        colors_part.reserve(pool_size);
         for (auto idx : vertex_indices_pools_.at(i))
         {
             // ... get each index and get from the '*_copy' the vertex and
             // its iteration.
-            vertices_part.push_back(vertices.at(idx));
-            iteration_of_vertices_part.push_back(iteration_of_vertices.at(idx));
-            transparent_part.push_back(transparent.at(idx));
+            vertices_part.push_back(vertices.position(idx));
+            colors_part.push_back(colors.at(idx));
+            if (with_iterations)
+            {
+                iteration_of_vertices_part.push_back(iteration_of_vertices.at(idx));
+            }
         }
-        child_painters_.at(i).unwrap()->paint_vertices(vertices_part,
+        child_painters_.at(i).unwrap()->paint_vertices(colors_part,
+                                                       vertices_part,
                                                        iteration_of_vertices_part,
-                                                       transparent_part,
                                                        max_recursion,
                                                        bounding_box);
-        for (auto j = 0ull; j < vertices_part.size(); ++j)
+        for (auto j = 0ull; j < colors_part.size(); ++j)
         {
-            vertices.at(vertex_indices_pools_.at(i).at(j)) = vertices_part.at(j);
+            colors.at(vertex_indices_pools_.at(i).at(j)) = colors_part.at(j);
         }
     }
 #else
     for (auto i = 0ull; i < child_painters_.size(); ++i)
     {
         // For each indices pools...
-        std::vector<sf::Vertex> vertices_part;
-        std::vector<u8> iteration_of_vertices_part;
-        std::vector<bool> transparent_part;
+        drawing::VertexArrays vertices_part;
+        std::vector<sf::Color> colors_part;
+        IterationRuns iteration_of_vertices_part;
+        // The iteration counts are only copied for the painters reading them.
+        const bool with_iterations = child_painters_[i].unwrap()->needs_iterations();
         const auto pool_size = vertex_indices_pools_[i].size();
         vertices_part.reserve(pool_size);
-        iteration_of_vertices_part.reserve(pool_size);
-        transparent_part.reserve(pool_size);
+        colors_part.reserve(pool_size);
         for (auto idx : vertex_indices_pools_[i])
         {
             // ... get each index and get from the '*_copy' the vertex and
             // its iteration.
-            vertices_part.push_back(vertices[idx]);
-            iteration_of_vertices_part.push_back(iteration_of_vertices[idx]);
-            transparent_part.push_back(transparent[idx]);
+            vertices_part.push_back(vertices.position(idx));
+            colors_part.push_back(colors[idx]);
+            if (with_iterations)
+            {
+                iteration_of_vertices_part.push_back(iteration_of_vertices.at(idx));
+            }
         }
-        child_painters_[i].unwrap()->paint_vertices(vertices_part,
+        child_painters_[i].unwrap()->paint_vertices(colors_part,
+                                                    vertices_part,
                                                     iteration_of_vertices_part,
-                                                    transparent_part,
                                                     max_recursion,
                                                     bounding_box);
-        for (auto j = 0ull; j < vertices_part.size(); ++j)
+        for (auto j = 0ull; j < colors_part.size(); ++j)
         {
-            vertices[vertex_indices_pools_[i][j]] = vertices_part[j];
+            colors[vertex_indices_pools_[i][j]] = colors_part[j];
         }
     }
 #endif
 }
 
+bool VertexPainterComposite::needs_iterations() const
+{
+    return main_painter_.unwrap()->needs_iterations()
+           || std::any_of(begin(child_painters_),
+                          end(child_painters_),
+                          [](const auto& painter) { return painter.unwrap()->needs_iterations(); });
+}
+
+bool VertexPainterComposite::is_merge_safe() const
+{
+    return main_painter_.unwrap()->is_merge_safe()
+           && std::all_of(begin(child_painters_),
+                          end(child_painters_),
+                          [](const auto& painter) { return painter.unwrap()->is_merge_safe(); });
+}
+
 void VertexPainterComposite::supplementary_drawing(sf::FloatRect bounding_box) const
 {
     main_painter_.unwrap()->supplementary_drawing(bounding_box);
@@ -13,9 +13,9 @@ std::shared_ptr<VertexPainter> VertexPainterConstant::clone() const
     return std::make_shared<VertexPainterConstant>(color_wrapper);
 }
 
-void VertexPainterConstant::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                           const std::vector<u8>& /*iteration_of_vertices*/,
-                                           const std::vector<bool>& transparent,
+void VertexPainterConstant::paint_vertices(std::vector<sf::Color>& colors,
+                                           const drawing::VertexArrays& vertices,
+                                           const IterationRuns& /*iteration_of_vertices*/,
                                            int /*max_recursion*/,
                                            sf::FloatRect /*bounding_box*/)
 
@@ -26,23 +26,22 @@ void VertexPainterConstant::paint_vertices(std::vector<sf::Vertex>& vertices,
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
         sf::Color color = generator->get(.5);
-        if (!transparent.at(i))
-        {
-            vertices.at(i).color = color;
-        }
+        colors.at(i) = color;
     }
 #else
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
         sf::Color color = generator->get(.5);
-        if (!transparent[i])
-        {
-            vertices[i].color = color;
-        }
+        colors[i] = color;
     }
 #endif
 }
 
+bool VertexPainterConstant::is_merge_safe() const
+{
+    return true;
+}
+
 std::string VertexPainterConstant::type_name() const
 {
     return "VertexPainterConstant";
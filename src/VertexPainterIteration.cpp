@@ -14,9 +14,9 @@ std::shared_ptr<VertexPainter> VertexPainterIteration::clone() const
     return std::make_shared<VertexPainterIteration>(generator_);
 }
 
-void VertexPainterIteration::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                            const std::vector<u8>& vertices_iteration,
-                                            const std::vector<bool>& transparent,
+void VertexPainterIteration::paint_vertices(std::vector<sf::Color>& colors,
+                                            const drawing::VertexArrays& vertices,
+                                            const IterationRuns& vertices_iteration,
                                             int max_iteration,
                                             sf::FloatRect /*bounding_box*/)
 
@@ -34,38 +34,41 @@ void VertexPainterIteration::paint_vertices(std::vector<sf::Vertex>& vertices,
         // Avoid division by 0.
         max_iteration = 2;
     }
-
+    // The color of a run of vertices with the same iteration is computed
+    // once.
+    std::size_t first = 0;
+    for (const auto& [iteration, last] : vertices_iteration.runs())
+    {
+#ifdef VERTEX_PAINTER_ITERATION_BUGGY
+        sf::Color color =
+            generator->get_run((iteration - 1) / (float(max_iteration) - 1), last - first);
+#else
+        sf::Color color = generator->get_run(iteration / float(max_iteration), last - first);
+#endif
 
 #ifdef DEBUG_CHECKS
-    for (auto i = 0u; i < vertices_iteration.size(); ++i)
-    {
-#    ifdef VERTEX_PAINTER_ITERATION_BUGGY
-        sf::Color color = generator->get((vertices_iteration.at(i) - 1)
-                                         / (float(max_iteration) - 1));
-#    else
-        sf::Color color = generator->get((vertices_iteration.at(i)) / (float(max_iteration)));
-#    endif
-        sf::Vertex& v = vertices.at(i);
-        if (!transparent.at(i))
+        for (auto i = first; i < last; ++i)
         {
-            v.color = color;
+            colors.at(i) = color;
         }
-    }
 #else
-    for (auto i = 0u; i < vertices_iteration.size(); ++i)
-    {
-#    ifdef VERTEX_PAINTER_ITERATION_BUGGY
-        sf::Color color = generator->get((vertices_iteration[i] - 1) / (float(max_iteration) - 1));
-#    else
-        sf::Color color = generator->get((vertices_iteration[i]) / (float(max_iteration)));
-#    endif
-        sf::Vertex& v = vertices[i];
-        if (!transparent[i])
+        for (auto i = first; i < last; ++i)
         {
-            v.color = color;
+            colors[i] = color;
         }
-    }
 #endif
+        first = last;
+    }
+}
+
+bool VertexPainterIteration::needs_iterations() const
+{
+    return true;
+}
+
+bool VertexPainterIteration::is_merge_safe() const
+{
+    return true;
 }
 
 std::string VertexPainterIteration::type_name() const
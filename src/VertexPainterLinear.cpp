@@ -49,9 +49,9 @@ void VertexPainterLinear::set_display_flag(bool flag)
     display_helper_ = flag;
 }
 
-void VertexPainterLinear::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                         const std::vector<u8>& /*iteration_of_vertices*/,
-                                         const std::vector<bool>& transparent,
+void VertexPainterLinear::paint_vertices(std::vector<sf::Color>& colors,
+                                         const drawing::VertexArrays& vertices,
+                                         const IterationRuns& /*iteration_of_vertices*/,
                                          int /*max_recursion*/,
                                          sf::FloatRect bounding_box)
 {
@@ -91,28 +91,22 @@ void VertexPainterLinear::paint_vertices(std::vector<sf::Vertex>& vertices,
     {
         sf::Vector2f projection = geometry::project(opposite_intersection_line.first,
                                                     opposite_intersection_line.second,
-                                                    vertices.at(i).position);
-        float lerp = geometry::distance(projection, vertices.at(i).position) / distance;
+                                                    vertices.position(i));
+        float lerp = geometry::distance(projection, vertices.position(i)) / distance;
 
         sf::Color color = generator->get(lerp);
-        if (!transparent.at(i))
-        {
-            vertices.at(i).color = color;
-        }
+        colors.at(i) = color;
     }
 #else
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
         sf::Vector2f projection = geometry::project(opposite_intersection_line.first,
                                                     opposite_intersection_line.second,
-                                                    vertices[i].position);
-        float lerp = geometry::distance(projection, vertices[i].position) / distance;
+                                                    vertices.position(i));
+        float lerp = geometry::distance(projection, vertices.position(i)) / distance;
 
         sf::Color color = generator->get(lerp);
-        if (!transparent[i])
-        {
-            vertices[i].color = color;
-        }
+        colors[i] = color;
     }
 #endif
 }
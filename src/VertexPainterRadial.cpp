@@ -49,9 +49,9 @@ void VertexPainterRadial::set_display_flag(bool flag)
 }
 
 
-void VertexPainterRadial::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                         const std::vector<u8>& /*iteration_of_vertices*/,
-                                         const std::vector<bool>& transparent,
+void VertexPainterRadial::paint_vertices(std::vector<sf::Color>& colors,
+                                         const drawing::VertexArrays& vertices,
+                                         const IterationRuns& /*iteration_of_vertices*/,
                                          int /*max_recursion*/,
                                          sf::FloatRect bounding_box)
 {
@@ -88,23 +88,17 @@ void VertexPainterRadial::paint_vertices(std::vector<sf::Vertex>& vertices,
 #ifdef DEBUG_CHECKS
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
-        float lerp = geometry::distance(vertices.at(i).position, relative_center)
+        float lerp = geometry::distance(vertices.position(i), relative_center)
                      / greatest_distance;
         sf::Color color = generator->get(lerp);
-        if (!transparent.at(i))
-        {
-            vertices.at(i).color = color;
-        }
+        colors.at(i) = color;
     }
 #else
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
-        float lerp = geometry::distance(vertices[i].position, relative_center) / greatest_distance;
+        float lerp = geometry::distance(vertices.position(i), relative_center) / greatest_distance;
         sf::Color color = generator->get(lerp);
-        if (!transparent[i])
-        {
-            vertices[i].color = color;
-        }
+        colors[i] = color;
     }
 #endif
     // // DEBUG
@@ -50,9 +50,9 @@ void VertexPainterRandom::set_block_size(int block_size)
 }
 
 
-void VertexPainterRandom::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                         const std::vector<u8>& /*iteration_of_vertices*/,
-                                         const std::vector<bool>& transparent,
+void VertexPainterRandom::paint_vertices(std::vector<sf::Color>& colors,
+                                         const drawing::VertexArrays& vertices,
+                                         const IterationRuns& /*iteration_of_vertices*/,
                                          int /*max_recursion*/,
                                          sf::FloatRect /*bounding_box*/)
 
@@ -73,15 +73,9 @@ void VertexPainterRandom::paint_vertices(std::vector<sf::Vertex>& vertices,
         // 'VertexPainterComposite'.
         sf::Color color = generator->get(rand);
 #ifdef DEBUG_CHECKS
-        if (!transparent.at(i))
-        {
-            vertices.at(i).color = color;
-        }
+        colors.at(i) = color;
 #else
-        if (!transparent[i])
-        {
-            vertices[i].color = color;
-        }
+        colors[i] = color;
 #endif
         ++block_index;
     }
@@ -34,31 +34,26 @@ void VertexPainterSequential::set_factor(float factor)
     indicate_modification();
 }
 
-void VertexPainterSequential::paint_vertices(std::vector<sf::Vertex>& vertices,
-                                             const std::vector<u8>& /*iteration_of_vertices*/,
-                                             const std::vector<bool>& transparent,
+void VertexPainterSequential::paint_vertices(std::vector<sf::Color>& colors,
+                                             const drawing::VertexArrays& vertices,
+                                             const IterationRuns& /*iteration_of_vertices*/,
                                              int /*max_recursion*/,
                                              sf::FloatRect /*bounding_box*/)
 
 {
     auto generator = generator_.unwrap();
 
-    auto size = vertices.size();
+    // The vertices are painted as if the collinear vertices were not merged.
+    auto size = vertices.unmerged_size();
     for (auto i = 0ull; i < vertices.size(); ++i)
     {
         double integral;
-        double lerp = std::modf((i * factor_) / size, &integral);
+        double lerp = std::modf((vertices.ordinal(i) * factor_) / size, &integral);
         sf::Color color = generator->get(lerp);
 #ifdef DEBUG_CHECKS
-        if (!transparent.at(i))
-        {
-            vertices.at(i).color = color;
-        }
+        colors.at(i) = color;
 #else
-        if (!transparent[i])
-        {
-            vertices[i].color = color;
-        }
+        colors[i] = color;
 #endif
     }
 }
@@ -0,0 +1,1013 @@
+#include "derivation.h"
+
+#include "helper_parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <gsl/gsl>
+#include <numeric>
+
+namespace derivation
+{
+RuleTable compile_rules(const std::unordered_map<char, std::string>& rules,
+                        const std::string& iteration_predecessors,
+                        const StochasticRules& stochastic_rules,
+                        u64 seed,
+                        const ContextRules& context_rules,
+                        const std::string& context_ignored)
+{
+    RuleTable table;
+
+    // By default, every symbol is a terminal.
+    for (auto i = 0u; i < table_size; ++i)
+    {
+        table.successors.at(i) = &identity_symbols.at(i);
+        table.sizes.at(i) = 1;
+    }
+
+    for (const auto& [predecessor, successor] : rules)
+    {
+        table.successors.at(index(predecessor)) = successor.data();
+        table.sizes.at(index(predecessor)) = successor.size();
+    }
+
+    for (char c : iteration_predecessors)
+    {
+        table.increments.at(index(c)) = 1;
+    }
+
+    // The successors of a stochastic symbol are chosen in proportion to
+    // their weight, the rule having a weight of 1.
+    for (const auto& [predecessor, successors] : stochastic_rules)
+    {
+        Expects(rules.count(predecessor) > 0);
+        if (successors.empty())
+        {
+            continue;
+        }
+
+        double total = 1;
+        for (const auto& [_, weight] : successors)
+        {
+            Expects(weight > 0);
+            total += weight;
+        }
+
+        auto& choices = table.choices.at(index(predecessor));
+        double cumulative = 1;
+        choices.push_back({rules.at(predecessor), cumulative / total});
+        for (const auto& [successor, weight] : successors)
+        {
+            cumulative += weight;
+            choices.push_back({successor, cumulative / total});
+        }
+        // Avoid rounding errors: the last successor is always chosen if none
+        // of the previous ones is.
+        choices.back().threshold = 1;
+        table.is_stochastic = true;
+    }
+    table.seed = seed;
+
+    auto context = [](const std::string& symbols) {
+        Expects(symbols.size() <= 1);
+        return symbols.empty() ? no_context : static_cast<u16>(index(symbols.front()));
+    };
+    for (const auto& [predecessor, rules] : context_rules)
+    {
+        for (const auto& [left, successor, right] : rules)
+        {
+            table.contexts.at(index(predecessor)).push_back(
+                {context(left), context(right), successor});
+            table.is_context_sensitive = true;
+        }
+    }
+    for (char c : context_ignored)
+    {
+        table.context_ignored.set(index(c));
+    }
+
+    return table;
+}
+
+ContextTable compute_contexts(const RuleTable& table, std::string_view production)
+{
+    ContextTable contexts {std::vector<u16>(production.size()),
+                           std::vector<u16>(production.size())};
+    auto is_ignored = [&table](char c) { return table.context_ignored.test(index(c)); };
+
+    // The contexts saved when entering a branch, restored when leaving it.
+    std::vector<u16> stack;
+
+    // The symbol before is the last symbol of the path leading to the
+    // current one: the branches closed before it are not on this path.
+    u16 last = no_context;
+    for (std::size_t i = 0; i < production.size(); ++i)
+    {
+        const char c = production[i];
+        contexts.left[i] = last;
+        if (c == '[')
+        {
+            stack.push_back(last);
+        }
+        else if (c == ']')
+        {
+            last = stack.empty() ? no_context : stack.back();
+            if (!stack.empty())
+            {
+                stack.pop_back();
+            }
+        }
+        else if (!is_ignored(c))
+        {
+            last = static_cast<u16>(index(c));
+        }
+    }
+
+    // The symbol after is the first symbol following the current one on the
+    // same branch: the branches starting after it are skipped, and there is
+    // none at the end of a branch. The production is scanned backward, so a
+    // branch is entered at its ']'.
+    stack.clear();
+    u16 next = no_context;
+    for (std::size_t i = production.size(); i-- > 0;)
+    {
+        const char c = production[i];
+        contexts.right[i] = next;
+        if (c == ']')
+        {
+            stack.push_back(next);
+            next = no_context;
+        }
+        else if (c == '[')
+        {
+            next = stack.empty() ? no_context : stack.back();
+            if (!stack.empty())
+            {
+                stack.pop_back();
+            }
+        }
+        else if (!is_ignored(c))
+        {
+            next = static_cast<u16>(index(c));
+        }
+    }
+
+    return contexts;
+}
+
+std::array<u32, 4> philox(std::array<u32, 4> counter, std::array<u32, 2> key)
+{
+    constexpr u64 multiplier_0 = 0xD2511F53;
+    constexpr u64 multiplier_1 = 0xCD9E8D57;
+    constexpr u32 weyl_0 = 0x9E3779B9;
+    constexpr u32 weyl_1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; ++round)
+    {
+        const u64 product_0 = multiplier_0 * counter[0];
+        const u64 product_1 = multiplier_1 * counter[2];
+        counter = {static_cast<u32>(product_1 >> 32) ^ counter[1] ^ key[0],
+                   static_cast<u32>(product_1),
+                   static_cast<u32>(product_0 >> 32) ^ counter[3] ^ key[1],
+                   static_cast<u32>(product_0)};
+        key[0] += weyl_0;
+        key[1] += weyl_1;
+    }
+    return counter;
+}
+
+std::string_view choose_successor(const RuleTable& table,
+                                  std::size_t c,
+                                  u8 iteration_number,
+                                  std::size_t position,
+                                  const ContextTable* contexts)
+{
+    if (contexts)
+    {
+        const u16 left = contexts->left[position];
+        const u16 right = contexts->right[position];
+        for (const auto& rule : table.contexts[c])
+        {
+            if ((rule.left == no_context || rule.left == left)
+                && (rule.right == no_context || rule.right == right))
+            {
+                return rule.successor;
+            }
+        }
+    }
+
+    const auto& choices = table.choices[c];
+    if (choices.empty())
+    {
+        return {table.successors[c], table.sizes[c]};
+    }
+
+    const u64 position_64 = position;
+    const auto random = philox({static_cast<u32>(position_64),
+                                static_cast<u32>(position_64 >> 32),
+                                iteration_number,
+                                0},
+                               {static_cast<u32>(table.seed), static_cast<u32>(table.seed >> 32)});
+    // 53 random bits give a uniform double in [0, 1).
+    const u64 bits = (u64 {random[0]} << 32 | random[1]) >> 11;
+    const double r = bits * 0x1.0p-53;
+
+    auto it = std::find_if(begin(choices), end(choices), [r](const auto& choice) {
+        return r < choice.threshold;
+    });
+    return it != end(choices) ? it->successor : choices.back().successor;
+}
+
+std::size_t derived_size(const RuleTable& table,
+                         std::string_view base,
+                         std::size_t position,
+                         u8 iteration_number,
+                         const ContextTable* contexts)
+{
+    std::size_t size = 0;
+    if (is_expandable(table))
+    {
+        for (char c : base)
+        {
+            size += table.sizes[index(c)];
+        }
+        return size;
+    }
+
+    for (std::size_t i = 0; i < base.size(); ++i)
+    {
+        const auto c = index(base[i]);
+        size += choose_successor(table, c, iteration_number, position + i, contexts).size();
+    }
+    return size;
+}
+
+bool derive(const RuleTable& table,
+            std::string_view base,
+            const IterationRuns* base_iteration,
+            char* production,
+            IterationRuns* iteration,
+            std::size_t position,
+            u8 iteration_number,
+            const ContextTable* contexts)
+{
+    // Accumulate the increments instead of branching in the loop.
+    u8 is_new_iteration = 0;
+
+    // The run of the iteration count of the current symbol.
+    const IterationRuns::Run* run = nullptr;
+    if (iteration && !base.empty())
+    {
+        Expects(base_iteration && position + base.size() <= base_iteration->size());
+        run = &base_iteration->runs()[base_iteration->run_of(position)];
+    }
+
+    const bool is_choosing = !is_expandable(table);
+    for (std::size_t i = 0; i < base.size(); ++i)
+    {
+        const auto c = index(base[i]);
+        const std::string_view successor =
+            is_choosing ? choose_successor(table, c, iteration_number, position + i, contexts)
+                        : std::string_view(table.successors[c], table.sizes[c]);
+        const auto size = successor.size();
+
+        if (production)
+        {
+            std::memcpy(production, successor.data(), size);
+            production += size;
+        }
+
+        // If the current predecessor must be counted, add 1 to each element
+        // of the successor.
+        const u8 increment = table.increments[c];
+        if (iteration)
+        {
+            while (run->end <= position + i)
+            {
+                ++run;
+            }
+            iteration->push_back(run->iteration + increment, size);
+        }
+        is_new_iteration |= increment;
+    }
+
+    return is_new_iteration != 0;
+}
+
+unsigned derivation_thread_count(std::size_t size)
+{
+    return size < parallel_threshold ? 1 : hardware_thread_count();
+}
+
+bool derive_iteration(const RuleTable& table,
+                      std::string_view base,
+                      const IterationRuns& base_iteration,
+                      std::string* production,
+                      IterationRuns* iteration,
+                      unsigned n_threads,
+                      u8 iteration_number)
+{
+    Expects(!iteration || base.size() == base_iteration.size());
+
+    const std::size_t n_chunks =
+        std::max<std::size_t>(1, std::min<std::size_t>(n_threads, base.size()));
+    const auto boundaries = split_in_chunks(base.size(), n_chunks);
+    auto chunk = [&base, &boundaries](std::size_t i) {
+        return base.substr(boundaries[i], boundaries[i + 1] - boundaries[i]);
+    };
+
+    // The contexts of the whole base are needed by each chunk.
+    const auto contexts =
+        table.is_context_sensitive ? compute_contexts(table, base) : ContextTable {};
+    const auto* contexts_ptr = table.is_context_sensitive ? &contexts : nullptr;
+
+    // Size of the derivation of each chunk, then exclusive prefix sum to get
+    // their offsets. 'offsets[n_chunks]' is the total size.
+    std::vector<std::size_t> offsets(n_chunks + 1, 0);
+    parallel_for(n_chunks, [&](std::size_t i) {
+        offsets[i + 1] =
+            derived_size(table, chunk(i), boundaries[i], iteration_number, contexts_ptr);
+    });
+    std::partial_sum(begin(offsets), end(offsets), begin(offsets));
+
+    if (production)
+    {
+        production->resize(offsets[n_chunks]);
+    }
+
+    // Each thread writes its chunk at its offset and encodes its own runs.
+    // 'std::vector<bool>' is not thread-safe for concurrent writes, hence the
+    // 'u8'.
+    std::vector<u8> is_new_iteration(n_chunks, 0);
+    std::vector<IterationRuns> runs(iteration ? n_chunks : 0);
+    parallel_for(n_chunks, [&](std::size_t i) {
+        is_new_iteration[i] = derive(table,
+                                     chunk(i),
+                                     iteration ? &base_iteration : nullptr,
+                                     production ? production->data() + offsets[i] : nullptr,
+                                     iteration ? &runs[i] : nullptr,
+                                     boundaries[i],
+                                     iteration_number,
+                                     contexts_ptr);
+    });
+
+    if (iteration)
+    {
+        iteration->clear();
+        for (const auto& chunk_runs : runs)
+        {
+            iteration->append(chunk_runs);
+        }
+    }
+
+    return std::any_of(begin(is_new_iteration), end(is_new_iteration), [](u8 b) { return b; });
+}
+
+std::vector<SymbolSet> symbols_per_iteration(const RuleTable& table, std::string_view axiom, u8 n)
+{
+    std::vector<SymbolSet> symbols(n);
+    if (n == 0)
+    {
+        return symbols;
+    }
+
+    for (char c : axiom)
+    {
+        symbols[0].set(index(c));
+    }
+    for (u8 i = 1; i < n; ++i)
+    {
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            if (symbols[i - 1].test(c))
+            {
+                const char* successor = table.successors[c];
+                for (std::size_t j = 0; j < table.sizes[c]; ++j)
+                {
+                    symbols[i].set(index(successor[j]));
+                }
+                for (const auto& choice : table.choices[c])
+                {
+                    for (char s : choice.successor)
+                    {
+                        symbols[i].set(index(s));
+                    }
+                }
+                for (const auto& context : table.contexts[c])
+                {
+                    for (char s : context.successor)
+                    {
+                        symbols[i].set(index(s));
+                    }
+                }
+            }
+        }
+    }
+    return symbols;
+}
+
+ExpansionBlocks::ExpansionBlocks(const RuleTable& table,
+                                 const ExpansionLengths& lengths,
+                                 u8 n,
+                                 std::size_t budget)
+{
+    Expects(lengths.size() > n);
+    Expects(is_expandable(table));
+
+    // No block for 0 iteration: a symbol is its own expansion.
+    blocks_.resize(1);
+    for (u8 k = 1; k <= n; ++k)
+    {
+        std::array<std::unique_ptr<const Block>, table_size> level;
+        bool is_level_empty = true;
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            const std::size_t length = lengths[k][c];
+            if (is_terminal(table, c) || length > budget - size_)
+            {
+                continue;
+            }
+
+            // The block is the concatenation of the blocks of the successors
+            // of 'c' after 'k-1' iterations.
+            auto block = std::make_unique<Block>();
+            block->production.reserve(length);
+            const u8 increment = table.increments[c];
+            bool is_complete = true;
+            for (std::size_t j = 0; j < table.sizes[c] && is_complete; ++j)
+            {
+                const char symbol = table.successors[c][j];
+                const auto s = index(symbol);
+                if (k == 1 || is_terminal(table, s))
+                {
+                    block->production.push_back(symbol);
+                    block->iteration.push_back(increment + (k - 1) * table.increments[s]);
+                }
+                else if (const Block* successor = find(s, k - 1))
+                {
+                    block->production += successor->production;
+                    block->iteration.append(successor->iteration, increment);
+                }
+                else
+                {
+                    is_complete = false;
+                }
+            }
+
+            const std::size_t bytes = length + block->iteration.bytes();
+            if (is_complete && bytes <= budget - size_)
+            {
+                size_ += bytes;
+                level[c] = std::move(block);
+                is_level_empty = false;
+            }
+        }
+
+        if (is_level_empty)
+        {
+            // The next levels are made of this one.
+            break;
+        }
+        blocks_.push_back(std::move(level));
+    }
+}
+
+std::size_t ExpansionBlocks::size() const
+{
+    return size_;
+}
+
+namespace
+{
+    // Number of symbols of a packed base decoded at once by a 'SymbolStream'.
+    constexpr std::size_t packed_block_size = 1 << 16;
+
+    // A symbol to expand 'level' times, with its 'iteration' count, whose
+    // expansion starts at 'offset' in the result.
+    struct ExpansionTask
+    {
+        char symbol;
+        u8 level;
+        u8 iteration;
+        std::size_t offset;
+    };
+
+    // Expand depth-first the symbol of 'task' into 'production', and append
+    // the runs of its iteration counts to 'iteration' if it is not null. The
+    // subtrees memoized in 'blocks' are copied at once.
+    void expand_task(const RuleTable& table,
+                     const ExpansionBlocks& blocks,
+                     const ExpansionTask& task,
+                     char* production,
+                     IterationRuns* iteration)
+    {
+        // A range of symbols to expand 'level' times.
+        struct Frame
+        {
+            const char* first;
+            const char* last;
+            u8 level;
+            u8 iteration;
+        };
+
+        // The stack is never deeper than 'task.level', so it is never
+        // reallocated.
+        std::vector<Frame> stack;
+        stack.reserve(task.level + 1);
+        stack.push_back({&task.symbol, &task.symbol + 1, task.level, task.iteration});
+
+        production += task.offset;
+        while (!stack.empty())
+        {
+            Frame& frame = stack.back();
+            if (frame.first == frame.last)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            const char symbol = *frame.first++;
+            const auto c = index(symbol);
+            if (frame.level == 0)
+            {
+                *production++ = symbol;
+                if (iteration)
+                {
+                    iteration->push_back(frame.iteration);
+                }
+            }
+            else if (is_terminal(table, c))
+            {
+                // A terminal symbol is its own expansion, but is still counted
+                // at each iteration.
+                *production++ = symbol;
+                if (iteration)
+                {
+                    iteration->push_back(frame.iteration + frame.level * table.increments[c]);
+                }
+            }
+            else if (const auto* block = blocks.find(c, frame.level))
+            {
+                const auto size = block->production.size();
+                std::memcpy(production, block->production.data(), size);
+                production += size;
+                if (iteration)
+                {
+                    iteration->append(block->iteration, frame.iteration);
+                }
+            }
+            else
+            {
+                const Frame successor {table.successors[c],
+                                       table.successors[c] + table.sizes[c],
+                                       static_cast<u8>(frame.level - 1),
+                                       static_cast<u8>(frame.iteration + table.increments[c])};
+                stack.push_back(successor);
+            }
+        }
+    }
+} // namespace
+
+void expand(const RuleTable& table,
+            const ExpansionLengths& lengths,
+            const ExpansionBlocks& blocks,
+            std::string_view axiom,
+            u8 n,
+            std::string& production,
+            IterationRuns* iteration,
+            unsigned n_threads)
+{
+    Expects(lengths.size() > n);
+    Expects(is_expandable(table));
+
+    // Place each symbol of the axiom in the result.
+    std::vector<ExpansionTask> tasks;
+    std::size_t size = 0;
+    for (char c : axiom)
+    {
+        tasks.push_back({c, n, 0, size});
+        size += lengths[n][index(c)];
+    }
+    production.resize(size);
+
+    // To balance the work between the threads, the biggest subtrees are split
+    // into the subtrees of their successors, placed with their expansion
+    // lengths, until there is enough tasks.
+    const std::size_t min_tasks = n_threads > 1 ? 8 * n_threads : 1;
+    while (tasks.size() < min_tasks)
+    {
+        std::vector<ExpansionTask> split_tasks;
+        for (const auto& task : tasks)
+        {
+            const auto c = index(task.symbol);
+            if (task.level == 0 || is_terminal(table, c))
+            {
+                split_tasks.push_back(task);
+                continue;
+            }
+
+            auto offset = task.offset;
+            const u8 level = task.level - 1;
+            for (std::size_t j = 0; j < table.sizes[c]; ++j)
+            {
+                const char symbol = table.successors[c][j];
+                split_tasks.push_back(
+                    {symbol, level, static_cast<u8>(task.iteration + table.increments[c]), offset});
+                offset += lengths[level][index(symbol)];
+            }
+        }
+
+        if (split_tasks.size() == tasks.size())
+        {
+            // Nothing left to split.
+            break;
+        }
+        tasks = std::move(split_tasks);
+    }
+
+    // Each thread expands a contiguous group of tasks of roughly the same
+    // output size.
+    const std::size_t n_groups =
+        std::max<std::size_t>(1, std::min<std::size_t>(n_threads, tasks.size()));
+    std::vector<std::size_t> groups(n_groups + 1, tasks.size());
+    for (std::size_t i = 0; i < n_groups; ++i)
+    {
+        const std::size_t target = size / n_groups * i;
+        groups[i] = std::lower_bound(begin(tasks),
+                                     end(tasks),
+                                     target,
+                                     [](const auto& task, std::size_t offset) {
+                                         return task.offset < offset;
+                                     })
+                    - begin(tasks);
+    }
+    groups[0] = 0;
+
+    // Each group encodes its own runs, concatenated in order afterwards.
+    std::vector<IterationRuns> runs(iteration ? n_groups : 0);
+    parallel_for(n_groups, [&](std::size_t i) {
+        for (auto j = groups[i]; j < groups[i + 1]; ++j)
+        {
+            expand_task(table,
+                        blocks,
+                        tasks[j],
+                        production.data(),
+                        iteration ? &runs[i] : nullptr);
+        }
+    });
+
+    if (iteration)
+    {
+        iteration->clear();
+        for (const auto& group_runs : runs)
+        {
+            iteration->append(group_runs);
+        }
+    }
+}
+
+SymbolStream::SymbolStream(const RuleTable& table,
+                           std::string_view base,
+                           const IterationRuns* base_iteration,
+                           u8 n,
+                           u8 base_number)
+    : table_ {table}
+    , base_ {base.data()}
+    , base_number_ {base_number}
+{
+    Expects(is_expandable(table) || n <= 1);
+    Expects(!base_iteration || base_iteration->size() == base.size());
+    if (table.is_context_sensitive && n > 0)
+    {
+        contexts_ = compute_contexts(table, base);
+    }
+
+    // The stack is never deeper than 'n' + 1, so it is never reallocated.
+    stack_.reserve(n + 1);
+    const IterationRuns::Run* run =
+        base_iteration && !base_iteration->empty() ? base_iteration->runs().data() : nullptr;
+    stack_.push_back({base.data(), base.data() + base.size(), n, 0, run});
+}
+
+SymbolStream::SymbolStream(const RuleTable& table,
+                           const PackedProduction& base,
+                           const IterationRuns* base_iteration,
+                           u8 n,
+                           u8 base_number)
+    : table_ {table}
+    , base_number_ {base_number}
+    , packed_ {&base}
+{
+    Expects(is_expandable(table) || n <= 1);
+    Expects(!table.is_context_sensitive || n == 0);
+    Expects(!base_iteration || base_iteration->size() == base.size());
+
+    // The stack is never deeper than 'n' + 1, so it is never reallocated.
+    // The base is empty until its first block is decoded by 'next()'.
+    stack_.reserve(n + 1);
+    const IterationRuns::Run* run =
+        base_iteration && !base_iteration->empty() ? base_iteration->runs().data() : nullptr;
+    stack_.push_back({nullptr, nullptr, n, 0, run});
+}
+
+bool SymbolStream::decode_next_block(Frame& frame)
+{
+    if (!packed_ || block_position_ + block_.size() >= packed_->size())
+    {
+        return false;
+    }
+
+    block_position_ += block_.size();
+    block_.resize(std::min(packed_block_size, packed_->size() - block_position_));
+    packed_->unpack(block_position_, block_.size(), block_.data());
+    base_ = block_.data();
+    frame.first = block_.data();
+    frame.last = block_.data() + block_.size();
+    return true;
+}
+
+bool SymbolStream::next(char& symbol, u8& iteration)
+{
+    while (!stack_.empty())
+    {
+        Frame& frame = stack_.back();
+        if (frame.first == frame.last)
+        {
+            // Only the base is at the bottom of the stack.
+            if (stack_.size() == 1 && decode_next_block(frame))
+            {
+                continue;
+            }
+            stack_.pop_back();
+            continue;
+        }
+
+        const char c = *frame.first++;
+        const auto i = index(c);
+        u8 count = frame.iteration;
+        if (frame.run)
+        {
+            // Only the base has a run: the position of its symbols is known.
+            const auto position =
+                block_position_ + static_cast<std::size_t>(frame.first - 1 - base_);
+            while (frame.run->end <= position)
+            {
+                ++frame.run;
+            }
+            count = frame.run->iteration;
+        }
+        if (frame.level == 0)
+        {
+            symbol = c;
+            iteration = count;
+            return true;
+        }
+        if (is_terminal(table_, i))
+        {
+            // A terminal symbol is its own expansion, but is still counted at
+            // each iteration.
+            symbol = c;
+            iteration = count + frame.level * table_.increments[i];
+            return true;
+        }
+
+        // Only the base is derived if the system is not expandable: the
+        // symbol is at the top of the stack.
+        std::string_view chosen(table_.successors[i], table_.sizes[i]);
+        if (!is_expandable(table_))
+        {
+            const auto position =
+                block_position_ + static_cast<std::size_t>(frame.first - 1 - base_);
+            const auto* contexts = table_.is_context_sensitive ? &contexts_ : nullptr;
+            chosen = choose_successor(table_, i, base_number_ + 1, position, contexts);
+        }
+        const Frame successor {chosen.data(),
+                               chosen.data() + chosen.size(),
+                               static_cast<u8>(frame.level - 1),
+                               static_cast<u8>(count + table_.increments[i]),
+                               nullptr};
+        stack_.push_back(successor);
+    }
+    return false;
+}
+
+PackedProduction::PackedProduction(std::string_view production, std::string_view alphabet)
+    : alphabet_ {alphabet}
+    , bits_ {bits_per_symbol(alphabet.size())}
+    , size_ {production.size()}
+{
+    Expects(alphabet.size() <= table_size);
+
+    // 'table_size' is the code of the symbols not in 'alphabet'.
+    std::array<std::size_t, table_size> codes;
+    codes.fill(table_size);
+    for (std::size_t code = 0; code < alphabet.size(); ++code)
+    {
+        Expects(codes[index(alphabet[code])] == table_size);
+        codes[index(alphabet[code])] = code;
+    }
+
+    const std::size_t per_byte = 8 / bits_;
+    data_.resize((size_ + per_byte - 1) / per_byte, 0);
+    for (std::size_t i = 0; i < size_; ++i)
+    {
+        const auto code = codes[index(production[i])];
+        Expects(code < table_size);
+        data_[i / per_byte] |= code << (i % per_byte * bits_);
+    }
+}
+
+unsigned PackedProduction::bits_per_symbol(std::size_t alphabet_size)
+{
+    return alphabet_size <= 4 ? 2 : alphabet_size <= 16 ? 4 : 8;
+}
+
+std::size_t PackedProduction::size() const
+{
+    return size_;
+}
+
+std::size_t PackedProduction::bytes() const
+{
+    return data_.size();
+}
+
+char PackedProduction::symbol_at(std::size_t position) const
+{
+    Expects(position < size_);
+
+    const std::size_t per_byte = 8 / bits_;
+    const unsigned mask = (1u << bits_) - 1;
+    const auto code = (data_[position / per_byte] >> (position % per_byte * bits_)) & mask;
+    return alphabet_[code];
+}
+
+std::string PackedProduction::unpack() const
+{
+    std::string production(size_, '\0');
+    unpack(0, size_, production.data());
+    return production;
+}
+
+void PackedProduction::unpack(std::size_t position, std::size_t count, char* out) const
+{
+    Expects(position + count <= size_);
+
+    // The symbols of each possible byte.
+    const std::size_t per_byte = 8 / bits_;
+    const unsigned mask = (1u << bits_) - 1;
+    std::vector<std::array<char, 4>> symbols(table_size);
+    for (std::size_t byte = 0; byte < table_size; ++byte)
+    {
+        for (std::size_t j = 0; j < per_byte; ++j)
+        {
+            const auto code = (byte >> (j * bits_)) & mask;
+            symbols[byte][j] = code < alphabet_.size() ? alphabet_[code] : '\0';
+        }
+    }
+
+    // The symbols before the first full byte and after the last one are
+    // decoded one by one.
+    const std::size_t last = position + count;
+    std::size_t i = position;
+    for (; i < last && i % per_byte != 0; ++i)
+    {
+        *out++ = symbol_at(i);
+    }
+    for (; i + per_byte <= last; i += per_byte)
+    {
+        std::memcpy(out, symbols[data_[i / per_byte]].data(), per_byte);
+        out += per_byte;
+    }
+    for (; i < last; ++i)
+    {
+        *out++ = symbol_at(i);
+    }
+}
+
+ProductionDag::ProductionDag(const RuleTable& table,
+                             const ExpansionLengths& lengths,
+                             std::string_view axiom,
+                             u8 n)
+    : table_ {table}
+    , axiom_ {axiom}
+    , n_ {n}
+    , axiom_offsets_(axiom.size() + 1, 0)
+    , offsets_(n + 1)
+{
+    Expects(lengths.size() > n);
+    Expects(is_expandable(table));
+
+    for (std::size_t i = 0; i < axiom.size(); ++i)
+    {
+        axiom_offsets_[i + 1] = axiom_offsets_[i] + lengths[n][index(axiom[i])];
+    }
+
+    for (u8 k = 1; k <= n; ++k)
+    {
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            if (is_terminal(table, c))
+            {
+                continue;
+            }
+            auto& offsets = offsets_[k][c];
+            offsets.resize(table.sizes[c] + 1, 0);
+            for (std::size_t j = 0; j < table.sizes[c]; ++j)
+            {
+                offsets[j + 1] = offsets[j] + lengths[k - 1][index(table.successors[c][j])];
+            }
+        }
+    }
+}
+
+std::size_t ProductionDag::size() const
+{
+    return axiom_offsets_.back();
+}
+
+std::size_t ProductionDag::locate(const std::vector<std::size_t>& offsets, std::size_t& position)
+{
+    // The last symbol starting at or before 'position': the empty expansions
+    // are skipped.
+    const auto j = std::upper_bound(begin(offsets), end(offsets), position) - begin(offsets) - 1;
+    position -= offsets[j];
+    return j;
+}
+
+std::pair<char, u8> ProductionDag::symbol_at(std::size_t position) const
+{
+    Expects(position < size());
+
+    char symbol = axiom_[locate(axiom_offsets_, position)];
+    u8 level = n_;
+    u8 iteration = 0;
+    while (level > 0 && !is_terminal(table_, index(symbol)))
+    {
+        const auto c = index(symbol);
+        iteration += table_.increments[c];
+        symbol = table_.successors[c][locate(offsets_[level][c], position)];
+        --level;
+    }
+    // A terminal is still counted at each remaining iteration.
+    iteration += level * table_.increments[index(symbol)];
+    return {symbol, iteration};
+}
+
+SymbolStream ProductionDag::stream_from(std::size_t position) const
+{
+    Expects(position <= size());
+
+    SymbolStream stream;
+    stream.table_ = table_;
+    if (position == size())
+    {
+        return stream;
+    }
+
+    // Each level pushes the symbols after the one containing 'position',
+    // then descends in it.
+    const char* first = axiom_.data();
+    const char* last = axiom_.data() + axiom_.size();
+    const char* symbol = first + locate(axiom_offsets_, position);
+    u8 level = n_;
+    u8 iteration = 0;
+    stream.stack_.reserve(2 * (n_ + 1));
+    while (true)
+    {
+        stream.stack_.push_back({symbol + 1, last, level, iteration, nullptr});
+        const auto c = index(*symbol);
+        if (level == 0 || is_terminal(table_, c))
+        {
+            break;
+        }
+
+        iteration += table_.increments[c];
+        first = table_.successors[c];
+        last = first + table_.sizes[c];
+        symbol = first + locate(offsets_[level][c], position);
+        --level;
+    }
+    // The symbol containing 'position' is the first one streamed.
+    stream.stack_.push_back({symbol, symbol + 1, level, iteration, nullptr});
+    return stream;
+}
+
+void ProductionDag::slice(std::size_t first,
+                          std::size_t last,
+                          std::string& production,
+                          IterationRuns& iteration) const
+{
+    Expects(first <= last && last <= size());
+
+    production.resize(last - first);
+    iteration.clear();
+    auto stream = stream_from(first);
+    u8 count = 0;
+    for (std::size_t i = 0; i < last - first; ++i)
+    {
+        stream.next(production[i], count);
+        iteration.push_back(count);
+    }
+}
+} // namespace derivation
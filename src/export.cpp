@@ -6,8 +6,10 @@ namespace drawing
 {
 std::vector<sf::Vertex> add_width(const std::vector<sf::Vertex>& v, float w)
 {
+    // 'v' are the two vertices of each segment, and each segment becomes a
+    // quad of two triangles.
     std::vector<sf::Vertex> vw;
-    vw.reserve(v.size() * 2);
+    vw.reserve(v.size() * 3);
     auto normal = [](auto p1, auto p2) { return sf::Vector2f(-(p2.y - p1.y), p2.x - p1.x); };
     auto normalize = [](auto v) {
         auto norm = std::sqrt(v.x * v.x + v.y * v.y);
@@ -19,7 +21,7 @@ std::vector<sf::Vertex> add_width(const std::vector<sf::Vertex>& v, float w)
             return v;
         }
     };
-    for (auto i = 1u; i < v.size(); ++i)
+    for (auto i = 1u; i < v.size(); i += 2)
     {
         auto n = normalize(normal(v[i - 1].position, v[i].position));
         auto p2 = v[i - 1].position + w * n;
@@ -29,6 +31,8 @@ std::vector<sf::Vertex> add_width(const std::vector<sf::Vertex>& v, float w)
         vw.push_back(v[i - 1]);
         vw.push_back(vx2);
         vw.push_back(v[i]);
+        vw.push_back(v[i]);
+        vw.push_back(vx2);
         vw.push_back(vx4);
     }
     return vw;
@@ -56,7 +60,8 @@ bool export_to_png(procgui::LSystemView view,
     auto step = view.get_parameters().get_step();
     view.ref_parameters().set_step(step * dim_ratio);
     box = view.get_bounding_box();
-    const auto& v = view.get_turtle().vertices_;
+    // The segments are converted to the layout of SFML only for the export.
+    const auto v = to_sfml(view.get_vertices(), view.get_colors());
 
     std::vector<sf::Vertex> vertices = add_width(v, 1 / ratio);
 
@@ -67,7 +72,7 @@ bool export_to_png(procgui::LSystemView view,
     render.setView(render_view);
     render.clear(sf::Color::Black);
 
-    render.draw(vertices.data(), vertices.size(), sf::TriangleStrip, view.get_transform());
+    render.draw(vertices.data(), vertices.size(), sf::Triangles, view.get_transform());
 
     const auto& texture = render.getTexture();
     auto image = texture.copyToImage();
@@ -104,42 +104,42 @@ sf::Vector2f project_and_clamp(sf::Vector2f A, sf::Vector2f B, sf::Vector2f P)
     return projection;
 }
 
-sf::FloatRect bounding_box(const std::vector<sf::Vertex>& vertices)
+sf::FloatRect bounding_box(const std::vector<sf::Vector2f>& positions)
 {
-    if (vertices.empty())
+    if (positions.empty())
     {
         return {0, 0, 0, 0};
     }
-    const auto& first = vertices.at(0);
+    const auto& first = positions.at(0);
     // Warning: 'top' is at low value because of the axes defined by SFML.
-    float top = first.position.y, down = first.position.y;
-    float left = first.position.x, right = first.position.x;
+    float top = first.y, down = first.y;
+    float left = first.x, right = first.x;
 
     // For each vertices, update the bounding box coordinates if necessary.
-    for (const auto& v : vertices)
+    for (const auto& position : positions)
     {
-        if (v.position.y < top)
+        if (position.y < top)
         {
-            top = v.position.y;
+            top = position.y;
         }
-        else if (v.position.y > down)
+        else if (position.y > down)
         {
-            down = v.position.y;
+            down = position.y;
         }
 
-        if (v.position.x > right)
+        if (position.x > right)
         {
-            right = v.position.x;
+            right = position.x;
         }
-        else if (v.position.x < left)
+        else if (position.x < left)
         {
-            left = v.position.x;
+            left = position.x;
         }
     }
     return {left, top, right - left, down - top};
 }
 
-std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vertex>& vertices, int max_boxes)
+std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vector2f>& positions, int max_boxes)
 {
     Expects(max_boxes > 0);
 
@@ -159,7 +159,7 @@ std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vertex>& vertices, in
     // the number of 'max_boxes', we divide by 'max_boxes-1'.
     // Edge case: If 'max_boxes' is equal to 1 or 2, it will be a single
     // bounding box, as there is not any remainder.
-    int vertices_per_box = vertices.size() / (max_boxes - 1);
+    int vertices_per_box = positions.size() / (max_boxes - 1);
 
     // The algorithm makes overlapping boxes. We must have a least 4
     // vertices per box.
@@ -170,8 +170,8 @@ std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vertex>& vertices, in
     vertices_per_box = vertices_per_box < 4 ? 4 : vertices_per_box;
 
     int n = 0;
-    std::vector<sf::Vertex> box_vertices;
-    for (size_t i = 0; i < vertices.size(); ++i)
+    std::vector<sf::Vector2f> box_positions;
+    for (size_t i = 0; i < positions.size(); ++i)
     {
         // Create a box when the number of vertices is attained
         if (n == vertices_per_box)
@@ -179,19 +179,19 @@ std::vector<sf::FloatRect> sub_boxes(const std::vector<sf::Vertex>& vertices, in
             n = 0;
             i -= 3; // Go back to count several time the number of vertices
                     // to make overlapping boxes
-            boxes.push_back(bounding_box(box_vertices));
-            box_vertices.clear();
+            boxes.push_back(bounding_box(box_positions));
+            box_positions.clear();
         }
 
         // Add a vertex to the next box.
-        box_vertices.push_back(vertices.at(i));
+        box_positions.push_back(positions.at(i));
         ++n;
 
         // For the final box, the remainder of the vertices does not attain
         // 'vertices_per_box', so manually set it.
-        if (i == vertices.size() - 1)
+        if (i == positions.size() - 1)
         {
-            boxes.push_back(bounding_box(box_vertices));
+            boxes.push_back(bounding_box(box_positions));
         }
     }
 
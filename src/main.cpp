@@ -296,10 +296,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         for (int i = 0; i < 5; ++i)
         {
             serpinski.add_rule('F', {serpinski.get_rule('F').second + "F"});
-            auto size = drawing::compute_max_size(serpinski,
-                                                  drawing::default_interpretation_map,
-                                                  10);
-            serpinski.produce(10, size.lsystem_size);
+            serpinski.produce(10);
             std::cout << serpinski.get_production_cache().at(10).size() << std::endl;
         }
     }
@@ -314,7 +311,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         drawing::Turtle turtle(params);
 
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, _] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, _] = serpinski.produce(10);
         for (int i = 0; i < 5; ++i)
         {
             turtle.compute_vertices(str, rec, map, size.vertices_size);
@@ -327,7 +324,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         auto map = drawing::default_interpretation_map;
@@ -337,15 +334,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         ColorGeneratorWrapper wcc(std::make_shared<ConstantColor>(cc));
         VertexPainterConstant vp(wcc);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 20; ++i)
         {
-            vp.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vp.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -354,7 +350,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         std::cout << "TESTING VERTEXPAINTER LINEAR\n";
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -367,15 +363,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         vp.set_angle(25);
         vp.set_display_flag(false);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vp.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vp.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -385,7 +380,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -399,15 +394,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         VertexPainterRadial vr(wlc);
         vr.set_display_flag(false);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vr.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vr.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -417,7 +411,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -431,15 +425,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         VertexPainterRandom vr(wlc);
         vr.set_block_size(500);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vr.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vr.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -449,7 +442,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -463,15 +456,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         VertexPainterSequential vs(wlc);
         vs.set_factor(2);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vs.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vs.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -481,7 +473,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -494,15 +486,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         ColorGeneratorWrapper wlc(std::make_shared<LinearGradient>(lc));
         VertexPainterIteration vi(wlc);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vi.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vi.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -512,7 +503,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -535,15 +526,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         auto wc1 = std::make_shared<VertexPainterComposite>();
         wc1->set_child_painters(depth3);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 5; ++i)
         {
-            wc1->paint_vertices(vx, vx_iter, vx_tr, max, box);
+            wc1->paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -553,7 +543,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -569,15 +559,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         ColorGeneratorWrapper wlc(std::make_shared<LinearGradient>(lc));
         VertexPainterSequential vs(wlc);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vs.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vs.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
@@ -587,7 +576,7 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
 
         LSystem serpinski = LSystem({"F", {{'F', "G[-F-GFFFF"}, {'G', "F]]+G+F"}}, "G"});
         auto size = drawing::compute_max_size(serpinski, drawing::default_interpretation_map, 10);
-        const auto& [str, rec, max] = serpinski.produce(10, size.lsystem_size);
+        const auto& [str, rec, max] = serpinski.produce(10);
 
         DrawingParameters params;
         params.set_n_iter(10);
@@ -602,15 +591,14 @@ void opt(int argc, char* argv[]) // NOLINT c-style array
         VertexPainterSequential vs(wlc);
         vs.set_factor(2);
 
-        const auto& [vx,
-                     vx_iter,
-                     vx_tr] = turtle.compute_vertices(str, rec, map, size.vertices_size);
-        auto box = geometry::bounding_box(vx);
+        const auto& [vx, vx_iter] = turtle.compute_vertices(str, rec, map, size.vertices_size);
+        std::vector<sf::Color> colors(vx.size());
+        auto box = geometry::bounding_box(vx.positions);
 
         std::cout << "BeginPainting\n";
         for (int i = 0; i < 9; ++i)
         {
-            vs.paint_vertices(vx, vx_iter, vx_tr, max, box);
+            vs.paint_vertices(colors, vx, vx_iter, max, box);
             std::cout << i << std::endl;
         }
     }
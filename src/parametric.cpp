@@ -0,0 +1,661 @@
+#include "parametric.h"
+
+#include "helper_parallel.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <gsl/gsl>
+#include <limits>
+#include <numeric>
+
+namespace parametric
+{
+namespace
+{
+// Apply the arithmetic or logical operation 'op' to 'left' and 'right'. The
+// unary operations ignore 'right'.
+inline double apply(OpCode op, double left, double right)
+{
+    switch (op)
+    {
+    case OpCode::ADD:
+        return left + right;
+    case OpCode::SUBTRACT:
+        return left - right;
+    case OpCode::MULTIPLY:
+        return left * right;
+    case OpCode::DIVIDE:
+        return left / right;
+    case OpCode::POWER:
+        return std::pow(left, right);
+    case OpCode::NEGATE:
+        return -left;
+    case OpCode::NOT:
+        return left == 0;
+    case OpCode::LESS:
+        return left < right;
+    case OpCode::LESS_EQUAL:
+        return left <= right;
+    case OpCode::GREATER:
+        return left > right;
+    case OpCode::GREATER_EQUAL:
+        return left >= right;
+    case OpCode::EQUAL:
+        return left == right;
+    case OpCode::NOT_EQUAL:
+        return left != right;
+    case OpCode::AND:
+        return left != 0 && right != 0;
+    case OpCode::OR:
+        return left != 0 || right != 0;
+    default:
+        Expects(false);
+        return 0;
+    }
+}
+
+bool is_space(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_identifier_start(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) != 0 || c == '_';
+}
+
+bool is_identifier(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+}
+
+std::string_view trim(std::string_view text)
+{
+    while (!text.empty() && is_space(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// A recursive descent parser compiling an expression into a 'Program'.
+//
+// Each parsing function compiles a subexpression whose value must end in the
+// register 'r', using only the registers from 'r'. A subexpression whose
+// operands are all constants is folded: it is not compiled but returned as an
+// 'Operand' holding its value, and only loaded in a register when combined
+// with a variable.
+class ExpressionCompiler
+{
+  public:
+    ExpressionCompiler(std::string_view text, const std::vector<std::string>& names)
+        : text_ {text}
+        , names_ {names}
+    {
+    }
+
+    std::optional<Program> compile()
+    {
+        const auto result = parse_or(0);
+        skip_spaces();
+        if (!is_valid_ || pos_ != text_.size())
+        {
+            return std::nullopt;
+        }
+        load(result, 0);
+        return is_valid_ ? std::optional(std::move(program_)) : std::nullopt;
+    }
+
+  private:
+    // The value of a subexpression: either a folded constant, or the register
+    // given to the parsing function.
+    struct Operand
+    {
+        bool is_constant;
+        double value;
+    };
+
+    void skip_spaces()
+    {
+        while (pos_ < text_.size() && is_space(text_[pos_]))
+        {
+            ++pos_;
+        }
+    }
+
+    // Consume 'token' if it is the next token.
+    bool accept(std::string_view token)
+    {
+        skip_spaces();
+        if (text_.substr(pos_, token.size()) == token)
+        {
+            pos_ += token.size();
+            return true;
+        }
+        return false;
+    }
+
+    Operand fail()
+    {
+        is_valid_ = false;
+        return {true, 0};
+    }
+
+    void emit(OpCode op, std::size_t result, std::size_t left, std::size_t right)
+    {
+        program_.code.push_back(
+            {op, static_cast<u8>(result), static_cast<u8>(left), static_cast<u8>(right)});
+    }
+
+    // Make sure the value of 'operand' is in the register 'r'.
+    void load(Operand operand, std::size_t r)
+    {
+        if (!operand.is_constant)
+        {
+            return;
+        }
+        if (program_.constants.size() > std::numeric_limits<u8>::max())
+        {
+            is_valid_ = false;
+            return;
+        }
+        emit(OpCode::CONSTANT, r, program_.constants.size(), 0);
+        program_.constants.push_back(operand.value);
+    }
+
+    Operand combine(OpCode op, Operand left, Operand right, std::size_t r)
+    {
+        if (left.is_constant && right.is_constant)
+        {
+            return {true, apply(op, left.value, right.value)};
+        }
+        load(left, r);
+        load(right, r + 1);
+        emit(op, r, r, r + 1);
+        return {false, 0};
+    }
+
+    // Parse a left-associative sequence of 'next' separated by the binary
+    // operators of 'operators'.
+    template<std::size_t N, typename Next>
+    Operand parse_binary(const std::array<std::pair<std::string_view, OpCode>, N>& operators,
+                         std::size_t r,
+                         Next next)
+    {
+        auto left = (this->*next)(r);
+        bool found = true;
+        while (is_valid_ && found)
+        {
+            found = false;
+            for (const auto& [token, op] : operators)
+            {
+                if (accept(token))
+                {
+                    const auto right = (this->*next)(r + 1);
+                    left = combine(op, left, right, r);
+                    found = true;
+                    break;
+                }
+            }
+        }
+        return left;
+    }
+
+    Operand parse_or(std::size_t r)
+    {
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 1> operators {
+            {{"||", OpCode::OR}}};
+        return parse_binary(operators, r, &ExpressionCompiler::parse_and);
+    }
+
+    Operand parse_and(std::size_t r)
+    {
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 1> operators {
+            {{"&&", OpCode::AND}}};
+        return parse_binary(operators, r, &ExpressionCompiler::parse_comparison);
+    }
+
+    Operand parse_comparison(std::size_t r)
+    {
+        // The two-character operators are tried first.
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 6> operators {
+            {{"<=", OpCode::LESS_EQUAL},
+             {">=", OpCode::GREATER_EQUAL},
+             {"==", OpCode::EQUAL},
+             {"!=", OpCode::NOT_EQUAL},
+             {"<", OpCode::LESS},
+             {">", OpCode::GREATER}}};
+        return parse_binary(operators, r, &ExpressionCompiler::parse_sum);
+    }
+
+    Operand parse_sum(std::size_t r)
+    {
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 2> operators {
+            {{"+", OpCode::ADD}, {"-", OpCode::SUBTRACT}}};
+        return parse_binary(operators, r, &ExpressionCompiler::parse_product);
+    }
+
+    Operand parse_product(std::size_t r)
+    {
+        static constexpr std::array<std::pair<std::string_view, OpCode>, 2> operators {
+            {{"*", OpCode::MULTIPLY}, {"/", OpCode::DIVIDE}}};
+        return parse_binary(operators, r, &ExpressionCompiler::parse_unary);
+    }
+
+    Operand parse_unary(std::size_t r)
+    {
+        const bool is_not = accept("!");
+        if (is_not || accept("-"))
+        {
+            const OpCode op = is_not ? OpCode::NOT : OpCode::NEGATE;
+            const auto operand = parse_unary(r);
+            if (operand.is_constant)
+            {
+                return {true, apply(op, operand.value, 0)};
+            }
+            emit(op, r, r, r);
+            return {false, 0};
+        }
+        return parse_power(r);
+    }
+
+    // The power is right-associative and binds tighter than the unary minus
+    // on its left: "-2^2" is -4 and "2^-1" is 0.5.
+    Operand parse_power(std::size_t r)
+    {
+        const auto base = parse_primary(r);
+        if (is_valid_ && accept("^"))
+        {
+            const auto exponent = parse_unary(r + 1);
+            return combine(OpCode::POWER, base, exponent, r);
+        }
+        return base;
+    }
+
+    Operand parse_primary(std::size_t r)
+    {
+        // The operands of a binary operation use two registers.
+        if (r + 1 >= max_registers)
+        {
+            return fail();
+        }
+
+        skip_spaces();
+        if (pos_ == text_.size())
+        {
+            return fail();
+        }
+
+        if (accept("("))
+        {
+            const auto operand = parse_or(r);
+            return accept(")") ? operand : fail();
+        }
+
+        const char c = text_[pos_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+        {
+            double value = 0;
+            const auto [end, error] =
+                std::from_chars(text_.data() + pos_, text_.data() + text_.size(), value);
+            if (error != std::errc())
+            {
+                return fail();
+            }
+            pos_ = end - text_.data();
+            return {true, value};
+        }
+
+        if (is_identifier_start(c))
+        {
+            const auto start = pos_;
+            while (pos_ < text_.size() && is_identifier(text_[pos_]))
+            {
+                ++pos_;
+            }
+            const auto name = text_.substr(start, pos_ - start);
+            const auto it = std::find(begin(names_), end(names_), name);
+            if (it == end(names_))
+            {
+                return fail();
+            }
+            emit(OpCode::PARAMETER, r, std::distance(begin(names_), it), 0);
+            return {false, 0};
+        }
+
+        return fail();
+    }
+
+    std::string_view text_;
+    const std::vector<std::string>& names_;
+    std::size_t pos_ {0};
+    bool is_valid_ {true};
+    Program program_ {};
+};
+
+// A module of a string of modules: a symbol and the text of its arguments.
+struct Module
+{
+    char symbol;
+    std::vector<std::string_view> arguments;
+};
+
+// Split 'text' into its modules. The spaces between the modules are ignored.
+// Returns 'std::nullopt' if a parenthesis is not matched.
+std::optional<std::vector<Module>> split_modules(std::string_view text)
+{
+    std::vector<Module> modules;
+    std::size_t i = 0;
+    while (i < text.size())
+    {
+        if (is_space(text[i]))
+        {
+            ++i;
+            continue;
+        }
+        if (text[i] == '(' || text[i] == ')')
+        {
+            return std::nullopt;
+        }
+
+        Module module {text[i], {}};
+        ++i;
+        if (i < text.size() && text[i] == '(')
+        {
+            // The arguments are separated by the commas outside of nested
+            // parentheses.
+            int depth = 1;
+            std::size_t start = ++i;
+            for (; i < text.size() && depth > 0; ++i)
+            {
+                if (text[i] == '(')
+                {
+                    ++depth;
+                }
+                else if (text[i] == ')')
+                {
+                    --depth;
+                }
+                if ((depth == 1 && text[i] == ',') || depth == 0)
+                {
+                    module.arguments.push_back(trim(text.substr(start, i - start)));
+                    start = i + 1;
+                }
+            }
+            if (depth > 0)
+            {
+                return std::nullopt;
+            }
+            // "F()" has no parameter.
+            if (module.arguments.size() == 1 && module.arguments.front().empty())
+            {
+                module.arguments.clear();
+            }
+        }
+        modules.push_back(std::move(module));
+    }
+    return modules;
+}
+} // namespace
+
+std::optional<Program> compile_expression(std::string_view expression,
+                                          const std::vector<std::string>& names)
+{
+    if (names.size() > std::numeric_limits<u8>::max())
+    {
+        return std::nullopt;
+    }
+    return ExpressionCompiler(expression, names).compile();
+}
+
+double evaluate(const Program& program, const double* parameters)
+{
+    std::array<double, max_registers> registers;
+    for (const auto& [op, result, left, right] : program.code)
+    {
+        switch (op)
+        {
+        case OpCode::CONSTANT:
+            registers[result] = program.constants[left];
+            break;
+        case OpCode::PARAMETER:
+            registers[result] = parameters[left];
+            break;
+        default:
+            registers[result] = apply(op, registers[left], registers[right]);
+            break;
+        }
+    }
+    return registers[0];
+}
+
+std::optional<Production> parse_production(std::string_view axiom)
+{
+    const auto modules = split_modules(axiom);
+    if (!modules)
+    {
+        return std::nullopt;
+    }
+
+    Production production;
+    for (const auto& [symbol, arguments] : *modules)
+    {
+        for (const auto& argument : arguments)
+        {
+            const auto program = compile_expression(argument);
+            if (!program)
+            {
+                return std::nullopt;
+            }
+            production.parameters.push_back(evaluate(*program, nullptr));
+        }
+        production.symbols.push_back(symbol);
+        production.offsets.push_back(production.parameters.size());
+    }
+    production.iterations.resize(production.symbols.size(), 0);
+    return production;
+}
+
+std::optional<ParametricTable> compile_rules(const ParametricRules& rules,
+                                             const std::string& iteration_predecessors)
+{
+    ParametricTable table;
+
+    for (const auto& [predecessor, condition, successor] : rules)
+    {
+        // The predecessor is a single module whose arguments are distinct
+        // names.
+        const auto predecessor_modules = split_modules(predecessor);
+        if (!predecessor_modules || predecessor_modules->size() != 1
+            || predecessor_modules->front().arguments.size() > std::numeric_limits<u8>::max())
+        {
+            return std::nullopt;
+        }
+        const auto& [symbol, formal_parameters] = predecessor_modules->front();
+        std::vector<std::string> names;
+        for (const auto& name : formal_parameters)
+        {
+            const bool is_name = !name.empty() && is_identifier_start(name.front())
+                                 && std::all_of(begin(name), end(name), is_identifier);
+            if (!is_name || std::find(begin(names), end(names), name) != end(names))
+            {
+                return std::nullopt;
+            }
+            names.emplace_back(name);
+        }
+
+        ParametricTable::Rule rule {static_cast<u8>(names.size()), std::nullopt, {}, {0}, {}};
+        if (!trim(condition).empty())
+        {
+            rule.condition = compile_expression(condition, names);
+            if (!rule.condition)
+            {
+                return std::nullopt;
+            }
+        }
+
+        const auto successor_modules = split_modules(successor);
+        if (!successor_modules)
+        {
+            return std::nullopt;
+        }
+        for (const auto& [successor_symbol, arguments] : *successor_modules)
+        {
+            for (const auto& argument : arguments)
+            {
+                auto program = compile_expression(argument, names);
+                if (!program)
+                {
+                    return std::nullopt;
+                }
+                rule.arguments.push_back(std::move(*program));
+            }
+            rule.symbols.push_back(successor_symbol);
+            rule.offsets.push_back(rule.arguments.size());
+        }
+
+        table.rules.at(derivation::index(symbol)).push_back(std::move(rule));
+    }
+
+    for (char c : iteration_predecessors)
+    {
+        table.increments.at(derivation::index(c)) = 1;
+    }
+
+    return table;
+}
+
+bool derive(const ParametricTable& table,
+            const Production& base,
+            Production& production,
+            unsigned n_threads)
+{
+    Expects(&base != &production);
+    Expects(base.offsets.size() == base.symbols.size() + 1);
+
+    const std::size_t size = base.symbols.size();
+    const std::size_t n_chunks =
+        std::max<std::size_t>(1, std::min<std::size_t>(n_threads, size));
+    const auto boundaries = split_in_chunks(size, n_chunks);
+
+    // The rule applied to each module: 0 if the module is replaced by
+    // itself, 'k' for the rule 'k-1' of its symbol.
+    std::vector<u16> chosen(size);
+
+    // Number of symbols and of parameters derived from each chunk, then
+    // exclusive prefix sums to get their offsets. The last element is the
+    // total.
+    std::vector<std::size_t> symbol_offsets(n_chunks + 1, 0);
+    std::vector<std::size_t> parameter_offsets(n_chunks + 1, 0);
+    parallel_for(n_chunks, [&](std::size_t k) {
+        std::size_t n_symbols = 0;
+        std::size_t n_parameters = 0;
+        for (std::size_t i = boundaries[k]; i < boundaries[k + 1]; ++i)
+        {
+            const auto& rules = table.rules[derivation::index(base.symbols[i])];
+            const auto arity = base.arity(i);
+            const double* parameters = base.parameters_of(i);
+
+            u16 choice = 0;
+            for (std::size_t r = 0; r < rules.size() && choice == 0; ++r)
+            {
+                const auto& rule = rules[r];
+                if (rule.arity == arity
+                    && (!rule.condition || evaluate(*rule.condition, parameters) != 0))
+                {
+                    choice = static_cast<u16>(r + 1);
+                    n_symbols += rule.symbols.size();
+                    n_parameters += rule.arguments.size();
+                }
+            }
+            if (choice == 0)
+            {
+                n_symbols += 1;
+                n_parameters += arity;
+            }
+            chosen[i] = choice;
+        }
+        symbol_offsets[k + 1] = n_symbols;
+        parameter_offsets[k + 1] = n_parameters;
+    });
+    std::partial_sum(begin(symbol_offsets), end(symbol_offsets), begin(symbol_offsets));
+    std::partial_sum(begin(parameter_offsets), end(parameter_offsets), begin(parameter_offsets));
+
+    const auto n_symbols = symbol_offsets[n_chunks];
+    const auto n_parameters = parameter_offsets[n_chunks];
+    Expects(n_parameters <= std::numeric_limits<u32>::max());
+    production.symbols.resize(n_symbols);
+    production.iterations.resize(n_symbols);
+    production.offsets.resize(n_symbols + 1);
+    production.parameters.resize(n_parameters);
+    production.offsets[n_symbols] = static_cast<u32>(n_parameters);
+
+    // Each chunk writes its successors at its offsets.
+    std::vector<u8> is_new_iteration(n_chunks, 0);
+    parallel_for(n_chunks, [&](std::size_t k) {
+        std::size_t s = symbol_offsets[k];
+        std::size_t p = parameter_offsets[k];
+        u8 new_iteration = 0;
+        for (std::size_t i = boundaries[k]; i < boundaries[k + 1]; ++i)
+        {
+            const char symbol = base.symbols[i];
+            const auto c = derivation::index(symbol);
+            const double* parameters = base.parameters_of(i);
+            const u8 increment = table.increments[c];
+            const u8 iteration = base.iterations[i] + increment;
+            new_iteration |= increment;
+
+            if (chosen[i] == 0)
+            {
+                production.symbols[s] = symbol;
+                production.iterations[s] = iteration;
+                production.offsets[s] = static_cast<u32>(p);
+                p = std::copy_n(parameters, base.arity(i), production.parameters.data() + p)
+                    - production.parameters.data();
+                ++s;
+                continue;
+            }
+
+            const auto& rule = table.rules[c][chosen[i] - 1];
+            for (std::size_t j = 0; j < rule.symbols.size(); ++j)
+            {
+                production.symbols[s] = rule.symbols[j];
+                production.iterations[s] = iteration;
+                production.offsets[s] = static_cast<u32>(p);
+                for (auto a = rule.offsets[j]; a < rule.offsets[j + 1]; ++a)
+                {
+                    production.parameters[p++] = evaluate(rule.arguments[a], parameters);
+                }
+                ++s;
+            }
+        }
+        is_new_iteration[k] = new_iteration;
+    });
+
+    const bool new_iteration =
+        std::any_of(begin(is_new_iteration), end(is_new_iteration), [](u8 b) { return b; });
+    production.max_iteration = base.max_iteration + (new_iteration ? 1 : 0);
+    return new_iteration;
+}
+
+Production produce(const ParametricTable& table, const Production& axiom, u8 n)
+{
+    Production production = axiom;
+    Production next;
+    for (u8 i = 0; i < n; ++i)
+    {
+        derive(table,
+               production,
+               next,
+               derivation::derivation_thread_count(production.symbols.size()));
+        std::swap(production, next);
+    }
+    return production;
+}
+} // namespace parametric
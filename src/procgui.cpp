@@ -17,6 +17,7 @@
 
 #include <cctype>
 #include <cstring>
+#include <map>
 
 using namespace math;
 using std::clamp;
@@ -312,6 +313,95 @@ void interact_with(LSystemBuffer& buffer, const std::string& name)
         }
     });
 
+    // --- Stochastic successors ---
+    // predecessor -> [ successor ] [weight] [-] (remove successor)
+    // [+ predecessor] (add a successor to the rule of predecessor)
+    ImGui::Text("Stochastic successors:");
+    ImGui::SameLine();
+    ext::ImGui::ShowHelpMarker("Other successors of a rule, chosen randomly at each derivation "
+                               "with a probability proportional to their weight. The successor "
+                               "of the rule has a weight of 1.");
+    const std::map<char, std::string> rules(begin(lsys.get_rules()), end(lsys.get_rules()));
+    for (const auto& [predecessor, rule_successor] : rules)
+    {
+        const auto stochastic = lsys.get_stochastic_rules().find(predecessor);
+        auto successors = stochastic != end(lsys.get_stochastic_rules())
+                              ? stochastic->second
+                              : std::vector<derivation::WeightedSuccessor> {};
+        bool is_modified = false;
+        std::size_t to_remove = successors.size();
+
+        ImGui::PushID(predecessor);
+        for (std::size_t i = 0; i < successors.size(); ++i)
+        {
+            ImGui::PushID(static_cast<int>(i));
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%c ->", predecessor);
+            ImGui::SameLine();
+
+            auto array = string_to_array<lsys_successor_size>(successors[i].successor);
+            if (ImGui::InputText("##succ", array.data(), lsys_successor_size))
+            {
+                successors[i].successor = array_to_string(array);
+                is_modified = true;
+            }
+            ImGui::SameLine();
+
+            // The weights are strictly positive.
+            float weight = successors[i].weight;
+            ImGui::PushItemWidth(50);
+            if (ImGui::DragFloat("##weight", &weight, 0.01, 0.01, 100., "%.2f") && weight > 0)
+            {
+                successors[i].weight = weight;
+                is_modified = true;
+            }
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+
+            ext::ImGui::PushStyleColoredButton<ext::ImGui::Red>();
+            if (ImGui::Button("-"))
+            {
+                to_remove = i;
+                is_modified = true;
+            }
+            ImGui::PopStyleColor(3);
+            ImGui::PopID();
+        }
+
+        // A new successor starts as a copy of the successor of the rule.
+        ext::ImGui::PushStyleColoredButton<ext::ImGui::Green>();
+        if (ImGui::Button((std::string("+ ") + predecessor).c_str()))
+        {
+            successors.push_back({rule_successor, 1.});
+            is_modified = true;
+        }
+        ImGui::PopStyleColor(3);
+        ImGui::PopID();
+
+        if (to_remove < successors.size())
+        {
+            successors.erase(begin(successors) + to_remove);
+        }
+        if (is_modified)
+        {
+            lsys.clear_stochastic_successors(predecessor);
+            for (const auto& [successor, weight] : successors)
+            {
+                lsys.add_stochastic_successor(predecessor, successor, weight);
+            }
+        }
+    }
+
+    // --- Seed ---
+    u64 seed = lsys.get_seed();
+    if (ImGui::InputScalar("Seed", ImGuiDataType_U64, &seed))
+    {
+        lsys.set_seed(seed);
+    }
+    ImGui::SameLine();
+    ext::ImGui::ShowHelpMarker("The random choices of the stochastic successors only depend on "
+                               "the seed: the same seed always gives the same drawing.");
+
     // --- Iteration Predecessors ---
     buf = string_to_array<lsys_successor_size>(lsys.get_iteration_predecessors());
     if (ImGui::InputText("Iteration predecessors", buf.data(), lsys_successor_size))
@@ -216,10 +216,6 @@ Matrix map_matrix(const drawing::InterpretationMap& map, const std::string& pred
             {
                 row.at(0) = vx_per_goforward;
             }
-            else if (order.id == loadposition)
-            {
-                row.at(0) = vx_per_loadposition;
-            }
         }
         // Otherwise, keep the row at 0.
     }
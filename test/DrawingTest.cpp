@@ -1,6 +1,7 @@
 #include "InterpretationMap.h"
 #include "LSystem.h"
 #include "Turtle.h"
+#include "TurtleProgram.h"
 #include "cereal/archives/json.hpp"
 
 #include <SFML/Graphics.hpp>
@@ -32,35 +33,38 @@ class DrawingTest : public ::testing::Test
     Turtle turtle {parameters};
 };
 
-// SFML does not provide an equality operator for sf::Vertex. It is
-// defined inside the 'sf' namespace to help googletest find it.
-namespace sf
-{
-inline bool operator==(const sf::Vertex& left, const sf::Vertex& right)
-{
-    return left.position == right.position && left.color == right.color
-           && left.texCoords == right.texCoords;
-}
-} // namespace sf
-
 // Some InterpretationMap's constructors are defaulted, we assume the
 // implementation is correct.
 // The other constructors are dead-simple by calling the parent class.
 
 
+TEST_F(DrawingTest, compile_orders)
+{
+    const auto orders = compile_orders(interpretation);
+
+    ASSERT_EQ(orders.at('F'), OrderID::GO_FORWARD);
+    ASSERT_EQ(orders.at('G'), OrderID::GO_FORWARD);
+    ASSERT_EQ(orders.at('+'), OrderID::TURN_LEFT);
+    ASSERT_EQ(orders.at(']'), OrderID::LOAD_POSITION);
+    ASSERT_FALSE(orders.at('x'));
+    auto n_orders =
+        std::count_if(begin(orders), end(orders), [](const auto& o) { return o.has_value(); });
+    ASSERT_EQ(n_orders, 6);
+}
+
 // Test the go_forward order.
 TEST_F(DrawingTest, go_forward)
 {
-    sf::Vertex begin({0.f, 0.f});
+    sf::Vector2f begin {0.f, 0.f};
     float newx = Turtle::step_ * std::cos(parameters.get_starting_angle());
     float newy = Turtle::step_ * std::sin(parameters.get_starting_angle());
-    sf::Vector2f end_pos = begin.position + sf::Vector2f(newx, newy);
-    sf::Vertex end {end_pos};
+    sf::Vector2f end = begin + sf::Vector2f(newx, newy);
     std::vector<std::uint8_t> expected_iter {1, 1};
 
     go_forward_fn(turtle);
 
-    ASSERT_EQ(turtle.vertices_.at(0), end);
+    ASSERT_EQ(turtle.vertices_.positions.at(0), end);
+    ASSERT_TRUE(turtle.vertices_.branches.empty());
     // ASSERT_EQ(turtle.vertices.at(1), end);
     // CAN'T TEST ITERS WITH NEW SYSTEM
     // ASSERT_EQ(turtle.iteration_of_vertices, expected_iter);
@@ -90,18 +94,26 @@ TEST_F(DrawingTest, turn_left)
 TEST_F(DrawingTest, stack_test)
 {
     save_position_fn(turtle);
-    const auto& saved_state = turtle.stack_.top();
+    const auto& saved_state = turtle.stack_.back();
     ASSERT_EQ(saved_state.position, turtle.state_.position);
     ASSERT_EQ(saved_state.direction, turtle.state_.direction);
 
+    go_forward_fn(turtle);
     go_forward_fn(turtle);
     load_position_fn(turtle);
 
     ASSERT_EQ(saved_state.position, turtle.state_.position);
     ASSERT_EQ(saved_state.direction, turtle.state_.direction);
+    // Loading a state does not add any vertex: the next one starts a branch
+    // from the vertex of the loaded state.
+    ASSERT_EQ(turtle.vertices_.size(), 2u);
+    go_forward_fn(turtle);
+    ASSERT_EQ(turtle.vertices_.branches, std::vector<VertexArrays::Branch>({{2, 0}}));
+    ASSERT_EQ(turtle.vertices_.parent(2), 0u);
+    ASSERT_EQ(turtle.vertices_.parent(1), 0u);
 
-    // 1 at creation, 1 at go_forward, 3 at load_position_fn
-    std::vector<std::uint8_t> expected_iter {1, 1, 1, 1, 1};
+    // 1 at creation, 3 at go_forward
+    std::vector<std::uint8_t> expected_iter {1, 1, 1, 1};
     // CAN'T TEST ITERS WITH NEW SYSTEM
     // ASSERT_EQ(turtle.iteration_of_vertices, expected_iter);
 }
@@ -117,14 +129,15 @@ TEST_F(DrawingTest, compute_paths)
     turn_left_fn(turtle);
     go_forward_fn(turtle);
 
-    std::vector<sf::Vertex> norm {sf::Vertex({0, 0}),
-                                  turtle.vertices_.at(0),
-                                  turtle.vertices_.at(1)};
+    VertexArrays norm;
+    norm.push_back({0, 0});
+    norm.push_back(turtle.vertices_.positions.at(0));
+    norm.push_back(turtle.vertices_.positions.at(1));
 
     parameters.set_n_iter(1);
     auto [str, iter, _] = lsys.produce(1);
     turtle.init_from_parameters(parameters);
-    auto [vx, vx_iter, vx_tr] = turtle.compute_vertices(str, iter, interpretation);
+    auto [vx, vx_iter] = turtle.compute_vertices(str, iter, interpretation);
 
     ASSERT_EQ(vx, norm);
 
@@ -134,6 +147,288 @@ TEST_F(DrawingTest, compute_paths)
     // ASSERT_EQ(vx_iter, expected_iter);
 }
 
+// The consecutive moves and turns are folded, the turns cancelling each
+// other and the symbols without order are dropped, and the execution gives
+// the same vertices as the orders.
+TEST_F(DrawingTest, turtle_program)
+{
+    using Op = TurtleProgram::OpCode;
+    const auto orders = compile_orders(interpretation);
+    TurtleProgram program;
+    for (char c : std::string("F+-xFF++[G]G"))
+    {
+        if (const auto& order = orders[derivation::index(c)])
+        {
+            program.append(*order, c == 'G' ? 2 : 1);
+        }
+    }
+    const std::vector<TurtleProgram::Instruction> expected {{Op::FORWARD, 1, 3},
+                                                            {Op::ROTATE, 1, 2},
+                                                            {Op::SAVE, 1, 0},
+                                                            {Op::FORWARD, 2, 1},
+                                                            {Op::LOAD, 1, 0},
+                                                            {Op::FORWARD, 2, 1}};
+    ASSERT_EQ(program.instructions(), expected);
+    ASSERT_EQ(program.max_depth(), 1u);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        go_forward_fn(turtle);
+    }
+    turn_left_fn(turtle);
+    turn_left_fn(turtle);
+    save_position_fn(turtle);
+    go_forward_fn(turtle);
+    load_position_fn(turtle);
+    go_forward_fn(turtle);
+
+    Turtle program_turtle {parameters};
+    program_turtle.vertices_.push_back(sf::Vector2f(program_turtle.state_.position));
+    program.execute(program_turtle);
+    ASSERT_EQ(program_turtle.vertices_.size(), turtle.vertices_.size() + 1);
+    for (std::size_t i = 0; i < turtle.vertices_.size(); ++i)
+    {
+        const auto& position = program_turtle.vertices_.positions.at(i + 1);
+        ASSERT_NEAR(position.x, turtle.vertices_.positions.at(i).x, 1e-5);
+        ASSERT_NEAR(position.y, turtle.vertices_.positions.at(i).y, 1e-5);
+    }
+    // The vertices of 'program_turtle' are after its origin, so its branch is
+    // the one of 'turtle' from the vertex 2 to the vertex 4.
+    ASSERT_EQ(program_turtle.vertices_.branches, std::vector<VertexArrays::Branch>({{5, 3}}));
+    ASSERT_EQ(program_turtle.iterations_.decode(), std::vector<u8>({1, 1, 1, 2, 2}));
+}
+
+// A parallel execution gives the same vertices as a sequential one, and falls
+// back to it when a chunk loads a state that was never saved.
+TEST_F(DrawingTest, turtle_program_parallel)
+{
+    LSystem branching {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"};
+    const auto orders = compile_orders(interpretation);
+    for (const std::string& production : {branching.produce(6).production,
+                                          std::string("F[+F]F]F[-F+F]+F]F")})
+    {
+        TurtleProgram program;
+        for (char c : production)
+        {
+            if (const auto& order = orders[derivation::index(c)])
+            {
+                program.append(*order, c == 'F' ? 1 : 2);
+            }
+        }
+
+        Turtle sequential {parameters};
+        sequential.vertices_.push_back(sf::Vector2f(sequential.state_.position));
+        program.execute(sequential);
+        for (unsigned n_threads : {2u, 7u})
+        {
+            Turtle parallel {parameters};
+            parallel.vertices_.push_back(sf::Vector2f(parallel.state_.position));
+            program.execute(parallel, n_threads);
+
+            ASSERT_EQ(parallel.vertices_.size(), sequential.vertices_.size());
+            for (std::size_t i = 0; i < sequential.vertices_.size(); ++i)
+            {
+                const auto& position = parallel.vertices_.positions.at(i);
+                ASSERT_NEAR(position.x, sequential.vertices_.positions.at(i).x, 1e-3);
+                ASSERT_NEAR(position.y, sequential.vertices_.positions.at(i).y, 1e-3);
+            }
+            ASSERT_EQ(parallel.vertices_.branches, sequential.vertices_.branches);
+            ASSERT_EQ(parallel.iterations_, sequential.iterations_);
+            ASSERT_EQ(parallel.stack_.size(), sequential.stack_.size());
+            ASSERT_NEAR(parallel.state_.position.x, sequential.state_.position.x, 1e-3);
+            ASSERT_NEAR(parallel.state_.position.y, sequential.state_.position.y, 1e-3);
+        }
+    }
+}
+
+// The vertices rebuilt from the heading trace for other angles are the
+// vertices interpreted with these angles.
+TEST_F(DrawingTest, heading_trace)
+{
+    LSystem branching {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"};
+    const u8 n = 4;
+    auto [str, iter, _] = branching.produce(n);
+
+    turtle.track_headings_ = true;
+    auto [vx, vx_iter] = turtle.compute_vertices(str, iter, interpretation);
+    ASSERT_EQ(turtle.trace_.size(), vx.size());
+
+    Turtle streaming_turtle {parameters};
+    streaming_turtle.track_headings_ = true;
+    auto [symbols, _1] = branching.stream(n);
+    streaming_turtle.compute_vertices(std::move(symbols), interpretation);
+    ASSERT_EQ(streaming_turtle.trace_.headings(), turtle.trace_.headings());
+
+    for (auto [starting_angle, delta_angle] : {std::pair {0., degree_to_rad(25.)},
+                                               std::pair {degree_to_rad(40.), degree_to_rad(90.)}})
+    {
+        parameters.set_starting_angle(starting_angle);
+        parameters.set_delta_angle(delta_angle);
+        Turtle expected_turtle {parameters};
+        auto [expected_vx, _2] = expected_turtle.compute_vertices(str, iter, interpretation);
+
+        VertexArrays rebuilt = vx;
+        turtle.trace_.rebuild(rebuilt, starting_angle, delta_angle);
+        ASSERT_EQ(rebuilt.size(), expected_vx.size());
+        for (std::size_t i = 0; i < rebuilt.size(); ++i)
+        {
+            ASSERT_NEAR(rebuilt.positions.at(i).x, expected_vx.positions.at(i).x, 1e-3);
+            ASSERT_NEAR(rebuilt.positions.at(i).y, expected_vx.positions.at(i).y, 1e-3);
+        }
+        ASSERT_EQ(rebuilt.branches, expected_vx.branches);
+    }
+}
+
+// Merging the collinear vertices keeps the other vertices, their iterations
+// and their trace, and only removes vertices continuing a straight segment.
+TEST_F(DrawingTest, merge_collinear)
+{
+    LSystem branching {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"};
+    const u8 n = 4;
+    auto [str, iter, _] = branching.produce(n);
+
+    Turtle expected_turtle {parameters};
+    expected_turtle.track_headings_ = true;
+    auto [expected_vx, expected_iter] = expected_turtle.compute_vertices(str, iter, interpretation);
+
+    turtle.track_headings_ = true;
+    turtle.merge_collinear_ = true;
+    auto [vx, vx_iter] = turtle.compute_vertices(str, iter, interpretation);
+
+    ASSERT_LT(vx.size(), expected_vx.size());
+    ASSERT_EQ(vx.ordinals.size(), vx.size());
+    ASSERT_EQ(vx.unmerged_size(), expected_vx.size());
+    ASSERT_EQ(vx_iter.size(), vx.size());
+    ASSERT_EQ(turtle.trace_.size(), vx.size());
+    for (std::size_t i = 0; i < vx.size(); ++i)
+    {
+        const auto ordinal = vx.ordinal(i);
+        ASSERT_EQ(vx.positions.at(i), expected_vx.positions.at(ordinal));
+        ASSERT_EQ(vx_iter.at(i), expected_iter.at(ordinal));
+        ASSERT_EQ(turtle.trace_.headings().at(i), expected_turtle.trace_.headings().at(ordinal));
+        if (i == 0)
+        {
+            continue;
+        }
+        // The merged vertices between a vertex and its parent continue its
+        // segment.
+        const auto parent = vx.ordinal(vx.parent(i));
+        for (auto v = ordinal; v != parent; v = expected_vx.parent(v))
+        {
+            ASSERT_GT(v, parent);
+            ASSERT_EQ(expected_iter.at(v), vx_iter.at(i));
+            ASSERT_EQ(expected_turtle.trace_.headings().at(v),
+                      turtle.trace_.headings().at(i));
+        }
+    }
+
+    // The positions are rebuilt from the merged trace.
+    parameters.set_delta_angle(degree_to_rad(25.));
+    Turtle rotated_turtle {parameters};
+    auto [rotated_vx, _1] = rotated_turtle.compute_vertices(str, iter, interpretation);
+    VertexArrays rebuilt = vx;
+    turtle.trace_.rebuild(rebuilt, 0, degree_to_rad(25.));
+    for (std::size_t i = 0; i < rebuilt.size(); ++i)
+    {
+        ASSERT_NEAR(rebuilt.positions.at(i).x, rotated_vx.positions.at(vx.ordinal(i)).x, 1e-3);
+        ASSERT_NEAR(rebuilt.positions.at(i).y, rotated_vx.positions.at(vx.ordinal(i)).y, 1e-3);
+    }
+}
+
+// Assembling the interpretation from memoized blocks gives the same result
+// as interpreting the production, with or without blocks, and with brackets
+// loading states saved outside of a block.
+TEST_F(DrawingTest, compute_vertices_instanced)
+{
+    const u8 n = 5;
+    for (LSystem system : {LSystem {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"},
+                           LSystem {"[[[X", {{'X', "F]+X[F[-X"}, {'F', "F-G"}}, "XF"}})
+    {
+        auto [str, iter, _] = system.produce(n);
+        Turtle expected_turtle {parameters};
+        expected_turtle.track_headings_ = true;
+        auto [expected_vx, expected_iter] =
+            expected_turtle.compute_vertices(str, iter, interpretation);
+        const auto& expected_headings = expected_turtle.trace_.headings();
+
+        for (std::size_t budget : {std::size_t {0}, Turtle::default_block_budget})
+        {
+            Turtle instanced {parameters};
+            instanced.track_headings_ = true;
+            auto expansion = system.expansion(n);
+            auto [vx, vx_iter] = instanced.compute_vertices(
+                expansion.table, expansion.axiom, n, interpretation, 0, budget);
+
+            ASSERT_EQ(vx.size(), expected_vx.size());
+            for (std::size_t i = 0; i < vx.size(); ++i)
+            {
+                ASSERT_NEAR(vx.positions.at(i).x, expected_vx.positions.at(i).x, 1e-3);
+                ASSERT_NEAR(vx.positions.at(i).y, expected_vx.positions.at(i).y, 1e-3);
+            }
+            ASSERT_EQ(vx.branches, expected_vx.branches);
+            ASSERT_EQ(vx_iter, expected_iter);
+            ASSERT_EQ(instanced.trace_.headings(), expected_headings);
+        }
+    }
+}
+
+// Interpreting a stream of symbols gives the same result as interpreting the
+// materialized production.
+TEST_F(DrawingTest, compute_vertices_stream)
+{
+    LSystem branching {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"};
+    const u8 n = 4;
+
+    Turtle streaming_turtle {parameters};
+    auto [symbols, _1] = branching.stream(n);
+    auto [vx, vx_iter] = streaming_turtle.compute_vertices(std::move(symbols), interpretation);
+
+    auto [str, iter, _2] = branching.produce(n);
+    auto [expected_vx, expected_iter] = turtle.compute_vertices(str, iter, interpretation);
+
+    ASSERT_EQ(vx, expected_vx);
+    ASSERT_EQ(vx_iter, expected_iter);
+}
+
+// Without tracking the iteration depths, the same vertices are computed.
+TEST_F(DrawingTest, compute_vertices_without_iterations)
+{
+    LSystem branching {"X", {{'X', "F[+X]F[-X]+X"}, {'F', "FF"}}, "X"};
+    const u8 n = 4;
+
+    Turtle untracked_turtle {parameters};
+    untracked_turtle.track_iterations_ = false;
+    auto [str, iter, _] = branching.produce(n, false);
+    auto [vx, vx_iter] = untracked_turtle.compute_vertices(str, iter, interpretation);
+
+    auto [expected_str, expected_iter, _2] = branching.produce(n);
+    auto [expected_vx, expected_vx_iter] =
+        turtle.compute_vertices(expected_str, expected_iter, interpretation);
+
+    ASSERT_EQ(vx, expected_vx);
+    ASSERT_TRUE(vx_iter.empty());
+}
+
+// The first parameter of a module overrides the step or the angle of its
+// order, and a module without parameter uses the DrawingParameters.
+TEST_F(DrawingTest, compute_vertices_parametric)
+{
+    const auto production = parametric::parse_production("F(2)+(45)F[-F(0.5)]");
+    ASSERT_TRUE(production);
+    auto [vx, vx_iter] = turtle.compute_vertices(*production, interpretation);
+
+    // 1 at creation, 3 at go_forward
+    ASSERT_EQ(vx.size(), 4u);
+    ASSERT_EQ(vx_iter.size(), 4u);
+    ASSERT_NEAR(vx.positions.at(1).x, 2, 1e-5);
+    ASSERT_NEAR(vx.positions.at(1).y, 0, 1e-5);
+    ASSERT_NEAR(vx.positions.at(2).x, 2 + std::sqrt(0.5), 1e-5);
+    ASSERT_NEAR(vx.positions.at(2).y, -std::sqrt(0.5), 1e-5);
+    // The turn without parameter is of 90 degrees.
+    ASSERT_NEAR(vx.positions.at(3).x, 2 + std::sqrt(0.5) + 0.5 * std::sqrt(0.5), 1e-5);
+    ASSERT_NEAR(vx.positions.at(3).y, -std::sqrt(0.5) + 0.5 * std::sqrt(0.5), 1e-5);
+}
+
 namespace drawing
 {
 bool operator==(const Order& o1, const Order& o2)
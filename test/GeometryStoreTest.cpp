@@ -0,0 +1,33 @@
+#include "GeometryStore.h"
+
+#include <gtest/gtest.h>
+
+using namespace drawing;
+
+TEST(GeometryStoreTest, find)
+{
+    GeometryStore store;
+    auto geometry = std::make_shared<const Geometry>();
+
+    ASSERT_FALSE(store.find("key"));
+
+    store.insert("key", geometry);
+    ASSERT_EQ(store.find("key"), geometry);
+    ASSERT_FALSE(store.find("other key"));
+}
+
+// The store does not own its entries.
+TEST(GeometryStoreTest, weak_references)
+{
+    GeometryStore store;
+    auto geometry = std::make_shared<const Geometry>();
+    store.insert("key", geometry);
+
+    geometry.reset();
+    ASSERT_FALSE(store.find("key"));
+
+    // Freed entries are removed at the next insertion.
+    auto other_geometry = std::make_shared<const Geometry>();
+    store.insert("other key", other_geometry);
+    ASSERT_EQ(store.size(), 1u);
+}
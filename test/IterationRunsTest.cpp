@@ -0,0 +1,43 @@
+#include "IterationRuns.h"
+
+#include <gsl/gsl>
+#include <gtest/gtest.h>
+
+TEST(IterationRunsTest, encode)
+{
+    const std::vector<u8> iterations {2, 2, 2, 1, 1, 3, 2, 2};
+    const IterationRuns runs(iterations);
+
+    const std::vector<IterationRuns::Run> expected_runs {{2, 3}, {1, 5}, {3, 6}, {2, 8}};
+    ASSERT_EQ(runs.runs(), expected_runs);
+    ASSERT_EQ(runs.size(), iterations.size());
+    ASSERT_EQ(runs.decode(), iterations);
+    for (std::size_t i = 0; i < iterations.size(); ++i)
+    {
+        ASSERT_EQ(runs.at(i), iterations.at(i));
+    }
+    ASSERT_EQ(runs.run_of(4), 1u);
+    ASSERT_THROW(runs.at(iterations.size()), gsl::fail_fast);
+
+    ASSERT_TRUE(IterationRuns().empty());
+    ASSERT_TRUE(IterationRuns(0, 1).empty());
+}
+
+// The runs are merged when appending the same iteration count.
+TEST(IterationRunsTest, append)
+{
+    IterationRuns runs(3, 1);
+    runs.push_back(1, 2);
+    runs.push_back(2, 0);
+    ASSERT_EQ(runs.runs().size(), 1u);
+    ASSERT_EQ(runs.size(), 5u);
+
+    const IterationRuns other({0, 0, 1});
+    runs.append(other, 1);
+    ASSERT_EQ(runs, IterationRuns({1, 1, 1, 1, 1, 1, 1, 2}));
+    ASSERT_EQ(runs.runs().size(), 2u);
+    ASSERT_EQ(runs.bytes(), 2 * sizeof(IterationRuns::Run));
+
+    runs.clear();
+    ASSERT_EQ(runs.size(), 0u);
+}
@@ -8,8 +8,7 @@
 
 using Rules = LSystem::Rules;
 using ProductionCache = std::unordered_map<std::uint8_t, std::string>;
-using IterationCache =
-    std::unordered_map<std::uint8_t, std::pair<std::vector<std::uint8_t>, std::uint8_t>>;
+using IterationCache = LSystem::IterationCache;
 
 // Check if all the members are initialized. Not so useful by itself, except if
 // one of the members suddenly does not have a default initialization.
@@ -33,7 +32,7 @@ TEST(LSystemTest, complete_ctor)
 {
     LSystem lsys {"F", {{'F', "F+F"}}, "F"};
     LSystem::Rules expected_rules = {{'F', "F+F"}};
-    IterationCache expected_iteration_cache = {{0, {{0}, 0}}};
+    IterationCache expected_iteration_cache = {{0, {IterationRuns(1, 0), 0}}};
 
     ASSERT_EQ(lsys.get_axiom(), "F");
     ASSERT_EQ(lsys.get_rules(), expected_rules);
@@ -54,7 +53,7 @@ TEST(LSystemTest, set_axiom)
 {
     LSystem lsys("F", Rules({{'F', "F+F"}}), "F");
     ProductionCache axiom_prod_cache {{0, "FF"}};
-    IterationCache axiom_iter_cache {{0, {{0, 0}, 0}}};
+    IterationCache axiom_iter_cache {{0, {IterationRuns(2, 0), 0}}};
 
     lsys.set_axiom("FF");
 
@@ -70,7 +69,7 @@ TEST(LSystemTest, add_rule)
     LSystem lsys("F", Rules({}), "F");
     LSystem::Rules expected_rules = {{'F', "F+F"}};
     ProductionCache base_prod_cache {{0, "F"}};
-    IterationCache base_iter_cache {{0, {{0}, 0}}};
+    IterationCache base_iter_cache {{0, {IterationRuns(1, 0), 0}}};
     lsys.add_rule('F', "F+F");
 
     ASSERT_EQ(lsys.get_rules(), expected_rules);
@@ -84,7 +83,7 @@ TEST(LSystemTest, remove_rule)
     LSystem lsys("F", Rules({{'F', "F+F"}}), "F");
     LSystem::Rules empty_rules;
     ProductionCache base_prod_cache {{0, "F"}};
-    IterationCache base_iter_cache {{0, {{0}, 0}}};
+    IterationCache base_iter_cache {{0, {IterationRuns(1, 0), 0}}};
 
     lsys.remove_rule('F');
 
@@ -117,7 +116,7 @@ TEST(LSystemTest, replace_rules)
     LSystem::Rules new_rules {{'H', "HH"}, {'I', "II"}};
     ;
     ProductionCache base_prod_cache {{0, "F"}};
-    IterationCache base_iter_cache {{0, {{0}, 0}}};
+    IterationCache base_iter_cache {{0, {IterationRuns(1, 0), 0}}};
 
     lsys.replace_rules(new_rules);
 
@@ -128,11 +127,36 @@ TEST(LSystemTest, replace_rules)
     ASSERT_TRUE(lsys.poll_modification());
 }
 
+// Only the iterations derived from an edited rule are invalidated.
+TEST(LSystemTest, rule_edit_invalidation)
+{
+    // 'G' first appears at iteration 2, 'H' never appears.
+    LSystem lsys("F", Rules({{'F', "FX"}, {'X', "G"}, {'G', "GG"}, {'H', "HH"}}), "F");
+    lsys.produce(5);
+
+    lsys.add_rule('H', "H");
+    ASSERT_EQ(lsys.get_production_cache().size(), 6u);
+
+    lsys.replace_rules({{'F', "FX"}, {'X', "G"}, {'G', "G+G"}, {'H', "H"}});
+    ASSERT_EQ(lsys.get_production_cache().size(), 3u);
+    ASSERT_EQ(lsys.get_iteration_cache().size(), 3u);
+
+    LSystem reference("F", Rules({{'F', "FX"}, {'X', "G"}, {'G', "G+G"}}), "F");
+    auto [prod, rec, max] = lsys.produce(5);
+    auto [expected_prod, expected_rec, expected_max] = reference.produce(5);
+    ASSERT_EQ(prod, expected_prod);
+    ASSERT_EQ(rec, expected_rec);
+    ASSERT_EQ(max, expected_max);
+
+    lsys.remove_rule('F');
+    ASSERT_EQ(lsys.get_production_cache().size(), 1u);
+}
+
 TEST(LSystemTest, set_iteration_predecessors)
 {
     LSystem lsys("F", Rules({{'F', "F+F"}, {'G', "GG"}}), "F");
     std::string expected_predecessors = "";
-    IterationCache expected_cache = {{0, {{0}, 0}}};
+    IterationCache expected_cache = {{0, {IterationRuns(1, 0), 0}}};
 
 
     lsys.set_iteration_predecessors("");
@@ -159,10 +183,10 @@ TEST(LSystemTest, derivation)
     auto [prod3, rec3, max3] = lsys.produce(3);
 
     ASSERT_EQ(prod1, prod_iter_1);
-    ASSERT_EQ(rec1, rec_iter_1);
+    ASSERT_EQ(rec1.decode(), rec_iter_1);
     ASSERT_EQ(max1, 1);
     ASSERT_EQ(prod3, prod_iter_3);
-    ASSERT_EQ(rec3, rec_iter_3);
+    ASSERT_EQ(rec3.decode(), rec_iter_3);
     ASSERT_EQ(max3, 3);
 }
 
@@ -184,13 +208,13 @@ TEST(LSystemTest, wild_derivation)
     auto [prod5, rec5, max5] = lsys.produce(5);
 
     ASSERT_EQ(prod1, prod_iter_1);
-    ASSERT_EQ(rec1, rec_iter_1);
+    ASSERT_EQ(rec1.decode(), rec_iter_1);
     ASSERT_EQ(max1, 1);
     ASSERT_EQ(prod3, prod_iter_3);
-    ASSERT_EQ(rec3, rec_iter_3);
+    ASSERT_EQ(rec3.decode(), rec_iter_3);
     ASSERT_EQ(max3, 3);
     ASSERT_EQ(prod5, prod_iter_5);
-    ASSERT_EQ(rec5, rec_iter_5);
+    ASSERT_EQ(rec5.decode(), rec_iter_5);
     ASSERT_EQ(max5, 5);
 }
 
@@ -206,7 +230,7 @@ TEST(LSystemTest, corner_iteration)
 
     auto [prod3, rec3, max3] = lsys.produce(3);
 
-    ASSERT_EQ(rec_iter_3, rec3);
+    ASSERT_EQ(rec_iter_3, rec3.decode());
     ASSERT_EQ(3, max3);
 }
 
@@ -219,12 +243,381 @@ TEST(LSystemTest, disjoint_derivation)
     lsys.produce(1);
 
     ProductionCache production_cache {{0, "F"}, {1, "F+G"}, {2, "F+G+G-F"}};
-    IterationCache iteration_cache {{0, {{0}, 0}}, {1, {{0, 0, 0}, 0}}};
+    IterationCache iteration_cache {{0, {IterationRuns(1, 0), 0}},
+                                    {1, {IterationRuns(3, 0), 0}}};
 
     ASSERT_EQ(lsys.get_production_cache(), production_cache);
     ASSERT_EQ(lsys.get_iteration_cache(), iteration_cache);
 }
 
+// A big production of a fresh system is expanded directly from the axiom,
+// without caching the intermediate iterations.
+TEST(LSystemTest, direct_expansion)
+{
+    LSystem lsys {"F", {{'F', "FF"}}, "F"};
+    const u8 n = 22;
+    ASSERT_GE(1u << n, derivation::direct_expansion_threshold);
+
+    auto [prod, rec, max] = lsys.produce(n);
+
+    ASSERT_EQ(prod, std::string(1u << n, 'F'));
+    ASSERT_EQ(rec, IterationRuns(1u << n, n));
+    ASSERT_EQ(rec.runs().size(), 1u);
+    ASSERT_EQ(max, n);
+    ASSERT_EQ(lsys.get_production_cache().size(), 2u);
+    ASSERT_EQ(lsys.get_iteration_cache().size(), 2u);
+
+    // Lower iterations are derived from the axiom.
+    auto [prod3, rec3, max3] = lsys.produce(3);
+    ASSERT_EQ(prod3, "FFFFFFFF");
+    ASSERT_EQ(max3, 3);
+}
+
+// The stream yields the same symbols as 'produce()' without caching them.
+TEST(LSystemTest, stream)
+{
+    LSystem lsys {"F", {{'F', "F+G"}, {'G', "G-F"}}, "F"};
+    const u8 n = 6;
+
+    // Stream from the axiom, then from a cached iteration.
+    for (u8 cached : {0, 3})
+    {
+        lsys.produce(cached);
+        const auto production_cache_size = lsys.get_production_cache().size();
+
+        auto [symbols, max] = lsys.stream(n);
+        std::string prod;
+        IterationRuns rec;
+        char symbol;
+        u8 iteration;
+        while (symbols.next(symbol, iteration))
+        {
+            prod.push_back(symbol);
+            rec.push_back(iteration);
+        }
+        ASSERT_EQ(lsys.get_production_cache().size(), production_cache_size);
+
+        LSystem reference = lsys;
+        auto [expected_prod, expected_rec, expected_max] = reference.produce(n);
+        ASSERT_EQ(prod, expected_prod);
+        ASSERT_EQ(rec, expected_rec);
+        ASSERT_EQ(max, expected_max);
+    }
+}
+
+// Without the iteration counts, the same productions are derived but no
+// iteration count is computed nor cached.
+TEST(LSystemTest, produce_without_iterations)
+{
+    LSystem lsys {"F", {{'F', "F+G"}, {'G', "G-F"}}, "F"};
+    LSystem reference = lsys;
+
+    auto [prod, rec, max] = lsys.produce(5, false);
+    auto [expected_prod, expected_rec, expected_max] = reference.produce(5);
+    ASSERT_EQ(prod, expected_prod);
+    ASSERT_TRUE(rec.empty());
+    ASSERT_EQ(max, expected_max);
+    ASSERT_EQ(lsys.get_production_cache().size(), 6u);
+    ASSERT_EQ(lsys.get_iteration_cache().size(), 1u);
+
+    // The iteration counts are computed on demand from the cached productions.
+    auto [prod6, rec6, max6] = lsys.produce(6);
+    auto [expected_prod6, expected_rec6, expected_max6] = reference.produce(6);
+    ASSERT_EQ(prod6, expected_prod6);
+    ASSERT_EQ(rec6, expected_rec6);
+    ASSERT_EQ(max6, expected_max6);
+
+    // The stream starts from the highest cached production.
+    auto [symbols, stream_max] = lsys.stream(7, false);
+    std::string streamed;
+    char symbol;
+    u8 iteration;
+    while (symbols.next(symbol, iteration))
+    {
+        streamed.push_back(symbol);
+    }
+    ASSERT_EQ(streamed, reference.produce(7).production);
+    ASSERT_EQ(stream_max, reference.produce(7).max_iteration);
+}
+
+TEST(LSystemTest, cache_budget)
+{
+    LSystem lsys {"F", {{'F', "F+G"}, {'G', "G-F"}}, "F"};
+    LSystem reference = lsys;
+    lsys.set_cache_budget(0);
+    ASSERT_EQ(lsys.get_cache_budget(), 0u);
+
+    // Only the axiom, the produced and the previous iterations are kept.
+    lsys.produce(6);
+    ASSERT_EQ(lsys.get_production_cache().size(), 3u);
+    ASSERT_EQ(lsys.get_production_cache().count(0), 1u);
+    ASSERT_EQ(lsys.get_production_cache().count(5), 1u);
+    ASSERT_EQ(lsys.get_production_cache().count(6), 1u);
+    ASSERT_EQ(lsys.get_iteration_cache().size(), 3u);
+
+    // Evicted iterations are derived again.
+    for (u8 n : {3, 7, 2})
+    {
+        auto [prod, rec, max] = lsys.produce(n);
+        auto [expected_prod, expected_rec, expected_max] = reference.produce(n);
+        ASSERT_EQ(prod, expected_prod);
+        ASSERT_EQ(rec, expected_rec);
+        ASSERT_EQ(max, expected_max);
+    }
+    ASSERT_EQ(lsys.get_production_cache().size(), 3u);
+
+    // An unlimited budget keeps everything. The iteration counts are
+    // accounted by the size of their runs.
+    ASSERT_EQ(reference.get_production_cache().size(), 8u);
+    std::size_t expected_size = 0;
+    for (const auto& [i, production] : reference.get_production_cache())
+    {
+        expected_size += production.size() + reference.get_iteration_cache().at(i).first.bytes();
+    }
+    ASSERT_EQ(expected_size, (1 + 3 + 7 + 15 + 31 + 63 + 127 + 255) + sizeof(IterationRuns::Run) * 154);
+    ASSERT_EQ(reference.cache_size(), expected_size);
+}
+
+TEST(LSystemTest, packed_cache)
+{
+    LSystem lsys {"F", {{'F', "F+G"}, {'G', "G-F"}}, "F"};
+    LSystem reference = lsys;
+    lsys.set_cache_budget(810);
+
+    // The least recently used iterations are packed instead of evicted, with
+    // their iteration counts.
+    lsys.produce(6);
+    ASSERT_LE(lsys.cache_size(), 810u);
+    ASSERT_FALSE(lsys.get_packed_cache().empty());
+    ASSERT_EQ(lsys.get_production_cache().size() + lsys.get_packed_cache().size(), 7u);
+    for (const auto& [i, packed] : lsys.get_packed_cache())
+    {
+        ASSERT_EQ(lsys.get_production_cache().count(i), 0u);
+        ASSERT_EQ(lsys.get_iteration_cache().at(i).first, reference.produce(i).iteration);
+        ASSERT_EQ(packed.unpack(), reference.produce(i).production);
+    }
+
+    // Packed iterations are unpacked when needed.
+    for (u8 n : {2, 4, 7})
+    {
+        auto [prod, rec, max] = lsys.produce(n);
+        auto [expected_prod, expected_rec, expected_max] = reference.produce(n);
+        ASSERT_EQ(prod, expected_prod);
+        ASSERT_EQ(rec, expected_rec);
+        ASSERT_EQ(max, expected_max);
+        ASSERT_EQ(lsys.get_packed_cache().count(n), 0u);
+    }
+
+    // Editing a rule invalidates the packed iterations too.
+    lsys.add_rule('G', "G");
+    ASSERT_TRUE(lsys.get_packed_cache().empty());
+}
+
+// The big cold iterations are packed even within the budget, and the
+// derivations and the streams start from the highest cached iteration, packed
+// or not.
+TEST(LSystemTest, packed_base)
+{
+    LSystem lsys {"F", {{'F', "F+G"}, {'G', "G-F"}}, "F"};
+    LSystem reference = lsys;
+    lsys.set_packing_threshold(0);
+
+    // Only the axiom, the produced iteration and the most recently used one
+    // are not packed.
+    lsys.produce(6);
+    ASSERT_EQ(lsys.get_production_cache().size(), 3u);
+    ASSERT_EQ(lsys.get_packed_cache().size(), 4u);
+
+    // After these uses, the iteration 6 is the highest one and is packed.
+    lsys.produce(2);
+    lsys.produce(4);
+    ASSERT_EQ(lsys.get_packed_cache().count(5), 1u);
+    ASSERT_EQ(lsys.get_packed_cache().count(6), 1u);
+
+    // The stream decodes the packed iteration.
+    for (u8 n : {6, 8})
+    {
+        auto [symbols, max] = lsys.stream(n);
+        auto [expected_prod, expected_rec, expected_max] = reference.produce(n);
+        std::string production;
+        IterationRuns iteration;
+        char symbol;
+        u8 count;
+        while (symbols.next(symbol, count))
+        {
+            production.push_back(symbol);
+            iteration.push_back(count);
+        }
+        ASSERT_EQ(production, expected_prod);
+        ASSERT_EQ(iteration, expected_rec);
+        ASSERT_EQ(max, expected_max);
+    }
+    ASSERT_EQ(lsys.get_packed_cache().count(6), 1u);
+
+    // The iteration 7 is derived from the iteration 6: the iteration 5 is
+    // still packed.
+    auto [prod, rec, max] = lsys.produce(7);
+    auto [expected_prod, expected_rec, expected_max] = reference.produce(7);
+    ASSERT_EQ(prod, expected_prod);
+    ASSERT_EQ(rec, expected_rec);
+    ASSERT_EQ(max, expected_max);
+    ASSERT_EQ(lsys.get_packed_cache().count(5), 1u);
+}
+
+// An edited symbol first derived above the unpacked iterations invalidates
+// the packed iterations above it.
+TEST(LSystemTest, packed_cache_invalidation)
+{
+    LSystem lsys {
+        "A", {{'A', "AB"}, {'B', "C"}, {'C', "D"}, {'D', "E"}, {'E', "X"}, {'X', "XX"}}, "A"};
+    lsys.set_packing_threshold(0);
+    lsys.produce(8);
+    lsys.produce(2);
+    lsys.produce(1);
+    ASSERT_EQ(lsys.get_packed_cache().count(8), 1u);
+
+    lsys.add_rule('X', "Y");
+    LSystem reference {
+        "A", {{'A', "AB"}, {'B', "C"}, {'C', "D"}, {'D', "E"}, {'E', "X"}, {'X', "Y"}}, "A"};
+    for (const auto& [i, _] : lsys.get_packed_cache())
+    {
+        ASSERT_LE(i, 5);
+    }
+    auto [prod, rec, max] = lsys.produce(8);
+    auto [expected_prod, expected_rec, expected_max] = reference.produce(8);
+    ASSERT_EQ(prod, expected_prod);
+    ASSERT_EQ(rec, expected_rec);
+    ASSERT_EQ(max, expected_max);
+}
+
+TEST(LSystemTest, production_dag)
+{
+    LSystem lsys {"F", {{'F', "F[+G]"}, {'G', "G-F"}}, "F"};
+    const u8 n = 7;
+
+    auto dag = lsys.production_dag(n);
+    ASSERT_TRUE(dag);
+    ASSERT_EQ(lsys.get_production_cache().size(), 1u);
+
+    auto [prod, rec, max] = lsys.produce(n);
+    ASSERT_EQ(dag->size(), prod.size());
+    for (std::size_t i = 0; i < prod.size(); i += 7)
+    {
+        ASSERT_EQ(dag->symbol_at(i), std::make_pair(prod.at(i), rec.at(i)));
+    }
+
+    ASSERT_FALSE(LSystem().production_dag(n));
+}
+
+TEST(LSystemTest, stochastic_rules)
+{
+    LSystem lsys {"F", {{'F', "F+F"}, {'G', "G"}}, "F"};
+    ASSERT_FALSE(lsys.is_stochastic());
+    ASSERT_THROW(lsys.add_stochastic_successor('x', "x", 1), gsl::fail_fast);
+    ASSERT_THROW(lsys.add_stochastic_successor('F', "F", 0), gsl::fail_fast);
+
+    lsys.add_stochastic_successor('F', "F-GG", 1);
+    ASSERT_TRUE(lsys.is_stochastic());
+    LSystem copy = lsys;
+
+    // The productions are reproducible, and only depend on the seed.
+    const std::string production = lsys.produce(6).production;
+    ASSERT_EQ(copy.produce(6).production, production);
+    ASSERT_NE(production.find('-'), std::string::npos);
+    ASSERT_NE(production.find('+'), std::string::npos);
+    copy.set_seed(7);
+    ASSERT_EQ(copy.get_production_cache().size(), 1u);
+    ASSERT_NE(copy.produce(6).production, production);
+
+    // The last iteration is streamed from the previous one.
+    auto [symbols, max_iteration] = lsys.stream(6);
+    std::string streamed;
+    char symbol;
+    u8 iteration;
+    while (symbols.next(symbol, iteration))
+    {
+        streamed.push_back(symbol);
+    }
+    ASSERT_EQ(streamed, production);
+    ASSERT_EQ(max_iteration, lsys.produce(6).max_iteration);
+    ASSERT_FALSE(lsys.production_dag(6));
+
+    // Removing the rule removes its other successors.
+    lsys.remove_rule('F');
+    ASSERT_FALSE(lsys.is_stochastic());
+}
+
+TEST(LSystemTest, context_rules)
+{
+    LSystem lsys {"ba[a]a", {{'a', "a"}, {'b', "a"}}, ""};
+    ASSERT_FALSE(lsys.is_context_sensitive());
+    ASSERT_TRUE(lsys.is_expandable());
+    ASSERT_THROW(lsys.add_context_rule('x', "b", "b", ""), gsl::fail_fast);
+    ASSERT_THROW(lsys.add_context_rule('a', "bb", "b", ""), gsl::fail_fast);
+
+    lsys.produce(2);
+    lsys.add_context_rule('a', "b", "b", "");
+    ASSERT_TRUE(lsys.is_context_sensitive());
+    ASSERT_FALSE(lsys.is_expandable());
+    ASSERT_EQ(lsys.get_production_cache().size(), 1u);
+    ASSERT_EQ(lsys.produce(1).production, "ab[a]a");
+    ASSERT_EQ(lsys.produce(2).production, "aa[b]b");
+
+    // The ignored symbols are skipped when looking for a context.
+    lsys.set_axiom("b+a");
+    ASSERT_EQ(lsys.produce(1).production, "a+a");
+    lsys.set_context_ignored("+");
+    ASSERT_EQ(lsys.produce(1).production, "a+b");
+
+    // The last iteration is streamed from the previous one.
+    auto [symbols, max_iteration] = lsys.stream(1);
+    std::string streamed;
+    char symbol;
+    u8 iteration;
+    while (symbols.next(symbol, iteration))
+    {
+        streamed.push_back(symbol);
+    }
+    ASSERT_EQ(streamed, "a+b");
+    ASSERT_FALSE(lsys.production_dag(1));
+
+    // Removing the rule removes its context-sensitive rules.
+    lsys.remove_rule('a');
+    ASSERT_FALSE(lsys.is_context_sensitive());
+}
+
+TEST(LSystemTest, parametric_rules)
+{
+    LSystem lsys {"F(4)G", {{'G', "GF"}}, "F"};
+    ASSERT_FALSE(lsys.is_parametric());
+    ASSERT_THROW(lsys.produce_parametric(1), gsl::fail_fast);
+    ASSERT_THROW(lsys.add_parametric_rule({"F(l, l)", "", "F"}), gsl::fail_fast);
+
+    // The rules without parameters are applied to the modules without
+    // parameters.
+    lsys.add_parametric_rule({"F(l)", "l > 1", "F(l / 2)[+F(l / 2)]"});
+    ASSERT_TRUE(lsys.is_parametric());
+    const auto expected = parametric::parse_production("F(1)[+F(1)][+F(1)[+F(1)]]GFF");
+    const auto& production = lsys.produce_parametric(2);
+    ASSERT_EQ(production.symbols, expected->symbols);
+    ASSERT_EQ(production.offsets, expected->offsets);
+    ASSERT_EQ(production.parameters, expected->parameters);
+    ASSERT_EQ(production.max_iteration, 2);
+    ASSERT_EQ(&lsys.produce_parametric(2), &production);
+    ASSERT_EQ(lsys.produce_parametric(3).symbols, "F[+F][+F[+F]]GFFF");
+
+    // Editing the LSystem invalidates the parametric productions.
+    lsys.add_rule('G', "G");
+    ASSERT_EQ(lsys.produce_parametric(2).symbols, "F[+F][+F[+F]]G");
+    lsys.set_axiom("F(2)");
+    ASSERT_EQ(lsys.produce_parametric(2).symbols, "F[+F]");
+    lsys.set_axiom("F(");
+    ASSERT_TRUE(lsys.produce_parametric(2).symbols.empty());
+
+    lsys.clear_parametric_rules();
+    ASSERT_FALSE(lsys.is_parametric());
+}
+
 TEST(LSystemTest, serialization)
 {
     LSystem olsys("FG", {{'F', "F+G"}, {'G', "G-F"}}, "F");
@@ -244,3 +637,76 @@ TEST(LSystemTest, serialization)
     ASSERT_EQ(olsys.get_rules(), ilsys.get_rules());
     ASSERT_EQ(olsys.get_iteration_predecessors(), ilsys.get_iteration_predecessors());
 }
+
+TEST(LSystemTest, stochastic_serialization)
+{
+    LSystem olsys("FG", {{'F', "F+G"}, {'G', "G-F"}}, "F");
+    olsys.add_stochastic_successor('G', "GG", 0.5);
+    olsys.set_seed(1234);
+    LSystem ilsys;
+
+    std::stringstream ss;
+    {
+        cereal::JSONOutputArchive oarchive(ss);
+        oarchive(olsys);
+    }
+    {
+        cereal::JSONInputArchive iarchive(ss);
+        iarchive(ilsys);
+    }
+
+    ASSERT_EQ(ilsys.get_seed(), 1234u);
+    ASSERT_EQ(ilsys.get_stochastic_rules().size(), 1u);
+    ASSERT_EQ(ilsys.get_stochastic_rules().at('G').at(0).successor, "GG");
+    ASSERT_EQ(ilsys.get_stochastic_rules().at('G').at(0).weight, 0.5);
+    ASSERT_EQ(ilsys.produce(5).production, olsys.produce(5).production);
+}
+
+TEST(LSystemTest, context_serialization)
+{
+    LSystem olsys("ba[a]a", {{'a', "a"}, {'b', "a"}}, "");
+    olsys.add_context_rule('a', "b", "b", "");
+    olsys.set_context_ignored("+-");
+    LSystem ilsys;
+
+    std::stringstream ss;
+    {
+        cereal::JSONOutputArchive oarchive(ss);
+        oarchive(olsys);
+    }
+    {
+        cereal::JSONInputArchive iarchive(ss);
+        iarchive(ilsys);
+    }
+
+    ASSERT_EQ(ilsys.get_context_ignored(), "+-");
+    ASSERT_EQ(ilsys.get_context_rules().size(), 1u);
+    ASSERT_EQ(ilsys.get_context_rules().at('a').at(0).left, "b");
+    ASSERT_EQ(ilsys.get_context_rules().at('a').at(0).successor, "b");
+    ASSERT_EQ(ilsys.get_context_rules().at('a').at(0).right, "");
+    ASSERT_EQ(ilsys.produce(3).production, olsys.produce(3).production);
+}
+
+TEST(LSystemTest, parametric_serialization)
+{
+    LSystem olsys("F(4)", {{'G', "GF"}}, "F");
+    olsys.add_parametric_rule({"F(l)", "l > 1", "F(l / 2)[+G]"});
+    LSystem ilsys;
+
+    std::stringstream ss;
+    {
+        cereal::JSONOutputArchive oarchive(ss);
+        oarchive(olsys);
+    }
+    {
+        cereal::JSONInputArchive iarchive(ss);
+        iarchive(ilsys);
+    }
+
+    ASSERT_EQ(ilsys.get_parametric_rules().size(), 1u);
+    ASSERT_EQ(ilsys.get_parametric_rules().at(0).predecessor, "F(l)");
+    ASSERT_EQ(ilsys.get_parametric_rules().at(0).condition, "l > 1");
+    ASSERT_EQ(ilsys.get_parametric_rules().at(0).successor, "F(l / 2)[+G]");
+    ASSERT_EQ(ilsys.produce_parametric(3).symbols, olsys.produce_parametric(3).symbols);
+    ASSERT_EQ(ilsys.produce_parametric(3).parameters, olsys.produce_parametric(3).parameters);
+}
@@ -1,6 +1,10 @@
 #include "LSystemView.h"
 
+#include "Turtle.h"
+#include "VertexPainterComposite.h"
+#include "VertexPainterConstant.h"
 #include "VertexPainterLinear.h"
+#include "VertexPainterRandom.h"
 #include "cereal/archives/json.hpp"
 
 #include <gtest/gtest.h>
@@ -90,3 +94,159 @@ TEST(LSystemView, assign_move_ctor)
     ASSERT_EQ(move_view.get_color(), color);
     ASSERT_FALSE(move_view.is_selected());
 }
+
+// The viewed iteration of a stochastic system is interpreted while it is
+// derived: only the previous iteration is cached.
+TEST(LSystemView, fused_last_iteration)
+{
+    parameters_example params;
+    params.lsys.add_stochastic_successor('X', "F[-X]", 1);
+    LSystemView view(params.name, params.lsys, params.map, params.params, params.painter);
+    view.set_headless(true);
+    view.finish_loading();
+
+    const auto& cache = view.get_lsystem_buffer().get_rule_map().get_production_cache();
+    ASSERT_EQ(cache.count(2), 1u);
+    ASSERT_EQ(cache.count(3), 0u);
+}
+
+// The axiom of a deterministic system is expanded and interpreted without
+// deriving any iteration, and gives the vertices of its production.
+TEST(LSystemView, instanced_interpretation)
+{
+    parameters_example params;
+    params.painter = VertexPainterWrapper(std::make_shared<VertexPainterConstant>());
+    LSystemView view(params.name, params.lsys, params.map, params.params, params.painter);
+    view.set_headless(true);
+    view.finish_loading();
+
+    ASSERT_EQ(view.get_lsystem_buffer().get_rule_map().get_production_cache().size(), 1u);
+
+    Turtle turtle {params.params};
+    auto [str, iter, _] = params.lsys.produce(params.params.get_n_iter());
+    const auto& expected = turtle.compute_vertices(str, iter, params.map).vertices;
+
+    // The collinear vertices of the view are merged: its painter allows it.
+    const auto& vertices = view.get_vertices();
+    ASSERT_LT(vertices.size(), expected.size());
+    ASSERT_EQ(vertices.unmerged_size(), expected.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        const auto& position = vertices.positions.at(i);
+        ASSERT_NEAR(position.x, expected.positions.at(vertices.ordinal(i)).x, 1e-3);
+        ASSERT_NEAR(position.y, expected.positions.at(vertices.ordinal(i)).y, 1e-3);
+    }
+}
+
+// Views with the same drawing share their geometry, but not their painting.
+TEST(LSystemView, shared_geometry)
+{
+    parameters_example params;
+    LSystemView view(params.name, params.lsys, params.map, params.params, params.painter);
+    view.set_headless(true);
+    view.finish_loading();
+
+    LSystemView other_view(params.name, params.lsys, params.map, params.params);
+    other_view.set_headless(true);
+    other_view.finish_loading();
+
+    // The second view did not derive the LSystem.
+    ASSERT_EQ(other_view.get_lsystem_buffer().get_rule_map().get_production_cache().size(), 1u);
+    ASSERT_EQ(&view.get_vertices(), &other_view.get_vertices());
+    ASSERT_EQ(view.get_colors().size(), other_view.get_colors().size());
+    ASSERT_NE(&view.get_colors(), &other_view.get_colors());
+}
+
+// Changing the angles rebuilds the vertices from the heading trace: they are
+// the vertices of a view computed with these angles.
+TEST(LSystemView, angle_change)
+{
+    parameters_example params;
+    params.painter = VertexPainterWrapper(std::make_shared<VertexPainterConstant>());
+    LSystemView view(params.name, params.lsys, params.map, params.params, params.painter);
+    view.set_headless(true);
+    view.finish_loading();
+
+    params.params.set_starting_angle(0.5);
+    params.params.set_delta_angle(0.3);
+    view.ref_parameters().set_starting_angle(0.5);
+    view.ref_parameters().set_delta_angle(0.3);
+    view.update();
+
+    // Another view would share the rebuilt geometry, so the expected vertices
+    // are interpreted directly.
+    Turtle turtle {params.params};
+    auto [str, iter, _] = params.lsys.produce(params.params.get_n_iter());
+    const auto& expected = turtle.compute_vertices(str, iter, params.map).vertices;
+
+    // The collinear vertices of the view are merged: its painter allows it.
+    const auto& vertices = view.get_vertices();
+    ASSERT_LT(vertices.size(), expected.size());
+    ASSERT_EQ(vertices.unmerged_size(), expected.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        const auto& position = vertices.positions.at(i);
+        ASSERT_NEAR(position.x, expected.positions.at(vertices.ordinal(i)).x, 1e-3);
+        ASSERT_NEAR(position.y, expected.positions.at(vertices.ordinal(i)).y, 1e-3);
+    }
+}
+
+// The painters for which the colors of merged vertices differ from the colors
+// of the vertices around them paint an unmerged drawing: the view is painted as
+// the vertices of an unmerged interpretation.
+TEST(LSystemView, unmerged_painting)
+{
+    parameters_example params;
+    auto random = std::make_shared<VertexPainterRandom>();
+    auto composite = std::make_shared<VertexPainterComposite>();
+    composite->set_main_painter(VertexPainterWrapper(std::make_shared<VertexPainterRandom>()));
+    composite->set_child_painters(
+        {VertexPainterWrapper(std::make_shared<VertexPainterConstant>()),
+         VertexPainterWrapper(std::make_shared<VertexPainterRandom>())});
+
+    Turtle turtle {params.params};
+    auto [str, iter, _] = params.lsys.produce(params.params.get_n_iter());
+    const auto& expected = turtle.compute_vertices(str, iter, params.map);
+
+    for (const auto& painter : {VertexPainterWrapper(random), VertexPainterWrapper(composite)})
+    {
+        LSystemView view(params.name, params.lsys, params.map, params.params, painter);
+        view.set_headless(true);
+        view.finish_loading();
+
+        std::vector<sf::Color> expected_colors(expected.vertices.size(), sf::Color::White);
+        view.get_vertex_painter_wrapper().unwrap()->paint_vertices(
+            expected_colors, expected.vertices, expected.iterations, 0, {});
+
+        ASSERT_TRUE(view.get_vertices().ordinals.empty());
+        ASSERT_EQ(view.get_colors(), expected_colors);
+    }
+}
+
+// A parametric system is interpreted with the parameters of its modules, and
+// its geometry is not shared with the system without its parametric rules.
+TEST(LSystemView, parametric)
+{
+    parameters_example params;
+    LSystemView plain_view(params.name, params.lsys, params.map, params.params, params.painter);
+    plain_view.set_headless(true);
+    plain_view.finish_loading();
+
+    params.lsys.add_parametric_rule({"X", "", "F(2)[+(30)X][-X]"});
+    LSystemView view(params.name, params.lsys, params.map, params.params, params.painter);
+    view.set_headless(true);
+    view.finish_loading();
+
+    Turtle turtle {params.params};
+    const auto& production = params.lsys.produce_parametric(params.params.get_n_iter());
+    const auto& expected = turtle.compute_vertices(production, params.map).vertices;
+
+    const auto& vertices = view.get_vertices();
+    ASSERT_NE(&vertices, &plain_view.get_vertices());
+    ASSERT_EQ(vertices.size(), expected.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        ASSERT_NEAR(vertices.positions.at(i).x, expected.positions.at(i).x, 1e-3);
+        ASSERT_NEAR(vertices.positions.at(i).y, expected.positions.at(i).y, 1e-3);
+    }
+}
@@ -0,0 +1,84 @@
+#include "QuantizedPositions.h"
+#include "VertexArrays.h"
+
+#include <cmath>
+#include <limits>
+#include <gtest/gtest.h>
+
+using namespace drawing;
+
+namespace
+{
+// A spiral far from the origin, over several chunks.
+std::vector<sf::Vector2f> spiral(std::size_t size)
+{
+    std::vector<sf::Vector2f> positions;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        const float angle = i * 0.01f;
+        positions.push_back({1e5f + i * std::cos(angle), -1e5f + i * std::sin(angle)});
+    }
+    return positions;
+}
+} // namespace
+
+// The error of each position is bounded by its chunk.
+TEST(QuantizedPositionsTest, error)
+{
+    const auto positions = spiral(3 * QuantizedPositions::chunk_size + 10);
+    const QuantizedPositions quantized {positions};
+
+    ASSERT_EQ(quantized.size(), positions.size());
+    const auto dequantized = quantized.dequantize();
+    // A chunk spans at most 2 * size on an axis.
+    const float bound = 2.f * positions.size() / std::numeric_limits<u16>::max() / 2;
+    ASSERT_LE(quantized.max_error(), bound);
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        ASSERT_EQ(quantized[i], dequantized.at(i));
+        ASSERT_NEAR(dequantized.at(i).x, positions.at(i).x, quantized.max_error() + 0.01f);
+        ASSERT_NEAR(dequantized.at(i).y, positions.at(i).y, quantized.max_error() + 0.01f);
+    }
+    ASSERT_LT(quantized.bytes(), positions.size() * sizeof(sf::Vector2f) * 3 / 4);
+}
+
+// A chunk with a null extent is exact.
+TEST(QuantizedPositionsTest, constant)
+{
+    const std::vector<sf::Vector2f> positions(10, {3.5f, -2.25f});
+    const QuantizedPositions quantized {positions};
+
+    ASSERT_EQ(quantized.max_error(), 0.f);
+    ASSERT_EQ(quantized.dequantize(), positions);
+    ASSERT_TRUE(QuantizedPositions().empty());
+}
+
+// The quantized vertices are read and converted like the others.
+TEST(QuantizedPositionsTest, vertex_arrays)
+{
+    VertexArrays vertices;
+    vertices.push_back({0, 0});
+    vertices.push_back({1, 0});
+    vertices.push_back({1, 1});
+    vertices.branches.push_back({2, 0});
+    const std::vector<sf::Color> colors(3, sf::Color::White);
+    const auto expected = to_sfml(vertices, colors);
+
+    vertices.quantize();
+    ASSERT_TRUE(vertices.is_quantized());
+    ASSERT_TRUE(vertices.positions.empty());
+    ASSERT_EQ(vertices.size(), 3u);
+    ASSERT_EQ(vertices.position(2), sf::Vector2f(1, 1));
+    ASSERT_EQ(vertices.parent(2), 0u);
+    const auto segments = to_sfml(vertices, colors);
+    ASSERT_EQ(segments.size(), expected.size());
+    for (std::size_t i = 0; i < segments.size(); ++i)
+    {
+        ASSERT_EQ(segments.at(i).position, expected.at(i).position);
+    }
+
+    vertices.dequantize();
+    ASSERT_FALSE(vertices.is_quantized());
+    ASSERT_EQ(vertices.positions.size(), 3u);
+    ASSERT_EQ(vertices.positions.at(1), sf::Vector2f(1, 0));
+}
@@ -0,0 +1,57 @@
+#include "VertexArrays.h"
+
+#include <gsl/gsl>
+#include <gtest/gtest.h>
+
+using namespace drawing;
+
+// The parent of a vertex is the previous one, except for the first vertex of
+// a branch.
+TEST(VertexArraysTest, parent)
+{
+    VertexArrays vertices;
+    vertices.push_back({0, 0});
+    vertices.push_back({1, 0});
+    vertices.push_back({2, 0});
+    vertices.push_back({1, 1});
+    vertices.branches.push_back({3, 1});
+
+    ASSERT_EQ(vertices.size(), 4u);
+    ASSERT_EQ(vertices.parent(1), 0u);
+    ASSERT_EQ(vertices.parent(2), 1u);
+    ASSERT_EQ(vertices.parent(3), 1u);
+    ASSERT_THROW(vertices.parent(0), gsl::fail_fast);
+    ASSERT_EQ(vertices.bytes(), 4 * sizeof(sf::Vector2f) + sizeof(VertexArrays::Branch));
+
+    vertices.clear();
+    ASSERT_TRUE(vertices.empty());
+    ASSERT_TRUE(vertices.branches.empty());
+}
+
+// Each segment is converted to its two vertices, with their colors.
+TEST(VertexArraysTest, to_sfml)
+{
+    VertexArrays vertices;
+    vertices.push_back({0, 0});
+    vertices.push_back({1, 0});
+    vertices.push_back({1, 1});
+    vertices.branches.push_back({2, 0});
+    const std::vector<sf::Color> colors {sf::Color::Red, sf::Color::Green, sf::Color::Blue};
+
+    const auto segments = to_sfml(vertices, colors);
+    ASSERT_EQ(segments.size(), 4u);
+    ASSERT_EQ(segments.at(0).color, sf::Color::Red);
+    ASSERT_EQ(segments.at(1).color, sf::Color::Green);
+    ASSERT_EQ(segments.at(2).position, sf::Vector2f(0, 0));
+    ASSERT_EQ(segments.at(2).color, sf::Color::Red);
+    ASSERT_EQ(segments.at(3).position, sf::Vector2f(1, 1));
+    ASSERT_EQ(segments.at(3).color, sf::Color::Blue);
+
+    std::vector<sf::Vertex> range;
+    to_sfml(vertices, colors, 2, 3, range);
+    ASSERT_EQ(range.size(), 2u);
+    ASSERT_EQ(range.at(0).position, sf::Vector2f(0, 0));
+
+    ASSERT_THROW(to_sfml(vertices, {sf::Color::Red}), gsl::fail_fast);
+    ASSERT_THROW(to_sfml(vertices, colors, 2, 4, range), gsl::fail_fast);
+}
@@ -14,14 +14,14 @@
 
 using namespace colors;
 
-std::vector<sf::Vertex> generate_grid(int size)
+drawing::VertexArrays generate_grid(int size)
 {
-    std::vector<sf::Vertex> grid;
+    drawing::VertexArrays grid;
     for (int i = 0; i < size * size; ++i)
     {
         int x = i % size;
         int y = i / size;
-        grid.push_back({{float(x), float(y)}, sf::Color::White});
+        grid.push_back({float(x), float(y)});
     }
     return grid;
 }
@@ -36,23 +36,12 @@ std::vector<std::uint8_t> generate_iterations(int size)
     return iterations;
 }
 
-std::vector<bool> generate_transparency(int size)
-{
-    std::vector<bool> transparent;
-    for (int i = 0; i < size * size; ++i)
-    {
-        transparent.push_back(false);
-    }
-    return transparent;
-}
-
 
 struct default_vertices
 {
     static constexpr int grid_size = 4;
-    std::vector<sf::Vertex> grid = generate_grid(grid_size);
-    std::vector<std::uint8_t> iterations = generate_iterations(grid_size);
-    std::vector<bool> transparent = generate_transparency(grid_size);
+    drawing::VertexArrays grid = generate_grid(grid_size);
+    IterationRuns iterations = IterationRuns(generate_iterations(grid_size));
     int max_iter = grid_size - 1;
     sf::FloatRect bounding_box {0, 0, grid_size - 1, grid_size - 1};
 } vertices;
@@ -61,16 +50,16 @@ TEST(VertexPainter, Constant)
 {
     ColorGeneratorWrapper colors(std::make_shared<ConstantColor>(sf::Color::Red));
     VertexPainterConstant painter(colors);
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
-    for (auto v : grid)
+    for (auto color : painted)
     {
-        ASSERT_EQ(sf::Color::Red, v.color);
+        ASSERT_EQ(sf::Color::Red, color);
     }
 }
 TEST(VertexPainter, ConstantSerialization)
@@ -89,16 +78,16 @@ TEST(VertexPainter, ConstantSerialization)
         ar(ipainter);
     }
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
-    for (auto v : grid)
+    for (auto color : painted)
     {
-        ASSERT_EQ(sf::Color::Red, v.color);
+        ASSERT_EQ(sf::Color::Red, color);
     }
 }
 
@@ -112,10 +101,10 @@ TEST(VertexPainter, Sequential)
         DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}, {colors[3], 3}})));
     VertexPainterSequential painter(colors_gen);
     painter.set_factor(2);
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
@@ -123,7 +112,35 @@ TEST(VertexPainter, Sequential)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(colors[((i * 2) / size) % size], grid[i].color);
+        ASSERT_EQ(colors[((i * 2) / size) % size], painted[i]);
+    }
+}
+// The merged vertices are painted with the colors of their ordinals.
+TEST(VertexPainter, SequentialMerged)
+{
+    std::array<sf::Color, vertices.grid_size> colors {sf::Color::Red,
+                                                      sf::Color::Blue,
+                                                      sf::Color::Yellow,
+                                                      sf::Color::Green};
+    ColorGeneratorWrapper colors_gen(std::make_shared<DiscreteGradient>(
+        DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}, {colors[3], 3}})));
+    VertexPainterSequential painter(colors_gen);
+    painter.set_factor(2);
+
+    drawing::VertexArrays merged;
+    int size = vertices.grid_size;
+    for (int i = 0; i < size * size; i += size + 1)
+    {
+        merged.push_back(vertices.grid.positions.at(i));
+        merged.ordinals.push_back(i);
+    }
+    std::vector<sf::Color> painted(merged.size(), sf::Color::White);
+    painter.paint_vertices(painted, merged, {}, vertices.max_iter, vertices.bounding_box);
+
+    ASSERT_EQ(merged.unmerged_size(), vertices.grid.size());
+    for (std::size_t i = 0; i < merged.size(); ++i)
+    {
+        ASSERT_EQ(colors[((merged.ordinals.at(i) * 2) / size) % size], painted[i]);
     }
 }
 TEST(VertexPainter, SequentialSerialization)
@@ -148,10 +165,10 @@ TEST(VertexPainter, SequentialSerialization)
         ar(ipainter);
     }
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
@@ -159,7 +176,7 @@ TEST(VertexPainter, SequentialSerialization)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(colors[((i * 2) / size) % size], grid[i].color);
+        ASSERT_EQ(colors[((i * 2) / size) % size], painted[i]);
     }
 }
 
@@ -172,10 +189,10 @@ TEST(VertexPainter, Iteration)
     ColorGeneratorWrapper colors_gen(std::make_shared<DiscreteGradient>(
         DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}, {colors[3], 3}})));
     VertexPainterIteration painter(colors_gen);
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
@@ -183,7 +200,7 @@ TEST(VertexPainter, Iteration)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(colors[i / size], grid[i].color);
+        ASSERT_EQ(colors[i / size], painted[i]);
     }
 }
 TEST(VertexPainter, IterationSerialization)
@@ -207,10 +224,10 @@ TEST(VertexPainter, IterationSerialization)
         ar(ipainter);
     }
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
@@ -218,7 +235,7 @@ TEST(VertexPainter, IterationSerialization)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(colors[i / size], grid[i].color);
+        ASSERT_EQ(colors[i / size], painted[i]);
     }
 }
 
@@ -232,10 +249,10 @@ TEST(VertexPainter, Linear)
         DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}, {colors[3], 3}})));
     VertexPainterLinear painter(colors_gen);
     painter.set_angle(90);
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
@@ -259,7 +276,7 @@ TEST(VertexPainter, Linear)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 TEST(VertexPainter, LinearSerialization)
@@ -284,10 +301,10 @@ TEST(VertexPainter, LinearSerialization)
         ar(ipainter);
     }
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
@@ -311,7 +328,7 @@ TEST(VertexPainter, LinearSerialization)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 
@@ -324,10 +341,10 @@ TEST(VertexPainter, Radial)
         DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}})));
     VertexPainterRadial painter(colors_gen);
     painter.set_center({1 / 3., 2 / 3.});
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
@@ -351,7 +368,7 @@ TEST(VertexPainter, Radial)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 TEST(VertexPainter, RadialSerialization)
@@ -377,10 +394,10 @@ TEST(VertexPainter, RadialSerialization)
     }
 
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
@@ -404,7 +421,7 @@ TEST(VertexPainter, RadialSerialization)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 
@@ -418,10 +435,10 @@ TEST(VertexPainter, Random)
         DiscreteGradient::keys({{colors[0], 0}, {colors[1], 1}, {colors[2], 2}, {colors[3], 3}})));
     VertexPainterRandom painter(colors_gen);
     painter.set_block_size(vertices.grid_size);
-    std::vector<sf::Vertex> grid = vertices.grid;
-    painter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    painter.paint_vertices(painted,
+                           vertices.grid,
                            vertices.iterations,
-                           vertices.transparent,
                            vertices.max_iter,
                            vertices.bounding_box);
 
@@ -431,7 +448,7 @@ TEST(VertexPainter, Random)
         std::array<sf::Color, vertices.grid_size> grid_colors;
         for (int j = 0; j < size; ++j)
         {
-            grid_colors[j] = grid[i * size + j].color;
+            grid_colors[j] = painted[i * size + j];
         }
         auto first = grid_colors[0];
         ASSERT_TRUE(std::all_of(begin(grid_colors), end(grid_colors), [first](auto col) {
@@ -465,10 +482,10 @@ TEST(VertexPainter, RandomSerialization)
     }
 
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    ipainter.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    ipainter.paint_vertices(painted,
+                            vertices.grid,
                             vertices.iterations,
-                            vertices.transparent,
                             vertices.max_iter,
                             vertices.bounding_box);
 
@@ -478,7 +495,7 @@ TEST(VertexPainter, RandomSerialization)
         std::array<sf::Color, vertices.grid_size> grid_colors;
         for (int j = 0; j < size; ++j)
         {
-            grid_colors[j] = grid[i * size + j].color;
+            grid_colors[j] = painted[i * size + j];
         }
         auto first = grid_colors[0];
         ASSERT_TRUE(std::all_of(begin(grid_colors), end(grid_colors), [first](auto col) {
@@ -509,14 +526,14 @@ TEST(VertexPainter, Composite)
     VertexPainterWrapper sequential_wrapper(
         std::make_shared<VertexPainterSequential>(discrete_gen3));
 
-    std::vector<sf::Vertex> grid = vertices.grid;
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
     VertexPainterComposite composite;
     composite.set_main_painter(VertexPainterWrapper(std::make_shared<VertexPainterIteration>()));
     composite.set_child_painters(
         {constant_wrapper, radial_wrapper, linear_wrapper, sequential_wrapper});
-    composite.paint_vertices(grid,
+    composite.paint_vertices(painted,
+                             vertices.grid,
                              vertices.iterations,
-                             vertices.transparent,
                              vertices.max_iter,
                              vertices.bounding_box);
 
@@ -541,7 +558,7 @@ TEST(VertexPainter, Composite)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 TEST(VertexPainter, CompositeSerialization)
@@ -582,10 +599,10 @@ TEST(VertexPainter, CompositeSerialization)
     }
 
 
-    std::vector<sf::Vertex> grid = vertices.grid;
-    icomposite.paint_vertices(grid,
+    std::vector<sf::Color> painted(vertices.grid.size(), sf::Color::White);
+    icomposite.paint_vertices(painted,
+                              vertices.grid,
                               vertices.iterations,
-                              vertices.transparent,
                               vertices.max_iter,
                               vertices.bounding_box);
 
@@ -610,7 +627,7 @@ TEST(VertexPainter, CompositeSerialization)
     int size_2 = size * size;
     for (int i = 0; i < size_2; ++i)
     {
-        ASSERT_EQ(expected_colors[i], grid[i].color);
+        ASSERT_EQ(expected_colors[i], painted[i]);
     }
 }
 
@@ -0,0 +1,558 @@
+#include "derivation.h"
+
+#include <gsl/gsl>
+#include <gtest/gtest.h>
+
+using namespace derivation;
+
+class derivation_test : public ::testing::Test
+{
+  public:
+    derivation_test()
+    {
+    }
+
+    // 'F' has a rule and is an iteration predecessor, 'G' has a rule, 'x' has
+    // an empty rule and '+' is a terminal.
+    const std::unordered_map<char, std::string> rules {{'F', "F+G"}, {'G', "G-F"}, {'x', ""}};
+    const std::string iteration_predecessors = "F";
+    const RuleTable table = compile_rules(rules, iteration_predecessors);
+};
+
+TEST_F(derivation_test, compile_rules)
+{
+    ASSERT_EQ(std::string(table.successors.at('F'), table.sizes.at('F')), "F+G");
+    ASSERT_EQ(std::string(table.successors.at('G'), table.sizes.at('G')), "G-F");
+    ASSERT_EQ(table.sizes.at('x'), 0u);
+    ASSERT_EQ(std::string(table.successors.at('+'), table.sizes.at('+')), "+");
+    ASSERT_EQ(table.increments.at('F'), 1);
+    ASSERT_EQ(table.increments.at('G'), 0);
+}
+
+TEST_F(derivation_test, derived_size)
+{
+    ASSERT_EQ(derived_size(table, ""), 0u);
+    ASSERT_EQ(derived_size(table, "F+Gx"), 7u);
+}
+
+TEST_F(derivation_test, derive)
+{
+    const std::string base = "F+Gx";
+    const IterationRuns base_iteration({1, 1, 1, 0});
+    const std::string expected_production = "F+G+G-F";
+    const std::vector<u8> expected_iteration {2, 2, 2, 1, 1, 1, 1};
+
+    std::string production(derived_size(table, base), '\0');
+    IterationRuns iteration;
+    bool is_new_iteration = derive(table, base, &base_iteration, production.data(), &iteration);
+
+    ASSERT_EQ(production, expected_production);
+    ASSERT_EQ(iteration.decode(), expected_iteration);
+    // A successor is a single run.
+    ASSERT_EQ(iteration.runs().size(), 2u);
+    ASSERT_TRUE(is_new_iteration);
+}
+
+TEST_F(derivation_test, derive_only_iteration)
+{
+    const std::string base = "G+";
+    const IterationRuns base_iteration(2, 3);
+    const IterationRuns expected_iteration(4, 3);
+
+    IterationRuns iteration;
+    bool is_new_iteration = derive(table, base, &base_iteration, nullptr, &iteration);
+
+    ASSERT_EQ(iteration, expected_iteration);
+    ASSERT_FALSE(is_new_iteration);
+}
+
+// The parallel derivation must give exactly the same result as the sequential
+// one, whatever the number of chunks.
+TEST_F(derivation_test, derive_iteration_parallel)
+{
+    const std::string base = "F+Gx-FxG+F";
+    const IterationRuns base_iteration({1, 1, 1, 0, 2, 2, 0, 1, 1, 3});
+
+    std::string expected_production;
+    IterationRuns expected_iteration;
+    bool expected_new_iteration = derive_iteration(table,
+                                                   base,
+                                                   base_iteration,
+                                                   &expected_production,
+                                                   &expected_iteration,
+                                                   1);
+
+    for (unsigned n_threads : {2u, 3u, 7u, 32u})
+    {
+        std::string production;
+        IterationRuns iteration;
+        bool is_new_iteration =
+            derive_iteration(table, base, base_iteration, &production, &iteration, n_threads);
+
+        ASSERT_EQ(production, expected_production);
+        ASSERT_EQ(iteration, expected_iteration);
+        ASSERT_EQ(is_new_iteration, expected_new_iteration);
+    }
+
+    // Without the iteration counts, the production is the same.
+    std::string production;
+    ASSERT_EQ(derive_iteration(table, base, {}, &production, nullptr, 3), expected_new_iteration);
+    ASSERT_EQ(production, expected_production);
+}
+
+TEST_F(derivation_test, symbols_per_iteration)
+{
+    auto symbols = symbols_per_iteration(table, "x", 3);
+
+    ASSERT_EQ(symbols.size(), 3u);
+    ASSERT_TRUE(symbols.at(0).test('x'));
+    ASSERT_EQ(symbols.at(0).count(), 1u);
+    ASSERT_TRUE(symbols.at(1).none());
+    ASSERT_TRUE(symbols.at(2).none());
+
+    symbols = symbols_per_iteration(table, "F", 3);
+    ASSERT_EQ(symbols.at(1).count(), 3u);
+    ASSERT_EQ(symbols.at(2).count(), 4u);
+}
+
+// The direct expansion must give exactly the same result as deriving the
+// axiom iteration by iteration, whatever the number of threads.
+TEST_F(derivation_test, expand)
+{
+    const std::string axiom = "xF+G";
+    const u8 n = 6;
+
+    ExpansionLengths lengths(n + 1);
+    lengths.at(0).fill(1);
+    for (u8 k = 1; k <= n; ++k)
+    {
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            const std::string_view successor(table.successors.at(c), table.sizes.at(c));
+            lengths.at(k).at(c) = 0;
+            for (char s : successor)
+            {
+                lengths.at(k).at(c) += lengths.at(k - 1).at(index(s));
+            }
+        }
+    }
+
+    std::string expected_production = axiom;
+    IterationRuns expected_iteration(axiom.size(), 0);
+    for (u8 i = 0; i < n; ++i)
+    {
+        std::string production;
+        IterationRuns iteration;
+        derive_iteration(table, expected_production, expected_iteration, &production, &iteration);
+        expected_production = std::move(production);
+        expected_iteration = std::move(iteration);
+    }
+
+    for (unsigned n_threads : {1u, 2u, 5u})
+    {
+        std::string production;
+        IterationRuns iteration;
+        expand(table, lengths, {}, axiom, n, production, &iteration, n_threads);
+
+        ASSERT_EQ(production, expected_production);
+        ASSERT_EQ(iteration, expected_iteration);
+    }
+
+    // Whatever the blocks memoized, the result is the same.
+    for (std::size_t budget : {0u, 20u, 100u, 1000u})
+    {
+        const ExpansionBlocks blocks(table, lengths, n, budget);
+        ASSERT_LE(blocks.size(), budget);
+
+        std::string production;
+        IterationRuns iteration;
+        expand(table, lengths, blocks, axiom, n, production, &iteration, 2);
+
+        ASSERT_EQ(production, expected_production);
+        ASSERT_EQ(iteration, expected_iteration);
+    }
+
+    std::string production;
+    expand(table, lengths, ExpansionBlocks(table, lengths, n, 100), axiom, n, production, nullptr, 2);
+    ASSERT_EQ(production, expected_production);
+}
+
+TEST_F(derivation_test, expansion_blocks)
+{
+    ExpansionLengths lengths(3);
+    for (auto& level : lengths)
+    {
+        level.fill(1);
+    }
+    lengths.at(1).at('F') = 3;
+    lengths.at(1).at('G') = 3;
+    lengths.at(1).at('x') = 0;
+    lengths.at(2).at('F') = 7;
+    lengths.at(2).at('G') = 7;
+    lengths.at(2).at('x') = 0;
+
+    const ExpansionBlocks blocks(table, lengths, 2, 1000);
+
+    ASSERT_EQ(blocks.find('F', 0), nullptr);
+    ASSERT_EQ(blocks.find('+', 1), nullptr);
+    ASSERT_EQ(blocks.find('F', 3), nullptr);
+    ASSERT_EQ(blocks.find('F', 1)->production, "F+G");
+    ASSERT_EQ(blocks.find('F', 1)->iteration, IterationRuns(3, 1));
+    ASSERT_EQ(blocks.find('x', 2)->production, "");
+    ASSERT_EQ(blocks.find('G', 2)->production, "G-F-F+G");
+    ASSERT_EQ(blocks.find('G', 2)->iteration, IterationRuns({0, 0, 0, 0, 1, 1, 1}));
+    // The blocks of 'F' have a single run and the blocks of 'G' two runs.
+    ASSERT_EQ(blocks.size(), 3 + 3 + 7 + 7 + 6 * sizeof(IterationRuns::Run));
+}
+
+// Streaming a base must yield exactly the symbols and iteration counts of its
+// iterative derivation.
+TEST_F(derivation_test, symbol_stream)
+{
+    const std::string base = "F+Gx-F";
+    const IterationRuns base_iteration({1, 1, 1, 0, 2, 2});
+    const u8 n = 5;
+
+    std::string expected_production = base;
+    IterationRuns expected_iteration = base_iteration;
+    for (u8 i = 0; i < n; ++i)
+    {
+        std::string production;
+        IterationRuns iteration;
+        derive_iteration(table, expected_production, expected_iteration, &production, &iteration);
+        expected_production = std::move(production);
+        expected_iteration = std::move(iteration);
+    }
+
+    SymbolStream stream(table, base, &base_iteration, n);
+    std::string production;
+    IterationRuns iteration;
+    char symbol;
+    u8 count;
+    while (stream.next(symbol, count))
+    {
+        production.push_back(symbol);
+        iteration.push_back(count);
+    }
+
+    ASSERT_EQ(production, expected_production);
+    ASSERT_EQ(iteration, expected_iteration);
+    ASSERT_FALSE(stream.next(symbol, count));
+}
+
+TEST_F(derivation_test, symbol_stream_empty)
+{
+    char symbol = 'a';
+    u8 count = 42;
+
+    SymbolStream empty;
+    ASSERT_FALSE(empty.next(symbol, count));
+
+    SymbolStream only_empty_rule(table, "x", nullptr, 3);
+    ASSERT_FALSE(only_empty_rule.next(symbol, count));
+    ASSERT_EQ(symbol, 'a');
+    ASSERT_EQ(count, 42);
+}
+
+// Streaming a packed base yields the symbols of its unpacked base, across the
+// blocks in which it is decoded, even if the stream is moved.
+TEST_F(derivation_test, symbol_stream_packed)
+{
+    const std::string alphabet = "+-FGx";
+    std::string base;
+    IterationRuns base_iteration;
+    for (std::size_t i = 0; i < 150001; ++i)
+    {
+        base.push_back(alphabet.at((i * 7) % alphabet.size()));
+        base_iteration.push_back(static_cast<u8>(i / 1000));
+    }
+    const PackedProduction packed(base, alphabet);
+
+    for (u8 n : {0, 2})
+    {
+        SymbolStream expected_stream(table, base, &base_iteration, n);
+        SymbolStream packed_stream(table, packed, &base_iteration, n);
+        char expected_symbol;
+        u8 expected_count;
+        char symbol;
+        u8 count;
+        for (std::size_t i = 0; expected_stream.next(expected_symbol, expected_count); ++i)
+        {
+            if (i == 100000)
+            {
+                SymbolStream moved = std::move(packed_stream);
+                packed_stream = std::move(moved);
+            }
+            ASSERT_TRUE(packed_stream.next(symbol, count));
+            ASSERT_EQ(symbol, expected_symbol);
+            ASSERT_EQ(count, expected_count);
+        }
+        ASSERT_FALSE(packed_stream.next(symbol, count));
+    }
+
+    // The contexts are computed on a whole base.
+    const auto context_table =
+        compile_rules(rules, iteration_predecessors, {}, 0, {{'F', {{"G", "x", ""}}}});
+    ASSERT_THROW(SymbolStream(context_table, packed, nullptr, 1), gsl::fail_fast);
+}
+
+// Known answers from the reference implementation Random123.
+TEST(PhiloxTest, known_answers)
+{
+    using Counter = std::array<u32, 4>;
+    ASSERT_EQ(philox({0, 0, 0, 0}, {0, 0}),
+              (Counter {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    ASSERT_EQ(philox({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              (Counter {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+}
+
+// The random choices of a stochastic derivation only depend on the seed, the
+// iteration and the position of the symbols: the result is the same whatever
+// the number of threads, and a stream derives the same symbols.
+TEST_F(derivation_test, stochastic_derivation)
+{
+    const StochasticRules stochastic_rules {{'F', {{"F-F", 1}, {"", 2}}}};
+    const auto stochastic_table =
+        compile_rules(rules, iteration_predecessors, stochastic_rules, 42);
+    ASSERT_TRUE(stochastic_table.is_stochastic);
+    ASSERT_FALSE(table.is_stochastic);
+    ASSERT_EQ(stochastic_table.choices.at('F').size(), 3u);
+    ASSERT_TRUE(stochastic_table.choices.at('G').empty());
+
+    const std::string base(5000, 'F');
+    const IterationRuns base_iteration(base.size(), 1);
+
+    std::string expected_production;
+    IterationRuns expected_iteration;
+    derive_iteration(stochastic_table,
+                     base,
+                     base_iteration,
+                     &expected_production,
+                     &expected_iteration,
+                     1,
+                     3);
+
+    // Each successor is chosen in proportion to its weight: "F+G" with 1,
+    // "F-F" with 1 and "" with 2.
+    const auto size = static_cast<double>(base.size());
+    const auto n_rule = std::count(begin(expected_production), end(expected_production), '+');
+    const auto n_other = std::count(begin(expected_production), end(expected_production), '-');
+    ASSERT_NEAR(n_rule / size, 0.25, 0.03);
+    ASSERT_NEAR(n_other / size, 0.25, 0.03);
+
+    for (unsigned n_threads : {2u, 7u})
+    {
+        std::string production;
+        IterationRuns iteration;
+        derive_iteration(stochastic_table,
+                         base,
+                         base_iteration,
+                         &production,
+                         &iteration,
+                         n_threads,
+                         3);
+        ASSERT_EQ(production, expected_production);
+        ASSERT_EQ(iteration, expected_iteration);
+    }
+
+    SymbolStream stream(stochastic_table, base, &base_iteration, 1, 2);
+    std::string production;
+    char symbol;
+    u8 count;
+    while (stream.next(symbol, count))
+    {
+        production.push_back(symbol);
+    }
+    ASSERT_EQ(production, expected_production);
+
+    // Another seed or iteration gives other choices.
+    std::string other_production;
+    IterationRuns other_iteration;
+    derive_iteration(stochastic_table,
+                     base,
+                     base_iteration,
+                     &other_production,
+                     &other_iteration,
+                     1,
+                     4);
+    ASSERT_NE(other_production, expected_production);
+
+    ASSERT_THROW(SymbolStream(stochastic_table, base, nullptr, 2), gsl::fail_fast);
+}
+
+TEST_F(derivation_test, compute_contexts)
+{
+    const ContextRules context_rules {{'G', {{"F", "x", ""}}}};
+    const auto context_table =
+        compile_rules(rules, iteration_predecessors, {}, 0, context_rules, "+");
+    ASSERT_TRUE(context_table.is_context_sensitive);
+    ASSERT_FALSE(table.is_context_sensitive);
+    ASSERT_FALSE(is_expandable(context_table));
+
+    // The branches are skipped when looking for the symbol after, and the
+    // symbol before a branch is the symbol before its first symbol.
+    const auto contexts = compute_contexts(context_table, "F+G[x[F]]G");
+    const auto F = static_cast<u16>('F');
+    const auto G = static_cast<u16>('G');
+    const auto x = static_cast<u16>('x');
+    ASSERT_EQ(contexts.left,
+              (std::vector<u16> {no_context, F, F, G, G, x, x, F, x, G}));
+    ASSERT_EQ(contexts.right,
+              (std::vector<u16> {G, G, G, x, no_context, F, no_context, no_context, G, no_context}));
+
+    ASSERT_THROW(
+        compile_rules(rules, iteration_predecessors, {}, 0, {{'G', {{"FF", "x", ""}}}}),
+        gsl::fail_fast);
+}
+
+// A signal propagated along the branches: the result of a context-sensitive
+// derivation is the same whatever the number of threads, and a stream derives
+// the same symbols.
+TEST_F(derivation_test, context_derivation)
+{
+    const std::unordered_map<char, std::string> signal_rules {{'a', "a"}, {'b', "a"}};
+    const ContextRules context_rules {{'a', {{"b", "b", ""}}}};
+    const auto context_table = compile_rules(signal_rules, "", {}, 0, context_rules);
+
+    std::string production = "ba[a]a";
+    IterationRuns iteration(production.size(), 0);
+    for (const std::string expected : {"ab[a]a", "aa[b]b", "aa[a]a"})
+    {
+        std::string next_production;
+        IterationRuns next_iteration;
+        derive_iteration(context_table, production, iteration, &next_production, &next_iteration);
+        ASSERT_EQ(next_production, expected);
+        production = std::move(next_production);
+        iteration = std::move(next_iteration);
+    }
+
+    std::string base = "b";
+    for (int i = 0; i < 1000; ++i)
+    {
+        base += i % 3 == 0 ? "a[a[a]a]" : "a";
+    }
+    const IterationRuns base_iteration(base.size(), 0);
+
+    std::string expected_production;
+    IterationRuns expected_iteration;
+    derive_iteration(
+        context_table, base, base_iteration, &expected_production, &expected_iteration, 1, 1);
+
+    for (unsigned n_threads : {2u, 7u})
+    {
+        std::string threaded_production;
+        IterationRuns threaded_iteration;
+        derive_iteration(context_table,
+                         base,
+                         base_iteration,
+                         &threaded_production,
+                         &threaded_iteration,
+                         n_threads,
+                         1);
+        ASSERT_EQ(threaded_production, expected_production);
+        ASSERT_EQ(threaded_iteration, expected_iteration);
+    }
+
+    SymbolStream stream(context_table, base, &base_iteration, 1, 0);
+    std::string streamed;
+    char symbol;
+    u8 count;
+    while (stream.next(symbol, count))
+    {
+        streamed.push_back(symbol);
+    }
+    ASSERT_EQ(streamed, expected_production);
+
+    ASSERT_THROW(SymbolStream(context_table, base, nullptr, 2), gsl::fail_fast);
+}
+
+TEST_F(derivation_test, production_dag)
+{
+    const std::string axiom = "xF+G";
+    const u8 n = 5;
+    ExpansionLengths lengths(n + 1);
+    lengths.at(0).fill(1);
+    for (u8 k = 1; k <= n; ++k)
+    {
+        for (std::size_t c = 0; c < table_size; ++c)
+        {
+            const std::string_view successor(table.successors.at(c), table.sizes.at(c));
+            lengths.at(k).at(c) = 0;
+            for (char s : successor)
+            {
+                lengths.at(k).at(c) += lengths.at(k - 1).at(index(s));
+            }
+        }
+    }
+
+    std::string expected_production;
+    IterationRuns runs;
+    expand(table, lengths, {}, axiom, n, expected_production, &runs);
+    const auto expected_iteration = runs.decode();
+
+    const ProductionDag dag(table, lengths, axiom, n);
+    ASSERT_EQ(dag.size(), expected_production.size());
+    for (std::size_t i = 0; i < dag.size(); ++i)
+    {
+        auto [symbol, iteration] = dag.symbol_at(i);
+        ASSERT_EQ(symbol, expected_production.at(i));
+        ASSERT_EQ(iteration, expected_iteration.at(i));
+    }
+
+    for (auto [first, last] : {std::pair<std::size_t, std::size_t> {0, 0},
+                               {0, dag.size()},
+                               {3, 17},
+                               {dag.size() - 5, dag.size()},
+                               {dag.size(), dag.size()}})
+    {
+        std::string production;
+        IterationRuns iteration;
+        dag.slice(first, last, production, iteration);
+        ASSERT_EQ(production, expected_production.substr(first, last - first));
+        ASSERT_EQ(iteration.decode(),
+                  std::vector<u8>(begin(expected_iteration) + first,
+                                  begin(expected_iteration) + last));
+    }
+
+    ASSERT_THROW(dag.symbol_at(dag.size()), gsl::fail_fast);
+}
+
+TEST(PackedProductionTest, pack)
+{
+    for (std::string alphabet : {"F+", "F+G-", "ABCDEFGHIJKLMNOP", "ABCDEFGHIJKLMNOPQ"})
+    {
+        // The last byte is partially filled.
+        std::string production;
+        for (std::size_t i = 0; i < 37; ++i)
+        {
+            production.push_back(alphabet.at((i * 7) % alphabet.size()));
+        }
+
+        const PackedProduction packed(production, alphabet);
+        const auto bits = PackedProduction::bits_per_symbol(alphabet.size());
+        ASSERT_EQ(packed.size(), production.size());
+        ASSERT_EQ(packed.bytes(), (production.size() * bits + 7) / 8);
+        ASSERT_EQ(packed.unpack(), production);
+        for (std::size_t i = 0; i < production.size(); ++i)
+        {
+            ASSERT_EQ(packed.symbol_at(i), production.at(i));
+        }
+
+        // The ranges may start and end in the middle of a byte.
+        for (auto [position, count] : {std::pair {0, 37}, {3, 30}, {5, 1}, {9, 0}, {36, 1}})
+        {
+            std::string range(count, '\0');
+            packed.unpack(position, count, range.data());
+            ASSERT_EQ(range, production.substr(position, count));
+        }
+    }
+
+    ASSERT_EQ(PackedProduction::bits_per_symbol(4), 2u);
+    ASSERT_EQ(PackedProduction::bits_per_symbol(16), 4u);
+    ASSERT_EQ(PackedProduction::bits_per_symbol(17), 8u);
+    ASSERT_EQ(PackedProduction().unpack(), "");
+    ASSERT_THROW(PackedProduction("F+x", "F+"), gsl::fail_fast);
+    ASSERT_THROW(PackedProduction("F", "F+").symbol_at(1), gsl::fail_fast);
+    char out;
+    ASSERT_THROW(PackedProduction("F", "F+").unpack(1, 1, &out), gsl::fail_fast);
+}
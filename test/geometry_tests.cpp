@@ -7,13 +7,13 @@
 using namespace geometry;
 
 // Create a circle
-std::vector<sf::Vertex> gen_circle()
+std::vector<sf::Vector2f> gen_circle()
 {
     const float PI = 3.1415;
-    std::vector<sf::Vertex> circle;
+    std::vector<sf::Vector2f> circle;
     for (float i = 0; i <= 2 * PI; i += PI / 12.f)
     {
-        circle.push_back({{std::cos(i), std::sin(i)}});
+        circle.push_back({std::cos(i), std::sin(i)});
     }
     return circle;
 }
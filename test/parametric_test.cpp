@@ -0,0 +1,142 @@
+#include "parametric.h"
+
+#include <cmath>
+#include <gsl/gsl>
+#include <gtest/gtest.h>
+
+using namespace parametric;
+
+TEST(parametric_test, compile_expression)
+{
+    const std::vector<std::string> names {"x", "y"};
+    const std::array<double, 2> parameters {3, 4};
+    auto value = [&](std::string_view expression) {
+        const auto program = compile_expression(expression, names);
+        EXPECT_TRUE(program) << expression;
+        return program ? evaluate(*program, parameters.data()) : 0;
+    };
+
+    ASSERT_EQ(value("x"), 3);
+    ASSERT_EQ(value("1 + 2 * x - y / 2"), 5);
+    ASSERT_EQ(value("(1 + 2) * x"), 9);
+    ASSERT_DOUBLE_EQ(value("x ^ 2 ^ 0.5"), std::pow(3, std::sqrt(2)));
+    ASSERT_EQ(value("-x ^ 2"), -9);
+    ASSERT_EQ(value("2 ^ -1"), 0.5);
+    ASSERT_EQ(value("x < y && !(x >= y) || 0"), 1);
+    ASSERT_EQ(value("x == 3 && y != 4"), 0);
+    ASSERT_EQ(value(".5e1"), 5);
+
+    ASSERT_FALSE(compile_expression("z", names));
+    ASSERT_FALSE(compile_expression("1 +", names));
+    ASSERT_FALSE(compile_expression("(x", names));
+    ASSERT_FALSE(compile_expression("x y", names));
+    ASSERT_FALSE(compile_expression("", names));
+
+    // Each right operand nested uses one more register.
+    std::string nested = "x";
+    for (std::size_t i = 0; i < max_registers; ++i)
+    {
+        nested = "x + (" + nested + ")";
+    }
+    ASSERT_FALSE(compile_expression(nested, names));
+}
+
+// The constant subexpressions are folded when compiling.
+TEST(parametric_test, constant_folding)
+{
+    const auto constant = compile_expression("(1 + 2) * 4 - -2");
+    ASSERT_TRUE(constant);
+    ASSERT_EQ(constant->code.size(), 1u);
+    ASSERT_EQ(evaluate(*constant, nullptr), 14);
+
+    const auto program = compile_expression("x * (1 + 2)", {"x"});
+    ASSERT_TRUE(program);
+    ASSERT_EQ(program->code.size(), 3u);
+    ASSERT_EQ(program->constants, std::vector<double> {3});
+}
+
+TEST(parametric_test, parse_production)
+{
+    const auto production = parse_production("F(1, 2 * 3)+ [X()G(-1)]");
+    ASSERT_TRUE(production);
+    ASSERT_EQ(production->symbols, "F+[XG]");
+    ASSERT_EQ(production->offsets, (std::vector<u32> {0, 2, 2, 2, 2, 3, 3}));
+    ASSERT_EQ(production->parameters, (std::vector<double> {1, 6, -1}));
+    ASSERT_EQ(production->iterations, std::vector<u8>(6, 0));
+    ASSERT_EQ(production->arity(0), 2u);
+    ASSERT_EQ(production->parameters_of(4)[0], -1);
+
+    ASSERT_FALSE(parse_production("F(x)"));
+    ASSERT_FALSE(parse_production("F(1"));
+    ASSERT_FALSE(parse_production("F)"));
+}
+
+TEST(parametric_test, compile_rules)
+{
+    const auto table = compile_rules({{"F(l, w)", "l > 1", "F(l / 2, w)+F(l / 2)"}}, "F");
+    ASSERT_TRUE(table);
+    const auto& rules = table->rules.at('F');
+    ASSERT_EQ(rules.size(), 1u);
+    ASSERT_EQ(rules.at(0).arity, 2);
+    ASSERT_TRUE(rules.at(0).condition);
+    ASSERT_EQ(rules.at(0).symbols, "F+F");
+    ASSERT_EQ(rules.at(0).offsets, (std::vector<u32> {0, 2, 2, 3}));
+    ASSERT_EQ(table->increments.at('F'), 1);
+    ASSERT_TRUE(table->rules.at('+').empty());
+
+    ASSERT_FALSE(compile_rules({{"FG", "", "F"}}));
+    ASSERT_FALSE(compile_rules({{"F(l, l)", "", "F"}}));
+    ASSERT_FALSE(compile_rules({{"F(2)", "", "F"}}));
+    ASSERT_FALSE(compile_rules({{"F(l)", "w > 1", "F"}}));
+    ASSERT_FALSE(compile_rules({{"F(l)", "", "F(w)"}}));
+}
+
+// The rule of a module is the first one with the same number of parameters and
+// whose condition is true. Without one, the module is copied.
+TEST(parametric_test, derive)
+{
+    const auto table = compile_rules({{"A(x)", "x >= 2", "B(x - 2)"},
+                                      {"A(x)", "", "A(x + 1)C"},
+                                      {"B(x, y)", "", "X"}},
+                                     "A");
+    ASSERT_TRUE(table);
+    const auto base = parse_production("A(1)A(2)B(3)B(4, 5)");
+    ASSERT_TRUE(base);
+
+    Production production;
+    ASSERT_TRUE(derive(*table, *base, production));
+    ASSERT_EQ(production.symbols, "ACBBX");
+    ASSERT_EQ(production.offsets, (std::vector<u32> {0, 1, 1, 2, 3, 3}));
+    ASSERT_EQ(production.parameters, (std::vector<double> {2, 0, 3}));
+    ASSERT_EQ(production.iterations, (std::vector<u8> {1, 1, 1, 0, 0}));
+    ASSERT_EQ(production.max_iteration, 1);
+
+    ASSERT_THROW(derive(*table, production, production), gsl::fail_fast);
+}
+
+// The result of a derivation is the same whatever the number of threads.
+TEST(parametric_test, derive_threads)
+{
+    const auto table = compile_rules(
+        {{"F(l)", "l > 0.01", "F(l * 0.6)[+(30)F(l * 0.4)]-(20)F(l * 0.5)"}}, "F");
+    ASSERT_TRUE(table);
+    const auto axiom = parse_production("F(1)");
+    ASSERT_TRUE(axiom);
+
+    const auto expected = produce(*table, *axiom, 6);
+    ASSERT_GT(expected.symbols.size(), 1000u);
+    ASSERT_EQ(expected.offsets.size(), expected.symbols.size() + 1);
+    ASSERT_EQ(expected.offsets.back(), expected.parameters.size());
+    ASSERT_EQ(expected.max_iteration, 6);
+
+    Production base = produce(*table, *axiom, 5);
+    for (unsigned n_threads : {1u, 2u, 7u})
+    {
+        Production production;
+        derive(*table, base, production, n_threads);
+        ASSERT_EQ(production.symbols, expected.symbols);
+        ASSERT_EQ(production.iterations, expected.iterations);
+        ASSERT_EQ(production.offsets, expected.offsets);
+        ASSERT_EQ(production.parameters, expected.parameters);
+    }
+}
@@ -198,14 +198,13 @@ TEST_F(size_computer_test, map_matrix)
     //                             {']', load_position},
     //                             {'y', go_forward}};
     // const int vx_per_goforward = 1;
-    // const int vx_per_loadposition = 3;
     // PREDS:  + - F G [ ] x y z      (x,z are in the LSystem)
     // [[0]  : +
     //  [0]  : -
     //  [1]  : F
     //  [1]  : G
     //  [0]  : [
-    //  [3]  : ]
+    //  [0]  : ]
     //  [0]  : x
     //  [1]  : y
     //  [1]] : z
@@ -214,7 +213,7 @@ TEST_F(size_computer_test, map_matrix)
                                                             {vx_per_goforward},
                                                             {vx_per_goforward},
                                                             {0},
-                                                            {vx_per_loadposition},
+                                                            {0},
                                                             {0},
                                                             {vx_per_goforward},
                                                             {0}};
@@ -239,7 +238,7 @@ TEST_F(size_computer_test, compute_max_size)
 
     drawing::Turtle turtle(params);
     const auto& [str, iters, _1] = no_const_lsys.produce(n_iter);
-    const auto& [vx, _2, _3] = turtle.compute_vertices(str, iters, map);
+    const auto& [vx, _2] = turtle.compute_vertices(str, iters, map);
 
     const number expected_lsys_size = str.size();
     const number expected_vx_size = vx.size();
@@ -274,7 +273,7 @@ TEST_F(size_computer_test, compute_max_size_unbalanced)
 
     drawing::Turtle turtle(params);
     const auto& [str, iters, _1] = unbalanced_lsys.produce(n_iter);
-    const auto& [vx, _2, _3] = turtle.compute_vertices(str, iters, map);
+    const auto& [vx, _2] = turtle.compute_vertices(str, iters, map);
 
     number lsys_size = str.size();
     number vx_size = vx.size();